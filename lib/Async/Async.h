@@ -0,0 +1,441 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <exception>
+#include <TimerWheel.h>
+
+#if !__has_include(<coroutine>) || !defined(__cpp_impl_coroutine)
+#error "lib/Async needs C++20 coroutines, GCC 10 or newer with -std=gnu++20"
+#endif
+#include <coroutine>
+
+/**--------------------------------------------------------------------------------------
+ * Async Tasks
+ *
+ * Stackless C++20 coroutines that read as sequential code instead of a state machine:
+ *
+ *   AsyncTask blink()
+ *   {
+ *       while (true)
+ *       {
+ *           led.toggle();
+ *           co_await sleep_ms(500);
+ *       }
+ *   }
+ *
+ *   void setup() { asyncExecutor().start(blink()); }
+ *   void loop() { asyncExecutor().run(); }
+ *
+ *   co_await sleep_ms(ms)               resumes ms later, on a WheelTimer from lib/Timer
+ *   co_await until(predicate)           resumes once predicate() is true, checked every run()
+ *   co_await until(predicate, ms)       the same, gives false when ms passed first
+ *   co_await other()                    runs another AsyncTask to its end, gives false when it
+ *                                       got no frame and did not run
+ *
+ * A sleeping task costs nothing per run(), only until() predicates are polled. Coroutine
+ * frames come from a pool of ASYNC_FRAMES blocks of ASYNC_FRAME_SIZE bytes, never the heap. A
+ * frame bigger than a block or a full pool gives an invalid task that start() turns down.
+ * Not thread safe, start and run tasks from the same task.
+ *-------------------------------------------------------------------------------------*/
+
+#ifndef ASYNC_FRAME_SIZE
+#define ASYNC_FRAME_SIZE 256 // Bytes of the largest coroutine frame, locals kept across co_await included
+#endif
+
+#ifndef ASYNC_FRAMES
+#define ASYNC_FRAMES 8 // Coroutine frames alive at once, awaited sub-tasks included
+#endif
+
+class AsyncExecutor;
+class AsyncTask;
+
+/**--------------------------------------------------------------------------------------
+ * Frame Pool
+ *-------------------------------------------------------------------------------------*/
+
+class AsyncFramePool
+{
+private:
+    static_assert(ASYNC_FRAME_SIZE % alignof(max_align_t) == 0, "ASYNC_FRAME_SIZE must be a multiple of alignof(max_align_t)");
+    static_assert(ASYNC_FRAMES > 0 && ASYNC_FRAMES < 256, "ASYNC_FRAMES must be 1 to 255");
+
+    union Block
+    {
+        Block *next; // Free list link while the block is free
+        alignas(max_align_t) uint8_t frame[ASYNC_FRAME_SIZE];
+    };
+
+    Block blocks[ASYNC_FRAMES];
+    Block *freeList;
+    uint8_t used;
+    uint8_t peak;
+    uint16_t largest;  // Largest frame asked for
+    uint32_t failures; // Frames too big or pool full
+
+public:
+    AsyncFramePool() : freeList(nullptr), used(0), peak(0), largest(0), failures(0)
+    {
+        for (size_t i = ASYNC_FRAMES; i > 0; i--)
+        {
+            blocks[i - 1].next = freeList;
+            freeList = &blocks[i - 1];
+        }
+    }
+
+    AsyncFramePool(const AsyncFramePool &) = delete;
+    AsyncFramePool &operator=(const AsyncFramePool &) = delete;
+
+    // A block for a frame of size bytes, nullptr when it is too big or none is free
+    void *allocate(size_t size)
+    {
+        largest = size > largest ? (size < UINT16_MAX ? static_cast<uint16_t>(size) : UINT16_MAX) : largest;
+        if (size > ASYNC_FRAME_SIZE || freeList == nullptr)
+        {
+            failures++;
+            return nullptr;
+        }
+        Block *block = freeList;
+        freeList = block->next;
+        used++;
+        peak = used > peak ? used : peak;
+        return block->frame;
+    }
+
+    void release(void *frame)
+    {
+        Block *block = static_cast<Block *>(frame);
+        block->next = freeList;
+        freeList = block;
+        used--;
+    }
+
+    size_t capacity() const { return ASYNC_FRAMES; }
+    size_t frameSize() const { return ASYNC_FRAME_SIZE; }
+    size_t size() const { return used; }
+    size_t maxSize() const { return peak; }         // Most frames alive at once
+    size_t largestFrame() const { return largest; } // Size ASYNC_FRAME_SIZE to this
+    uint32_t failed() const { return failures; }
+};
+
+inline AsyncFramePool &asyncFramePool()
+{
+    static AsyncFramePool pool;
+    return pool;
+}
+
+/**--------------------------------------------------------------------------------------
+ * Task Promise
+ *-------------------------------------------------------------------------------------*/
+
+// State of one coroutine frame, reached from its handle
+struct AsyncPromise
+{
+    AsyncExecutor *executor;
+    AsyncPromise *next;                 // Run queue or waiting list link
+    std::coroutine_handle<> caller;     // Task awaiting this one, none for a started task
+    WheelTimer timer;                   // sleep_ms() and until() timeouts
+    bool (*poll)(void *context);        // until() predicate while waiting
+    void *pollContext;
+    bool timedOut;
+
+    AsyncPromise() : executor(nullptr), next(nullptr), caller(), poll(nullptr), pollContext(nullptr), timedOut(false) {}
+
+    std::coroutine_handle<AsyncPromise> handle() { return std::coroutine_handle<AsyncPromise>::from_promise(*this); }
+
+    // Frames live in the pool, a nullptr makes the call give get_return_object_on_allocation_failure()
+    static void *operator new(size_t size) noexcept { return asyncFramePool().allocate(size); }
+    static void operator delete(void *frame) noexcept { asyncFramePool().release(frame); }
+    static AsyncTask get_return_object_on_allocation_failure() noexcept;
+
+    AsyncTask get_return_object() noexcept;
+    std::suspend_always initial_suspend() const noexcept { return {}; } // Runs from start() or co_await
+
+    // Goes back to the awaiting task, a started task ends and frees its frame
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<AsyncPromise> handle) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+/**--------------------------------------------------------------------------------------
+ * Task Class
+ *-------------------------------------------------------------------------------------*/
+
+// Return type of a coroutine. Owns its frame until it is started or awaited.
+class AsyncTask
+{
+private:
+    friend class AsyncExecutor;
+
+    std::coroutine_handle<AsyncPromise> handle;
+
+    std::coroutine_handle<AsyncPromise> release()
+    {
+        std::coroutine_handle<AsyncPromise> released = handle;
+        handle = nullptr;
+        return released;
+    }
+
+public:
+    using promise_type = AsyncPromise;
+
+    AsyncTask() : handle(nullptr) {}
+    explicit AsyncTask(std::coroutine_handle<AsyncPromise> handle) : handle(handle) {}
+    AsyncTask(AsyncTask &&other) noexcept : handle(other.release()) {}
+    AsyncTask(const AsyncTask &) = delete;
+    AsyncTask &operator=(const AsyncTask &) = delete;
+
+    AsyncTask &operator=(AsyncTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = other.release();
+        }
+        return *this;
+    }
+
+    ~AsyncTask()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    // False when the frame pool had no block for it
+    bool isValid() const { return static_cast<bool>(handle); }
+    bool isDone() const { return handle && handle.done(); }
+
+    // co_await runs the task straight away and resumes the caller when it ends. An invalid task
+    // does not suspend the caller and gives false.
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<AsyncPromise> caller) noexcept
+    {
+        handle.promise().executor = caller.promise().executor;
+        handle.promise().caller = caller;
+        return handle;
+    }
+
+    bool await_resume() const noexcept { return static_cast<bool>(handle); }
+};
+
+inline AsyncTask AsyncPromise::get_return_object() noexcept { return AsyncTask(handle()); }
+inline AsyncTask AsyncPromise::get_return_object_on_allocation_failure() noexcept { return AsyncTask(); }
+
+/**--------------------------------------------------------------------------------------
+ * Executor Class
+ *-------------------------------------------------------------------------------------*/
+
+class AsyncExecutor
+{
+private:
+    friend struct AsyncPromise;
+    friend struct AsyncSleep;
+    template <typename Predicate>
+    friend struct AsyncUntil;
+
+    TimerWheel<TimerWheelMillis> &wheel;
+    AsyncPromise *readyHead; // Run queue, resumed in order by the next run()
+    AsyncPromise *readyTail;
+    AsyncPromise *waiting; // until() tasks, polled every run()
+    size_t running;        // Started tasks not ended yet
+
+    void ready(AsyncPromise &promise)
+    {
+        promise.next = nullptr;
+        if (readyTail != nullptr)
+        {
+            readyTail->next = &promise;
+        }
+        else
+        {
+            readyHead = &promise;
+        }
+        readyTail = &promise;
+    }
+
+    static void wake(void *context)
+    {
+        AsyncPromise *promise = static_cast<AsyncPromise *>(context);
+        promise->executor->ready(*promise);
+    }
+
+    static void timeOut(void *context) { static_cast<AsyncPromise *>(context)->timedOut = true; }
+
+    // Resumes on the next run(), or ms after the tick run() updated the wheel to
+    void sleep(AsyncPromise &promise, uint32_t ms)
+    {
+        if (ms == 0)
+        {
+            ready(promise);
+            return;
+        }
+        promise.timer.setCallback(wake, &promise);
+        wheel.scheduleAt(promise.timer, wheel.now() + ms);
+    }
+
+    void wait(AsyncPromise &promise, bool (*poll)(void *), void *context, uint32_t timeoutMs)
+    {
+        promise.poll = poll;
+        promise.pollContext = context;
+        promise.timedOut = false;
+        promise.next = waiting;
+        waiting = &promise;
+        if (timeoutMs != 0)
+        {
+            promise.timer.setCallback(timeOut, &promise);
+            wheel.scheduleAt(promise.timer, wheel.now() + timeoutMs);
+        }
+    }
+
+    // Moves the waiting tasks whose predicate holds or whose timeout passed to the run queue
+    void pollWaiting()
+    {
+        AsyncPromise **link = &waiting;
+        while (*link != nullptr)
+        {
+            AsyncPromise &promise = **link;
+            if (promise.poll(promise.pollContext))
+            {
+                promise.timedOut = false;
+            }
+            else if (!promise.timedOut)
+            {
+                link = &promise.next;
+                continue;
+            }
+            *link = promise.next;
+            wheel.cancel(promise.timer);
+            promise.poll = nullptr;
+            ready(promise);
+        }
+    }
+
+public:
+    explicit AsyncExecutor(TimerWheel<TimerWheelMillis> &wheel = timerWheel())
+        : wheel(wheel), readyHead(nullptr), readyTail(nullptr), waiting(nullptr), running(0) {}
+
+    AsyncExecutor(const AsyncExecutor &) = delete;
+    AsyncExecutor &operator=(const AsyncExecutor &) = delete;
+
+    // Queues a task to run from the next run(), false when it is invalid or already started
+    bool start(AsyncTask &&task)
+    {
+        if (!task.isValid() || task.isDone())
+        {
+            return false;
+        }
+        AsyncPromise &promise = task.release().promise();
+        promise.executor = this;
+        running++;
+        ready(promise);
+        return true;
+    }
+
+    // Updates the wheel, polls until() predicates and resumes every task ready by then. Tasks
+    // made ready while they run wait for the next call. Call it from loop().
+    void run(uint32_t now = TimerWheelMillis::now())
+    {
+        wheel.update(now);
+        pollWaiting();
+        AsyncPromise *promise = readyHead;
+        readyHead = nullptr;
+        readyTail = nullptr;
+        while (promise != nullptr)
+        {
+            AsyncPromise *next = promise->next; // The frame may end and be freed by resume()
+            promise->handle().resume();
+            promise = next;
+        }
+    }
+
+    // Ms run() can wait without delaying a task, 0 while tasks are ready or polling
+    uint32_t timeToNext(uint32_t now = TimerWheelMillis::now()) const
+    {
+        return readyHead != nullptr || waiting != nullptr ? 0 : wheel.timeToNext(now);
+    }
+
+    size_t size() const { return running; } // Started tasks not ended yet
+};
+
+inline std::coroutine_handle<> AsyncPromise::FinalAwaiter::await_suspend(std::coroutine_handle<AsyncPromise> handle) noexcept
+{
+    AsyncPromise &promise = handle.promise();
+    if (promise.caller)
+    {
+        return promise.caller; // The caller's AsyncTask frees this frame
+    }
+    if (promise.executor != nullptr)
+    {
+        promise.executor->running--;
+    }
+    handle.destroy();
+    return std::noop_coroutine();
+}
+
+// Executor behind the examples, runs on the shared timerWheel()
+inline AsyncExecutor &asyncExecutor()
+{
+    static AsyncExecutor executor;
+    return executor;
+}
+
+/**--------------------------------------------------------------------------------------
+ * Awaiters
+ *-------------------------------------------------------------------------------------*/
+
+struct AsyncSleep
+{
+    uint32_t ms;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<AsyncPromise> handle) const { handle.promise().executor->sleep(handle.promise(), ms); }
+    void await_resume() const noexcept {}
+};
+
+template <typename Predicate>
+struct AsyncUntil
+{
+    Predicate predicate;
+    uint32_t timeoutMs;
+    AsyncPromise *promise;
+
+    static bool check(void *context) { return static_cast<AsyncUntil *>(context)->predicate(); }
+
+    bool await_ready() { return predicate(); }
+
+    void await_suspend(std::coroutine_handle<AsyncPromise> handle)
+    {
+        promise = &handle.promise();
+        promise->executor->wait(*promise, check, this, timeoutMs);
+    }
+
+    // False when the timeout passed before the predicate held
+    bool await_resume() const noexcept { return promise == nullptr || !promise->timedOut; }
+};
+
+// Resumes ms after the current run(), 0 yields to the other tasks until the next run()
+inline AsyncSleep sleep_ms(uint32_t ms)
+{
+    return AsyncSleep{ms};
+}
+
+// Resumes once predicate() is true, gives false when timeoutMs passed first, 0 waits forever.
+// The predicate is called once right away, then once per run().
+template <typename Predicate>
+AsyncUntil<Predicate> until(Predicate predicate, uint32_t timeoutMs = 0)
+{
+    return AsyncUntil<Predicate>{predicate, timeoutMs, nullptr};
+}
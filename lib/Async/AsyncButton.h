@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Button.h>
+#include "Async.h"
+
+/**--------------------------------------------------------------------------------------
+ * Async Button
+ *
+ * Button whose events are awaited from an AsyncTask instead of checked in loop():
+ *
+ *   AsyncButton button(2);
+ *
+ *   AsyncTask menu()
+ *   {
+ *       co_await button.clicked();
+ *       if (!co_await button.doubleClicked(3000))
+ *       {
+ *           ...
+ *       }
+ *   }
+ *
+ * Each awaiter checks the button once per AsyncExecutor::run(), so do not call check() in
+ * loop() as well. The bool queries of Button are still there as Button::clicked() and so on.
+ *-------------------------------------------------------------------------------------*/
+
+class AsyncButton : public Button
+{
+public:
+    using Button::Button;
+
+    // Each one resumes on its event, or gives false once timeoutMs passed, 0 waits forever
+    auto clicked(uint32_t timeoutMs = 0)
+    {
+        return until([this]
+                     { check(); return singleClicked(); }, timeoutMs);
+    }
+
+    auto doubleClicked(uint32_t timeoutMs = 0)
+    {
+        return until([this]
+                     { check(); return Button::doubleClicked(); }, timeoutMs);
+    }
+
+    auto pressed(uint32_t timeoutMs = 0)
+    {
+        return until([this]
+                     { check(); return Button::pressed(); }, timeoutMs);
+    }
+
+    auto released(uint32_t timeoutMs = 0)
+    {
+        return until([this]
+                     { check(); return Button::released(); }, timeoutMs);
+    }
+
+    auto longPressed(uint32_t timeoutMs = 0)
+    {
+        return until([this]
+                     { check(); return Button::longPressed(); }, timeoutMs);
+    }
+};
@@ -42,6 +42,11 @@ bool Button::clicked()
     return clickedChecked;
 }
 
+bool Button::singleClicked()
+{
+    return (state.is(CLICKED) && clickCount == 1);
+}
+
 bool Button::doubleClicked()
 {
     return (state.is(CLICKED) && clickCount == 2);
@@ -94,6 +94,7 @@ public:
     void setLongPressDelay(uint16_t longPressDelayMs) { longPressDelay = longPressDelayMs; }
 
     bool clicked();
+    bool singleClicked(); // clicked() without checking the button, for callers that call check() themselves
     bool doubleClicked();
     bool tripleClicked();
     bool pressed();
@@ -50,10 +50,11 @@ static uint16_t crc_table[256] = {
  * Calculates a 16 bit CRC based on the x^16 + x^12 + x^5 + 1 polynomial
  * \param data Pointer to the start of a char array (c style string)
  * \param length The number of characters in the data array
+ * \param seed The CRC of the bytes before data, to calculate one CRC over several pieces
  */
-uint16_t calculateCRC16(uint8_t *data, uint16_t length)
+uint16_t calculateCRC16(uint8_t *data, uint16_t length, uint16_t seed)
 {
-    uint32_t crc = UINT16_MAX;
+    uint32_t crc = seed;
     uint32_t temp = 0;
 
     for (uint16_t i = 0; i < length; i++)
@@ -65,6 +66,7 @@ uint16_t calculateCRC16(uint8_t *data, uint16_t length)
     return (uint16_t)crc;
 }
 
+#if defined(ARDUINO)
 /**
  * Calculates a 16 bit CRC based on the x^16 + x^12 + x^5 + 1 polynomial
  * \param data Arduino string
@@ -93,4 +95,5 @@ bool checkCRC16(String &data)
     uint16_t calculatedCRC = calculateCRC16(dataWithoutCRC);
     uint16_t messageCRC = (uint16_t)data.substring(data.length() - 4).toInt(); // CRC is 16-bit, maximum of 4 characters
     return (messageCRC == calculatedCRC);
-}
\ No newline at end of file
+}
+#endif
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <stdint.h>
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 
-uint16_t calculateCRC16(uint8_t *data, uint16_t length);
+uint16_t calculateCRC16(uint8_t *data, uint16_t length, uint16_t seed = UINT16_MAX);
+#if defined(ARDUINO)
 uint16_t calculateCRC16(String &data);
-bool checkCRC16(String &data);
\ No newline at end of file
+bool checkCRC16(String &data);
+#endif
\ No newline at end of file
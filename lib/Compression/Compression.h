@@ -0,0 +1,400 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(ARDUINO)
+#include <Arduino.h>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * LZ Compression
+ *
+ * Streaming LZ77 in the style of heatshrink for logs, CSV and telemetry: push bytes in, pull
+ * compressed bytes out, with every buffer inside the object. Tokens are written MSB first:
+ *
+ *   literal    1 | byte (8 bits)
+ *   reference  0 | distance back, 1 to window - 1 (WindowBits) | length - 1 (LookaheadBits)
+ *   sync       0 | distance 0 (WindowBits), then zero bits up to the next byte
+ *
+ * flush() encodes everything pushed so far and ends it with a sync, so the decoder gives back
+ * every byte pushed before it. The window carries on across a sync, so a stream can be synced
+ * after each record and keep most of its ratio. Readers start at the beginning of a stream.
+ *
+ *   LzEncoder  2 << WindowBits bytes of history and input, 3 << WindowBits bytes of match index
+ *   LzDecoder  1 << WindowBits bytes of history and InputSize bytes of input
+ *
+ * Not thread safe, lock around a shared encoder or decoder.
+ *-------------------------------------------------------------------------------------*/
+
+template <uint8_t WindowBits = 8, uint8_t LookaheadBits = 4>
+class LzEncoder
+{
+private:
+    static_assert(WindowBits >= 4 && WindowBits <= 12, "WindowBits must be 4 to 12");
+    static_assert(LookaheadBits >= 3 && LookaheadBits < WindowBits && LookaheadBits <= 8, "LookaheadBits must be 3 to 8 and less than WindowBits");
+
+    static const uint16_t windowSize = 1 << WindowBits;
+    static const uint16_t maxMatch = 1 << LookaheadBits;
+    static const uint8_t referenceBits = 1 + WindowBits + LookaheadBits;
+    static const uint8_t minMatch = referenceBits / 9 + 1 > 2 ? referenceBits / 9 + 1 : 2; // Shortest reference smaller than its literals
+    static const uint8_t hashBits = WindowBits - 1;
+    static const uint8_t maxChain = 16; // Most earlier positions compared for one match
+
+    uint8_t buffer[2 * windowSize];     // History, then input not encoded yet
+    uint16_t head[1 << hashBits];       // Latest position + 1 of each two byte hash, 0 for none
+    uint16_t previous[windowSize];      // Earlier position + 1 with the same hash, by position % windowSize
+    uint16_t position;                  // Next byte to encode
+    uint16_t fill;                      // Bytes in buffer
+    uint16_t flushEnd;                  // Bytes to encode before the sync while flushing
+    uint32_t bits;                      // Encoded bits not pulled yet, in the low bitCount bits
+    uint8_t bitCount;
+    bool flushing;
+    bool synced; // No tokens since the last sync
+
+    static uint16_t hash(uint8_t a, uint8_t b)
+    {
+        return static_cast<uint16_t>((((static_cast<uint32_t>(a) << 8) | b) * 2654435761u) >> (32 - hashBits));
+    }
+
+    void writeBits(uint32_t value, uint8_t count)
+    {
+        bits = (bits << count) | value;
+        bitCount += count;
+    }
+
+    // Adds a position to the match index, the last byte waits for the next one
+    void insert(uint16_t at)
+    {
+        if (at + 1 < fill)
+        {
+            uint16_t &latest = head[hash(buffer[at], buffer[at + 1])];
+            previous[at & (windowSize - 1)] = latest;
+            latest = at + 1;
+        }
+    }
+
+    // Longest earlier match for the bytes at position, up to limit bytes
+    uint16_t findMatch(uint16_t limit, uint16_t &distance) const
+    {
+        uint16_t best = 0;
+        uint16_t candidate = head[hash(buffer[position], buffer[position + 1])];
+        for (uint8_t chain = 0; candidate != 0 && chain < maxChain; chain++)
+        {
+            uint16_t at = candidate - 1;
+            if (position - at >= windowSize)
+            {
+                break;
+            }
+            if (buffer[at + best] == buffer[position + best])
+            {
+                uint16_t length = 0;
+                while (length < limit && buffer[at + length] == buffer[position + length])
+                {
+                    length++;
+                }
+                if (length > best)
+                {
+                    best = length;
+                    distance = position - at;
+                    if (length == limit)
+                    {
+                        break;
+                    }
+                }
+            }
+            candidate = previous[at & (windowSize - 1)];
+        }
+        return best;
+    }
+
+    void encodeNext(uint16_t end)
+    {
+        uint16_t limit = end - position < maxMatch ? end - position : maxMatch;
+        uint16_t distance = 0;
+        uint16_t length = limit >= minMatch ? findMatch(limit, distance) : 0;
+        if (length >= minMatch)
+        {
+            writeBits(distance, 1 + WindowBits);
+            writeBits(length - 1, LookaheadBits);
+        }
+        else
+        {
+            length = 1;
+            writeBits(0x100 | buffer[position], 9);
+        }
+        for (uint16_t i = 0; i < length; i++)
+        {
+            insert(position++);
+        }
+        synced = false;
+    }
+
+    // Drops the oldest window of history once too little room is left for the lookahead. Only
+    // depends on position, so the output is the same for any push and pull sizes.
+    void slide()
+    {
+        if (position < sizeof(buffer) - maxMatch)
+        {
+            return;
+        }
+        memmove(buffer, buffer + windowSize, fill - windowSize);
+        position -= windowSize;
+        fill -= windowSize;
+        flushEnd = flushEnd > windowSize ? flushEnd - windowSize : 0;
+        for (uint16_t &at : head)
+        {
+            at = at > windowSize ? at - windowSize : 0;
+        }
+        for (uint16_t &at : previous)
+        {
+            at = at > windowSize ? at - windowSize : 0;
+        }
+    }
+
+public:
+    LzEncoder() { reset(); }
+
+    // Starts a new stream
+    void reset()
+    {
+        memset(head, 0, sizeof(head));
+        memset(previous, 0, sizeof(previous));
+        position = 0;
+        fill = 0;
+        flushEnd = 0;
+        bits = 0;
+        bitCount = 0;
+        flushing = false;
+        synced = true;
+    }
+
+    // Takes bytes to compress, returns how many fit. Pull and push the rest when it is short.
+    size_t push(const uint8_t *data, size_t size)
+    {
+        slide();
+        size_t room = sizeof(buffer) - fill;
+        size_t taken = size < room ? size : room;
+        memcpy(buffer + fill, data, taken);
+        fill += static_cast<uint16_t>(taken);
+        return taken;
+    }
+
+    // Compressed bytes into out, returns how many. 0 once the input needs more lookahead or a flush.
+    size_t pull(uint8_t *out, size_t capacity)
+    {
+        size_t produced = 0;
+        while (produced < capacity)
+        {
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                out[produced++] = static_cast<uint8_t>(bits >> bitCount);
+            }
+            else if (fill - position > maxMatch || (flushing && position < flushEnd))
+            {
+                slide();
+                encodeNext(fill - position > maxMatch ? fill : flushEnd); // Short matches only at the end of a flush
+            }
+            else if (flushing)
+            {
+                if (!synced)
+                {
+                    writeBits(0, 1 + WindowBits);
+                    writeBits(0, (8 - bitCount % 8) % 8);
+                    synced = true;
+                }
+                flushing = false;
+            }
+            else
+            {
+                break;
+            }
+        }
+        return produced;
+    }
+
+    // Encodes what was pushed and ends it with a sync, pull until 0 to get it
+    void flush()
+    {
+        flushing = true;
+        flushEnd = fill;
+    }
+};
+
+template <uint8_t WindowBits = 8, uint8_t LookaheadBits = 4, size_t InputSize = 32>
+class LzDecoder
+{
+private:
+    static_assert(WindowBits >= 4 && WindowBits <= 12, "WindowBits must be 4 to 12");
+    static_assert(LookaheadBits >= 3 && LookaheadBits < WindowBits && LookaheadBits <= 8, "LookaheadBits must be 3 to 8 and less than WindowBits");
+    static_assert(InputSize > 0, "InputSize must be at least 1");
+
+    static const uint16_t windowSize = 1 << WindowBits;
+    static const uint8_t referenceBits = 1 + WindowBits + LookaheadBits;
+
+    uint8_t window[windowSize]; // The latest bytes given back, by output position % windowSize
+    uint8_t input[InputSize];
+    size_t inputStart;
+    size_t inputEnd;
+    uint16_t written;   // Output position % windowSize
+    uint16_t distance;  // Of the reference being copied
+    uint16_t remaining; // Bytes of the reference still to copy
+    uint32_t bits;      // Input bits not decoded yet, in the low bitCount bits
+    uint8_t bitCount;
+
+    // True once count bits are loaded
+    bool needBits(uint8_t count)
+    {
+        while (bitCount < count && inputStart < inputEnd)
+        {
+            bits = (bits << 8) | input[inputStart++];
+            bitCount += 8;
+        }
+        return bitCount >= count;
+    }
+
+    uint32_t peekBits(uint8_t count) const { return (bits >> (bitCount - count)) & ((1ul << count) - 1); }
+
+    uint32_t takeBits(uint8_t count)
+    {
+        uint32_t value = peekBits(count);
+        bitCount -= count;
+        return value;
+    }
+
+    uint8_t put(uint8_t c)
+    {
+        window[written] = c;
+        written = (written + 1) & (windowSize - 1);
+        return c;
+    }
+
+public:
+    LzDecoder() { reset(); }
+
+    // Starts a new stream
+    void reset()
+    {
+        memset(window, 0, sizeof(window));
+        inputStart = 0;
+        inputEnd = 0;
+        written = 0;
+        distance = 0;
+        remaining = 0;
+        bits = 0;
+        bitCount = 0;
+    }
+
+    // Takes compressed bytes, returns how many fit. Pull and push the rest when it is short.
+    size_t push(const uint8_t *data, size_t size)
+    {
+        if (inputStart > 0)
+        {
+            memmove(input, input + inputStart, inputEnd - inputStart);
+            inputEnd -= inputStart;
+            inputStart = 0;
+        }
+        size_t room = InputSize - inputEnd;
+        size_t taken = size < room ? size : room;
+        memcpy(input + inputEnd, data, taken);
+        inputEnd += taken;
+        return taken;
+    }
+
+    // Decompressed bytes into out, returns how many. 0 once it needs more input.
+    size_t pull(uint8_t *out, size_t capacity)
+    {
+        size_t produced = 0;
+        while (produced < capacity)
+        {
+            if (remaining > 0)
+            {
+                out[produced++] = put(window[(written - distance) & (windowSize - 1)]);
+                remaining--;
+            }
+            else if (!needBits(1))
+            {
+                break;
+            }
+            else if (peekBits(1) == 1)
+            {
+                if (!needBits(9))
+                {
+                    break;
+                }
+                out[produced++] = put(static_cast<uint8_t>(takeBits(9)));
+            }
+            else if (!needBits(1 + WindowBits))
+            {
+                break;
+            }
+            else if (peekBits(1 + WindowBits) == 0)
+            {
+                takeBits(1 + WindowBits);
+                bitCount -= bitCount % 8; // Sync, the rest of the byte is padding
+            }
+            else if (!needBits(referenceBits))
+            {
+                break;
+            }
+            else
+            {
+                uint32_t token = takeBits(referenceBits);
+                distance = static_cast<uint16_t>((token >> LookaheadBits) & (windowSize - 1));
+                remaining = static_cast<uint16_t>((token & ((1 << LookaheadBits) - 1)) + 1);
+            }
+        }
+        return produced;
+    }
+};
+
+#if defined(ARDUINO)
+// Compresses everything printed to it into another Print, e.g. a CSV export to a File or Serial.
+// flush() syncs, so the output decodes up to the last byte printed.
+//
+//   LzPrint<> compressed(file);
+//   compressed.print(csvText);
+//   compressed.flush();
+template <uint8_t WindowBits = 8, uint8_t LookaheadBits = 4>
+class LzPrint : public Print
+{
+private:
+    Print &out;
+    LzEncoder<WindowBits, LookaheadBits> encoder;
+
+    void drain()
+    {
+        uint8_t chunk[32];
+        size_t size;
+        while ((size = encoder.pull(chunk, sizeof(chunk))) > 0)
+        {
+            out.write(chunk, size);
+        }
+    }
+
+public:
+    explicit LzPrint(Print &out) : out(out) {}
+
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+            done += encoder.push(data + done, size - done);
+            drain();
+        }
+        return size;
+    }
+
+    void flush() override
+    {
+        encoder.flush();
+        drain();
+        out.flush();
+    }
+};
+#endif
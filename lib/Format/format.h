@@ -19,7 +19,18 @@
 #endif
 
 #include <type_traits>
+#include <utility>
 #include <string>
+#include <string.h>
+#include <stdint.h>
+// Cores without an atomic exchange (AVR, Cortex-M0 such as RP2040 and SAMD21) claim pool slots
+// with interrupts off instead, std::atomic<bool> there needs libatomic
+#if defined(__AVR__) || defined(__ARM_ARCH_6M__)
+#define AFMT_POOL_IRQ_CLAIM 1
+#else
+#define AFMT_POOL_IRQ_CLAIM 0
+#include <atomic>
+#endif
 
 // Define macros for compiler detection
 #if defined(__GNUC__)
@@ -62,6 +73,87 @@
 #endif
 static_assert(AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE > 0, "AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE must be greater than 0");
 
+// Feature profiles, each AFMT_USE_* switch below can also be set on its own
+#define AFMT_PROFILE_MINIMAL 0  // Integers (d, x), strings, chars, bools, fixed floats, width, fill, < > and 0 padding
+#define AFMT_PROFILE_STANDARD 1 // MINIMAL + sign, '#', binary, octal and center alignment
+#define AFMT_PROFILE_FULL 2     // STANDARD + exponent and general float notation
+
+#ifndef AFMT_PROFILE
+#define AFMT_PROFILE AFMT_PROFILE_FULL
+#endif
+static_assert(AFMT_PROFILE >= AFMT_PROFILE_MINIMAL && AFMT_PROFILE <= AFMT_PROFILE_FULL, "AFMT_PROFILE must be AFMT_PROFILE_MINIMAL, AFMT_PROFILE_STANDARD or AFMT_PROFILE_FULL");
+
+// Sign options (+, -, space) and the '#' alternate form
+#ifndef AFMT_USE_SIGN
+#define AFMT_USE_SIGN (AFMT_PROFILE >= AFMT_PROFILE_STANDARD)
+#endif
+
+// '^' center alignment, falls back to right alignment when disabled
+#ifndef AFMT_USE_CENTER_ALIGN
+#define AFMT_USE_CENTER_ALIGN (AFMT_PROFILE >= AFMT_PROFILE_STANDARD)
+#endif
+
+// 'b', 'B' and 'o' integer presentation, falls back to decimal when disabled
+#ifndef AFMT_USE_BIN_OCT
+#define AFMT_USE_BIN_OCT (AFMT_PROFILE >= AFMT_PROFILE_STANDARD)
+#endif
+
+// 'e', 'g' and general {} float notation. When disabled every float is fixed and {} prints up to
+// 6 decimals with trailing zeros removed.
+#ifndef AFMT_USE_EXP_FLOAT
+#define AFMT_USE_EXP_FLOAT (AFMT_PROFILE >= AFMT_PROFILE_FULL)
+#endif
+
+// Float formatting mode
+#define AFMT_FLOAT_MODE_DOUBLE 0 // Digits from double arithmetic
+#define AFMT_FLOAT_MODE_FIXED 1  // Digits from 32-bit integer arithmetic, for targets without an FPU
+
+#ifndef AFMT_FLOAT_MODE
+#define AFMT_FLOAT_MODE AFMT_FLOAT_MODE_DOUBLE
+#endif
+
+// Most fraction digits produced with 32-bit integer arithmetic, further digits are printed as zeros
+#ifndef AFMT_FIXED_MAX_PRECISION
+#define AFMT_FIXED_MAX_PRECISION 6
+#endif
+static_assert(AFMT_FIXED_MAX_PRECISION >= 0 && AFMT_FIXED_MAX_PRECISION <= 9, "AFMT_FIXED_MAX_PRECISION must be between 0 and 9");
+
+// Reuse heap storage across format()/aformat() calls through buffer_pool::local()
+#ifndef AFMT_USE_BUFFER_POOL
+#if defined(__AVR__)
+#define AFMT_USE_BUFFER_POOL 0
+#else
+#define AFMT_USE_BUFFER_POOL 1
+#endif
+#endif
+
+// Buffers a pool can lend out at once, further acquires get a plain buffer
+#ifndef AFMT_BUFFER_POOL_SLOTS
+#define AFMT_BUFFER_POOL_SLOTS 2
+#endif
+static_assert(AFMT_BUFFER_POOL_SLOTS > 0, "AFMT_BUFFER_POOL_SLOTS must be greater than 0");
+
+// Largest storage kept on release, bigger storage is freed so one huge line does not pin memory
+#ifndef AFMT_BUFFER_POOL_MAX_RETAINED
+#define AFMT_BUFFER_POOL_MAX_RETAINED 1024
+#endif
+
+// Read F() and PROGMEM format strings with pgm_read_byte, needed where flash is a separate address space (AVR).
+// Elsewhere flash is memory mapped and a flash format string is parsed in place like any other.
+#ifndef AFMT_USE_PROGMEM_READ
+#if defined(__AVR__)
+#define AFMT_USE_PROGMEM_READ 1
+#else
+#define AFMT_USE_PROGMEM_READ 0
+#endif
+#endif
+
+// Largest replacement field "{...}" of a flash format string, each field is copied to the stack to parse it
+#ifndef AFMT_PROGMEM_FIELD_SIZE
+#define AFMT_PROGMEM_FIELD_SIZE 24
+#endif
+static_assert(AFMT_PROGMEM_FIELD_SIZE >= 4, "AFMT_PROGMEM_FIELD_SIZE must be at least 4");
+
 // ================= Arduino FMT ==================
 
 AFMT_BEGIN_NAMESPACE
@@ -175,39 +267,66 @@ public:
 // 1. Small Buffer Optimization (SBO): Uses internal static storage for small strings
 // 2. Heap allocation: Dynamically allocates memory for larger strings
 // 3. External buffer: Uses pre-allocated external memory with fixed capacity
+// 4. Stream: Uses internal static storage as a chunk, handing it to a flush function whenever it fills up
+// 5. Counting: Stores nothing and only counts the characters written
+
+// Tag selecting the counting buffer constructor
+struct counting_mode
+{
+};
+
 class buffer
 {
+public:
+    // Receives each filled chunk in stream mode
+    typedef void (*flush_fn)(void *context, const char *data, size_t size);
+
 private:
     enum class buffer_mode
     {
         internal_static,
         internal_heap,
-        external_static
+        external_static,
+        internal_stream,
+        counting
     };
 
     char storage_[AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE];
     char *data_; // Points to internal heap, internal or external buffer
     size_t size_;
     size_t capacity_;
+    size_t count_; // Characters written since the last clear, including flushed or truncated ones
+    flush_fn flush_;
+    void *flush_context_;
     buffer_mode mode_;
     bool truncated_;
 
 public:
     // Default constructor - adaptive mode with SBO
     buffer()
-        : data_(storage_), size_(0), capacity_(AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE),
-          mode_(buffer_mode::internal_static), truncated_(false) {}
+        : data_(storage_), size_(0), capacity_(AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE), count_(0),
+          flush_(nullptr), flush_context_(nullptr), mode_(buffer_mode::internal_static), truncated_(false) {}
 
     // External buffer constructor
     buffer(char *ext_data, size_t ext_capacity)
-        : data_(ext_data), size_(0), capacity_(ext_capacity),
-          mode_(buffer_mode::external_static), truncated_(false) {}
+        : data_(ext_data), size_(0), capacity_(ext_capacity), count_(0),
+          flush_(nullptr), flush_context_(nullptr), mode_(buffer_mode::external_static), truncated_(false) {}
 
     // External buffer constructor for C-style arrays
     template <size_t N_arr>
     buffer(char (&arr)[N_arr])
-        : data_(arr), size_(0), capacity_(N_arr),
-          mode_(buffer_mode::external_static), truncated_(false) {}
+        : data_(arr), size_(0), capacity_(N_arr), count_(0),
+          flush_(nullptr), flush_context_(nullptr), mode_(buffer_mode::external_static), truncated_(false) {}
+
+    // Stream buffer constructor - SBO storage is flushed to fn whenever it fills and on flush()
+    buffer(flush_fn fn, void *context)
+        : data_(storage_), size_(0), capacity_(AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE), count_(0),
+          flush_(fn), flush_context_(context), mode_(buffer_mode::internal_stream), truncated_(false) {}
+
+    // Counting buffer constructor - no storage, only count() is meaningful
+    explicit buffer(counting_mode)
+        : data_(nullptr), size_(0), capacity_(0), count_(0),
+          flush_(nullptr), flush_context_(nullptr), mode_(buffer_mode::counting), truncated_(false) {}
 
     ~buffer()
     {
@@ -223,10 +342,11 @@ public:
 
     // Move constructor
     buffer(buffer &&other) noexcept
-        : size_(other.size_), capacity_(other.capacity_),
+        : size_(other.size_), capacity_(other.capacity_), count_(other.count_),
+          flush_(other.flush_), flush_context_(other.flush_context_),
           mode_(other.mode_), truncated_(other.truncated_)
     {
-        if (mode_ == buffer_mode::internal_static)
+        if (mode_ == buffer_mode::internal_static || mode_ == buffer_mode::internal_stream)
         {
             for (size_t i = 0; i < size_; ++i)
             {
@@ -248,6 +368,9 @@ public:
         other.data_ = other.storage_;
         other.size_ = 0;
         other.capacity_ = AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE;
+        other.count_ = 0;
+        other.flush_ = nullptr;
+        other.flush_context_ = nullptr;
         other.mode_ = buffer_mode::internal_static;
         other.truncated_ = false;
     }
@@ -266,10 +389,13 @@ public:
             // Move from other
             size_ = other.size_;
             capacity_ = other.capacity_;
+            count_ = other.count_;
+            flush_ = other.flush_;
+            flush_context_ = other.flush_context_;
             mode_ = other.mode_;
             truncated_ = other.truncated_;
 
-            if (mode_ == buffer_mode::internal_static)
+            if (mode_ == buffer_mode::internal_static || mode_ == buffer_mode::internal_stream)
             {
                 for (size_t i = 0; i < size_; ++i)
                 {
@@ -291,6 +417,9 @@ public:
             other.data_ = other.storage_;
             other.size_ = 0;
             other.capacity_ = AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE;
+            other.count_ = 0;
+            other.flush_ = nullptr;
+            other.flush_context_ = nullptr;
             other.mode_ = buffer_mode::internal_static;
             other.truncated_ = false;
         }
@@ -300,17 +429,30 @@ public:
     AFMT_CONSTEXPR bool is_sbo() const { return mode_ == buffer_mode::internal_static; }
     AFMT_CONSTEXPR bool is_external() const { return mode_ == buffer_mode::external_static; }
     AFMT_CONSTEXPR bool is_heap() const { return mode_ == buffer_mode::internal_heap; }
+    AFMT_CONSTEXPR bool is_stream() const { return mode_ == buffer_mode::internal_stream; }
+    AFMT_CONSTEXPR bool is_counting() const { return mode_ == buffer_mode::counting; }
 
     char *data() { return data_; }
     AFMT_CONSTEXPR const char *data() const { return data_; }
     AFMT_CONSTEXPR size_t size() const { return size_; }
     AFMT_CONSTEXPR size_t capacity() const { return capacity_; }
+    AFMT_CONSTEXPR size_t count() const { return count_; }
     AFMT_CONSTEXPR bool is_truncated() const { return truncated_; }
 
+    // Hands any pending content to the flush function (stream mode only)
+    void flush()
+    {
+        if (mode_ == buffer_mode::internal_stream && size_ > 0)
+        {
+            flush_(flush_context_, data_, size_);
+            size_ = 0;
+        }
+    }
+
     char *c_str()
     {
         // null is all ready added
-        if (buffer_mode::external_static == mode_)
+        if (buffer_mode::external_static == mode_ || buffer_mode::internal_stream == mode_ || buffer_mode::counting == mode_)
         {
             return data_;
         }
@@ -328,14 +470,47 @@ public:
     void clear()
     {
         size_ = 0;
+        count_ = 0;
         truncated_ = false;
         // Note: Does not shrink capacity or change mode back to SBO from heap.
         // To release heap and go back to SBO, a dedicated shrink_to_fit or reset method would be needed.
     }
 
+    // Takes ownership of heap storage from a pool, returns false (storage not taken) unless the buffer is empty SBO
+    bool adopt(char *heap_data, size_t heap_capacity)
+    {
+        if (mode_ != buffer_mode::internal_static || size_ != 0 || heap_data == nullptr)
+        {
+            return false;
+        }
+        data_ = heap_data;
+        capacity_ = heap_capacity;
+        mode_ = buffer_mode::internal_heap;
+        return true;
+    }
+
+    // Gives up heap storage for reuse and returns to empty SBO mode, returns nullptr when not on the heap
+    char *release(size_t &released_capacity)
+    {
+        char *released = nullptr;
+        released_capacity = 0;
+        if (mode_ == buffer_mode::internal_heap)
+        {
+            released = data_;
+            released_capacity = capacity_;
+            data_ = storage_;
+            capacity_ = AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE;
+            mode_ = buffer_mode::internal_static;
+        }
+        size_ = 0;
+        count_ = 0;
+        truncated_ = false;
+        return released;
+    }
+
     void reserve(size_t new_capacity)
     {
-        if (mode_ == buffer_mode::external_static || new_capacity <= capacity_)
+        if ((mode_ != buffer_mode::internal_static && mode_ != buffer_mode::internal_heap) || new_capacity <= capacity_)
         {
             return;
         }
@@ -368,6 +543,16 @@ public:
 
     void push_back(const char &value)
     {
+        ++count_;
+        if (mode_ == buffer_mode::counting)
+        {
+            return;
+        }
+        if (size_ >= capacity_ && mode_ == buffer_mode::internal_stream)
+        {
+            flush();
+        }
+
         if (size_ >= capacity_)
         {
             if (mode_ == buffer_mode::external_static)
@@ -404,6 +589,33 @@ public:
         if (count == 0)
             return;
 
+        count_ += count;
+        if (mode_ == buffer_mode::counting)
+        {
+            return;
+        }
+        if (mode_ == buffer_mode::internal_stream)
+        {
+            // Copy chunk by chunk, flushing each time the chunk fills up
+            while (count > 0)
+            {
+                if (size_ >= capacity_)
+                {
+                    flush();
+                }
+                size_t available_space = capacity_ - size_;
+                size_t num_to_copy = count > available_space ? available_space : count;
+                for (size_t i = 0; i < num_to_copy; ++i)
+                {
+                    data_[size_ + i] = begin[i];
+                }
+                size_ += num_to_copy;
+                begin += num_to_copy;
+                count -= num_to_copy;
+            }
+            return;
+        }
+
         if (size_ + count > capacity_)
         {
             if (mode_ == buffer_mode::external_static)
@@ -484,6 +696,229 @@ public:
     }
 };
 
+// =============== Buffer Pool ===============
+
+// Pools hand out buffers that keep their heap storage between uses, so long output stops
+// allocating after warm-up. buffer_pool::local() is per thread on the host, per core on ESP32 and
+// RP2040 and a single pool elsewhere. Slots are claimed atomically, stats are best effort under contention.
+
+struct buffer_pool_stats
+{
+    uint32_t acquired;    // Buffers handed out
+    uint32_t reused;      // Handed out with warm storage
+    uint32_t allocations; // Uses that had to grow on the heap
+    uint32_t discarded;   // Storage freed on release for exceeding max_retained
+    uint32_t exhausted;   // Acquires with every slot busy, served by a plain buffer
+    size_t peak_size;     // Largest output seen
+
+    AFMT_CONSTEXPR buffer_pool_stats()
+        : acquired(0), reused(0), allocations(0), discarded(0), exhausted(0), peak_size(0) {}
+};
+
+class buffer_pool
+{
+private:
+    struct slot
+    {
+#if AFMT_POOL_IRQ_CLAIM
+        volatile bool busy;
+#else
+        std::atomic<bool> busy;
+#endif
+        char *data;
+        size_t capacity;
+    };
+
+    slot slots_[AFMT_BUFFER_POOL_SLOTS];
+    size_t max_retained_;
+    buffer_pool_stats stats_;
+
+    bool try_claim(slot &s)
+    {
+#if AFMT_POOL_IRQ_CLAIM
+        noInterrupts();
+        bool claimed = !s.busy;
+        s.busy = true;
+        interrupts();
+        return claimed;
+#else
+        return !s.busy.exchange(true, std::memory_order_acquire);
+#endif
+    }
+
+    void unclaim(slot &s)
+    {
+#if AFMT_POOL_IRQ_CLAIM
+        s.busy = false;
+#else
+        s.busy.store(false, std::memory_order_release);
+#endif
+    }
+
+public:
+    explicit buffer_pool(size_t max_retained = AFMT_BUFFER_POOL_MAX_RETAINED)
+        : max_retained_(max_retained)
+    {
+        for (int i = 0; i < AFMT_BUFFER_POOL_SLOTS; ++i)
+        {
+            slots_[i].busy = false;
+            slots_[i].data = nullptr;
+            slots_[i].capacity = 0;
+        }
+    }
+
+    ~buffer_pool()
+    {
+        for (int i = 0; i < AFMT_BUFFER_POOL_SLOTS; ++i)
+        {
+            delete[] slots_[i].data;
+        }
+    }
+
+    buffer_pool(const buffer_pool &) = delete;
+    buffer_pool &operator=(const buffer_pool &) = delete;
+
+    // Pool of the calling thread or core
+    static buffer_pool &local();
+
+    // Claims a slot and moves its storage into buf, which must be an empty default buffer.
+    // Returns the slot index to pass to release(), or -1 when every slot is busy.
+    int acquire(buffer &buf)
+    {
+        ++stats_.acquired;
+        for (int i = 0; i < AFMT_BUFFER_POOL_SLOTS; ++i)
+        {
+            if (try_claim(slots_[i]))
+            {
+                if (slots_[i].data != nullptr && buf.adopt(slots_[i].data, slots_[i].capacity))
+                {
+                    slots_[i].data = nullptr;
+                    ++stats_.reused;
+                }
+                return i;
+            }
+        }
+        ++stats_.exhausted;
+        return -1;
+    }
+
+    // Takes the storage back from buf and frees the slot
+    void release(buffer &buf, int index)
+    {
+        if (buf.size() > stats_.peak_size)
+        {
+            stats_.peak_size = buf.size();
+        }
+        if (index < 0)
+        {
+            return;
+        }
+
+        slot &s = slots_[index];
+        size_t capacity = 0;
+        char *data = buf.release(capacity);
+        if (data != nullptr && capacity > s.capacity)
+        {
+            ++stats_.allocations;
+        }
+        if (data != nullptr && capacity > max_retained_)
+        {
+            delete[] data;
+            data = nullptr;
+            capacity = 0;
+            ++stats_.discarded;
+        }
+        // adopt() turns the slot storage down for a buffer that is not empty, the slot still holds it then
+        if (s.data != nullptr && s.data != data)
+        {
+            if (data == nullptr || capacity <= s.capacity)
+            {
+                delete[] data;
+                unclaim(s);
+                return;
+            }
+            delete[] s.data;
+        }
+        s.data = data;
+        s.capacity = capacity;
+        unclaim(s);
+    }
+
+    // Frees the storage of every idle slot
+    void shrink_to_fit()
+    {
+        for (int i = 0; i < AFMT_BUFFER_POOL_SLOTS; ++i)
+        {
+            if (try_claim(slots_[i]))
+            {
+                delete[] slots_[i].data;
+                slots_[i].data = nullptr;
+                slots_[i].capacity = 0;
+                unclaim(slots_[i]);
+            }
+        }
+    }
+
+    // Storage above this size is freed on release instead of kept
+    void set_max_retained(size_t max_retained) { max_retained_ = max_retained; }
+    size_t max_retained() const { return max_retained_; }
+
+    // Bytes held by idle slots
+    size_t retained() const
+    {
+        size_t total = 0;
+        for (int i = 0; i < AFMT_BUFFER_POOL_SLOTS; ++i)
+        {
+            total += slots_[i].data != nullptr ? slots_[i].capacity : 0;
+        }
+        return total;
+    }
+
+    const buffer_pool_stats &stats() const { return stats_; }
+    void reset_stats() { stats_ = buffer_pool_stats(); }
+};
+
+inline buffer_pool &buffer_pool::local()
+{
+#if defined(ESP32)
+    static buffer_pool pools[portNUM_PROCESSORS];
+    return pools[xPortGetCoreID()];
+#elif defined(ARDUINO_ARCH_RP2040)
+    static buffer_pool pools[2];
+    return pools[rp2040.cpuid()];
+#elif AFMT_HAS_ARDUINO
+    static buffer_pool pool;
+    return pool;
+#else
+    static thread_local buffer_pool pool;
+    return pool;
+#endif
+}
+
+// Buffer borrowed from a pool for one scope, the storage goes back to the pool on destruction
+class pooled_buffer
+{
+private:
+    buffer_pool &pool_;
+    buffer buffer_;
+    int slot_;
+
+public:
+    explicit pooled_buffer(buffer_pool &pool = buffer_pool::local())
+        : pool_(pool), buffer_(), slot_(pool.acquire(buffer_)) {}
+
+    ~pooled_buffer()
+    {
+        pool_.release(buffer_, slot_);
+    }
+
+    pooled_buffer(const pooled_buffer &) = delete;
+    pooled_buffer &operator=(const pooled_buffer &) = delete;
+
+    buffer &get() { return buffer_; }
+    operator buffer &() { return buffer_; }
+};
+
 // =============== Format Specifications ===============
 
 // Basic format specifications
@@ -593,7 +1028,11 @@ AFMT_CONSTEXPR inline align parse_align(char c)
     case '>':
         return align::right;
     case '^':
+#if AFMT_USE_CENTER_ALIGN
         return align::center;
+#else
+        return align::right;
+#endif
     default:
         return align::none;
     }
@@ -630,8 +1069,10 @@ inline const char *parse_format_specs(
     // Parse sign
     if (c == '+' || c == '-' || c == ' ')
     {
+#if AFMT_USE_SIGN
         specs.set_sign(c == '+' ? sign::plus : c == '-' ? sign::minus
                                                         : sign::space);
+#endif
         ++begin;
         if (begin == end)
             return begin;
@@ -641,7 +1082,9 @@ inline const char *parse_format_specs(
     // Parse alternate form
     if (c == '#')
     {
+#if AFMT_USE_SIGN
         specs.set_alt();
+#endif
         ++begin;
         if (begin == end)
             return begin;
@@ -695,6 +1138,7 @@ inline const char *parse_format_specs(
             specs.set_type(presentation_type::hex);
             specs.set_upper();
             break;
+#if AFMT_USE_BIN_OCT
         case 'o':
             specs.set_type(presentation_type::oct);
             break;
@@ -705,6 +1149,8 @@ inline const char *parse_format_specs(
             specs.set_type(presentation_type::bin);
             specs.set_upper();
             break;
+#endif
+#if AFMT_USE_EXP_FLOAT
         case 'e':
             specs.set_type(presentation_type::exp);
             break;
@@ -712,6 +1158,7 @@ inline const char *parse_format_specs(
             specs.set_type(presentation_type::exp);
             specs.set_upper();
             break;
+#endif
         case 'f':
             specs.set_type(presentation_type::fixed);
             break;
@@ -719,6 +1166,7 @@ inline const char *parse_format_specs(
             specs.set_type(presentation_type::fixed);
             specs.set_upper();
             break;
+#if AFMT_USE_EXP_FLOAT
         case 'g':
             specs.set_type(presentation_type::general);
             break;
@@ -726,6 +1174,7 @@ inline const char *parse_format_specs(
             specs.set_type(presentation_type::general);
             specs.set_upper();
             break;
+#endif
         case 'c':
             specs.set_type(presentation_type::chr);
             break;
@@ -756,22 +1205,66 @@ struct monostate
     AFMT_CONSTEXPR monostate() {}
 };
 
+// =============== User-Defined Formatters ===============
+
+// Specialize formatter<T> to format your own types. parse() receives the spec after ':' (or the
+// closing '}' for "{}") and returns the position of the closing '}'. format() writes straight to out.
+//
+//   template <>
+//   struct afmt::formatter<Point>
+//   {
+//       const char *parse(const char *begin, const char *end) { return begin; }
+//       void format(const Point &p, buffer &out) const { format_to(out, "({}, {})", p.x, p.y); }
+//   };
+template <typename T, typename Enable = void>
+struct formatter
+{
+    formatter() = delete; // No formatter for this type
+};
+
+template <typename T>
+struct has_formatter : std::is_default_constructible<formatter<T>>
+{
+};
+
+// Class types with a formatter are passed by reference and formatted through it
+template <typename T>
+struct is_custom_formattable : std::integral_constant<bool, std::is_class<T>::value &&
+                                                                 !std::is_same<T, string_view>::value &&
+                                                                 has_formatter<T>::value>
+{
+};
+
+// Formats a type-erased custom value, returns the position of the closing '}'
+typedef const char *(*custom_format_fn)(const void *value, const char *begin, const char *end, buffer &out);
+
+struct custom_value
+{
+    const void *value;
+    custom_format_fn format;
+};
+
+template <typename T>
+const char *format_custom_arg(const void *value, const char *begin, const char *end, buffer &out);
+
 // Type-erased formatting argument value - forward declaration
 class format_arg_value;
 
-// A collection of formatting arguments
+// A view over a packed argument store: one 4-bit type tag per argument and the argument values
+// packed back to back, each taking only the bytes its type needs
 class format_args
 {
 private:
-    const format_arg_value *args_;
+    const unsigned char *types_;
+    const unsigned char *data_;
     int count_;
 
 public:
-    AFMT_CONSTEXPR format_args() : args_(nullptr), count_(0) {}
-    AFMT_CONSTEXPR format_args(const format_arg_value *args, int count)
-        : args_(args), count_(count) {}
+    AFMT_CONSTEXPR format_args() : types_(nullptr), data_(nullptr), count_(0) {}
+    AFMT_CONSTEXPR format_args(const unsigned char *types, const unsigned char *data, int count)
+        : types_(types), data_(data), count_(count) {}
 
-    AFMT_CONSTEXPR format_arg_value get(int id) const;
+    format_arg_value get(int id) const;
     AFMT_CONSTEXPR int max_size() const { return count_; }
 };
 
@@ -792,7 +1285,8 @@ public:
         double_type,
         cstring_type,
         string_type,
-        pointer_type
+        pointer_type,
+        custom_type
     };
 
     AFMT_CONSTEXPR format_arg_value() : type_(type::none_type) {}
@@ -823,8 +1317,55 @@ public:
         value_.pointer_value = static_cast<const void *>(value);
     }
 
+    // Class types with a formatter<T> specialization
+    template <typename T,
+              typename = typename std::enable_if<is_custom_formattable<T>::value>::type>
+    AFMT_CONSTEXPR format_arg_value(const T &value) : type_(type::custom_type)
+    {
+        value_.custom.value = &value;
+        value_.custom.format = &format_custom_arg<T>;
+    }
+
     AFMT_CONSTEXPR type get_type() const { return type_; }
 
+    // Number of bytes the value of a given type occupies in a packed argument store
+    static constexpr size_t packed_size(type t)
+    {
+        return t == type::int_type ? sizeof(int) :
+               t == type::uint_type ? sizeof(unsigned) :
+               t == type::long_long_type ? sizeof(long long) :
+               t == type::ulong_long_type ? sizeof(unsigned long long) :
+               t == type::bool_type ? sizeof(bool) :
+               t == type::char_type ? sizeof(char) :
+               t == type::float_type ? sizeof(float) :
+               t == type::double_type ? sizeof(double) :
+               t == type::cstring_type ? sizeof(const char *) :
+               t == type::string_type ? sizeof(string_view_data) :
+               t == type::pointer_type ? sizeof(const void *) :
+               t == type::custom_type ? sizeof(custom_value) :
+                                        0;
+    }
+
+    // Copies the active union member into a packed store, every member starts at offset 0
+    void pack(unsigned char *dest) const
+    {
+        memcpy(dest, &value_, packed_size(type_));
+    }
+
+    static format_arg_value unpack(type t, const unsigned char *src)
+    {
+        format_arg_value arg;
+        arg.type_ = t;
+        memcpy(&arg.value_, src, packed_size(t));
+        return arg;
+    }
+
+    // Parses the spec at begin and formats a custom value, returns the position of the closing '}'
+    const char *format_custom(const char *begin, const char *end, buffer &out) const
+    {
+        return value_.custom.format(value_.custom.value, begin, end, out);
+    }
+
     // Modified to avoid using 'auto' return type
     template <typename Visitor>
     AFMT_CONSTEXPR typename std::result_of<Visitor(monostate)>::type visit(Visitor &&vis) const
@@ -856,6 +1397,8 @@ public:
                                    value_.sv_data.size));
         case type::pointer_type:
             return vis(value_.pointer_value);
+        case type::custom_type:
+            return vis(value_.custom);
         }
         return vis(monostate{});
     }
@@ -882,51 +1425,352 @@ private:
         const char *string_value;
         string_view_data sv_data; // Renamed to avoid naming conflict
         const void *pointer_value;
+        custom_value custom;
 
         AFMT_CONSTEXPR value() : int_value(0) {}
     } value_;
 };
 
-// Implementation of format_args::get
-AFMT_CONSTEXPR inline format_arg_value format_args::get(int id) const
+static_assert(static_cast<int>(format_arg_value::type::custom_type) < 16, "Type tags must fit in 4 bits");
+
+// Compile-time type tag of an argument, mirrors the format_arg_value constructor overloads
+template <format_arg_value::type T>
+struct arg_tag : std::integral_constant<format_arg_value::type, T>
 {
-    if (id < count_)
-        return args_[id];
-    return format_arg_value();
-}
+};
 
-// =============== Conversion Functions ===============
+arg_tag<format_arg_value::type::int_type> arg_type_of(int);
+arg_tag<format_arg_value::type::uint_type> arg_type_of(unsigned);
+arg_tag<format_arg_value::type::long_long_type> arg_type_of(long);
+arg_tag<format_arg_value::type::ulong_long_type> arg_type_of(unsigned long);
+arg_tag<format_arg_value::type::long_long_type> arg_type_of(long long);
+arg_tag<format_arg_value::type::ulong_long_type> arg_type_of(unsigned long long);
+arg_tag<format_arg_value::type::bool_type> arg_type_of(bool);
+arg_tag<format_arg_value::type::char_type> arg_type_of(char);
+arg_tag<format_arg_value::type::float_type> arg_type_of(float);
+arg_tag<format_arg_value::type::double_type> arg_type_of(double);
+arg_tag<format_arg_value::type::cstring_type> arg_type_of(const char *);
+arg_tag<format_arg_value::type::string_type> arg_type_of(string_view);
+arg_tag<format_arg_value::type::pointer_type> arg_type_of(const void *);
+
+template <typename T,
+          typename = typename std::enable_if<std::is_pointer<T>::value &&
+                                             !std::is_same<T, const char *>::value>::type>
+arg_tag<format_arg_value::type::pointer_type> arg_type_of(T);
+
+template <typename T,
+          typename = typename std::enable_if<is_custom_formattable<T>::value>::type>
+arg_tag<format_arg_value::type::custom_type> arg_type_of(const T &);
 
-// Convert integer to string
 template <typename T>
-void to_string(T value, buffer &out, format_specs specs)
+struct arg_type : decltype(arg_type_of(std::declval<const T &>()))
 {
-    // Handle special case of 0
-    if (value == 0)
-    {
-        out.push_back('0');
-        return;
-    }
+};
 
-    // Determine base based on type
-    int base = 10;
-    if (specs.type == presentation_type::hex)
-        base = 16;
-    else if (specs.type == presentation_type::oct)
-        base = 8;
-    else if (specs.type == presentation_type::bin)
-        base = 2;
+// Total packed size of an argument pack
+template <typename... Args>
+struct packed_args_size;
 
-    // Handle negative numbers for signed types
-    bool negative = false;
-    if (std::is_signed<T>::value && value < 0)
+template <>
+struct packed_args_size<> : std::integral_constant<size_t, 0>
+{
+};
+
+template <typename T, typename... Args>
+struct packed_args_size<T, Args...>
+    : std::integral_constant<size_t, format_arg_value::packed_size(arg_type<T>::value) +
+                                         packed_args_size<Args...>::value>
+{
+};
+
+// Implementation of format_args::get
+inline format_arg_value format_args::get(int id) const
+{
+    if (id < 0 || id >= count_)
+        return format_arg_value();
+
+    // Walk the tags to find the value offset, argument counts are small so this stays cheap
+    size_t offset = 0;
+    for (int i = 0; i < id; ++i)
     {
-        negative = true;
-        value = -value;
+        offset += format_arg_value::packed_size(
+            static_cast<format_arg_value::type>((types_[i >> 1] >> ((i & 1) * 4)) & 0x0F));
     }
+    format_arg_value::type t = static_cast<format_arg_value::type>((types_[id >> 1] >> ((id & 1) * 4)) & 0x0F);
+    return format_arg_value::unpack(t, data_ + offset);
+}
 
-    // Convert to string (in reverse)
+// =============== Fixed-Point Values ===============
+
+// Q-format value raw / 2^FracBits, e.g. q<16>(raw) for Q15.16
+template <int FracBits>
+struct q_value
+{
+    static_assert(FracBits >= 0 && FracBits <= 28, "Q-format supports 0 to 28 fraction bits");
+    int32_t raw;
+};
+
+template <int FracBits>
+AFMT_CONSTEXPR q_value<FracBits> q(int32_t raw)
+{
+    return {raw};
+}
+
+// Scaled integer value / 10^decimals, e.g. scaled(2345, 2) for 23.45
+struct scaled_value
+{
+    int32_t value;
+    uint8_t decimals;
+};
+
+AFMT_CONSTEXPR inline scaled_value scaled(int32_t value, uint8_t decimals)
+{
+    return {value, decimals};
+}
+
+template <typename T>
+struct is_fixed_point : std::false_type
+{
+};
+
+template <int FracBits>
+struct is_fixed_point<q_value<FracBits>> : std::true_type
+{
+};
+
+template <>
+struct is_fixed_point<scaled_value> : std::true_type
+{
+};
+
+inline uint32_t pow10_u32(int n)
+{
+    static const uint32_t table[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    return table[n];
+}
+
+inline void write_sign(buffer &out, bool negative, const format_specs &specs)
+{
+    if (negative)
+        out.push_back('-');
+#if AFMT_USE_SIGN
+    else if (specs.sign_option == sign::plus)
+        out.push_back('+');
+    else if (specs.sign_option == sign::space)
+        out.push_back(' ');
+#else
+    (void)specs;
+#endif
+}
+
+// Writes int_part.frac where frac holds `digits` decimal digits. Precision past the digits is
+// filled with zeros, trim drops trailing zeros instead.
+inline void write_fixed(buffer &out, uint32_t int_part, uint32_t frac, int digits, int precision, bool trim)
+{
+    char text[10];
+    int n = 0;
+    do
+    {
+        text[n++] = static_cast<char>('0' + int_part % 10);
+        int_part /= 10;
+    } while (int_part != 0);
+    while (n > 0)
+    {
+        out.push_back(text[--n]);
+    }
+
+    for (int i = digits - 1; i >= 0; --i)
+    {
+        text[i] = static_cast<char>('0' + frac % 10);
+        frac /= 10;
+    }
+    if (trim)
+    {
+        while (digits > 0 && text[digits - 1] == '0')
+            --digits;
+        precision = digits;
+    }
+    if (precision > 0)
+    {
+        out.push_back('.');
+        out.append(text, text + digits);
+        for (int i = digits; i < precision; ++i)
+            out.push_back('0');
+    }
+}
+
+// "{}" trims trailing zeros, "{:.3}" or "{:.3f}" prints exactly 3 fraction digits, "{:f}" prints 2
+inline int fixed_point_precision(const format_specs &specs, int default_digits)
+{
+    if (specs.precision >= 0)
+        return specs.precision;
+    return specs.type == presentation_type::fixed ? 2 : default_digits;
+}
+
+// Q-format digits come from shifting the fraction bits, one multiply by 10 per digit
+template <int FracBits>
+void to_string(q_value<FracBits> value, buffer &out, format_specs specs)
+{
+    const uint32_t mask = (static_cast<uint32_t>(1) << FracBits) - 1;
+    bool negative = value.raw < 0;
+    uint32_t magnitude = negative ? 0u - static_cast<uint32_t>(value.raw) : static_cast<uint32_t>(value.raw);
+    write_sign(out, negative, specs);
+
+    // log10(2) ~ 77/256 digits per fraction bit
+    int precision = fixed_point_precision(specs, (FracBits * 77 + 255) / 256);
+    int digits = precision < AFMT_FIXED_MAX_PRECISION ? precision : AFMT_FIXED_MAX_PRECISION;
+    bool trim = specs.precision < 0 && specs.type != presentation_type::fixed;
+
+    uint32_t int_part = magnitude >> FracBits;
+    uint32_t rest = magnitude & mask;
+    uint32_t frac = 0;
+    for (int i = 0; i < digits; ++i)
+    {
+        rest *= 10;
+        frac = frac * 10 + (rest >> FracBits);
+        rest &= mask;
+    }
+
+    // Round half up on the remaining bits
+    if ((rest << 1) > mask)
+    {
+        if (++frac >= pow10_u32(digits))
+        {
+            frac = 0;
+            ++int_part;
+        }
+    }
+    write_fixed(out, int_part, frac, digits, precision, trim);
+}
+
+// Scaled integers keep all their decimals by default
+inline void to_string(scaled_value value, buffer &out, format_specs specs)
+{
+    bool negative = value.value < 0;
+    uint32_t magnitude = negative ? 0u - static_cast<uint32_t>(value.value) : static_cast<uint32_t>(value.value);
+    write_sign(out, negative, specs);
+
+    int decimals = value.decimals < 9 ? value.decimals : 9;
+    int precision = specs.precision >= 0 ? specs.precision : decimals;
+    int digits = precision < 9 ? precision : 9;
+
+    uint32_t int_part = magnitude / pow10_u32(decimals);
+    uint32_t frac = magnitude % pow10_u32(decimals);
+    if (digits < decimals)
+    {
+        uint32_t divisor = pow10_u32(decimals - digits);
+        frac = (frac + divisor / 2) / divisor;
+        if (frac >= pow10_u32(digits))
+        {
+            frac = 0;
+            ++int_part;
+        }
+    }
+    else
+    {
+        frac *= pow10_u32(digits - decimals);
+    }
+    write_fixed(out, int_part, frac, digits, precision, false);
+}
+
+#if AFMT_FLOAT_MODE == AFMT_FLOAT_MODE_FIXED
+// Formats a positive double using 32-bit integer digit generation: one subtract and one multiply
+// instead of soft-float math per digit. Returns false for what it does not cover ('e', values of
+// 4e9 and up, general notation that switches to an exponent), which then takes the double path.
+inline bool to_string_fixed_mode(double value, buffer &out, const format_specs &specs)
+{
+    if (specs.type == presentation_type::exp || !(value < 4.0e9))
+        return false;
+
+    uint32_t int_part = static_cast<uint32_t>(value);
+    int precision;
+    bool trim = false;
+
+    if (specs.type == presentation_type::none || specs.type == presentation_type::general)
+    {
+        int p = specs.precision >= 0 ? specs.precision : 6;
+        if (p == 0)
+            p = 1;
+
+        // Decimal exponent without dividing
+        int exp_val = 0;
+        if (int_part > 0)
+        {
+            while (exp_val < 9 && int_part >= pow10_u32(exp_val + 1))
+                ++exp_val;
+        }
+        else if (value >= 1e-1)
+            exp_val = -1;
+        else if (value >= 1e-2)
+            exp_val = -2;
+        else if (value >= 1e-3)
+            exp_val = -3;
+        else if (value >= 1e-4)
+            exp_val = -4;
+        else
+            return false;
+
+        if (exp_val >= p)
+            return false;
+        precision = p - 1 - exp_val;
+        trim = true;
+    }
+    else
+    {
+        precision = specs.precision >= 0 ? specs.precision : 2;
+    }
+
+    int digits = precision < AFMT_FIXED_MAX_PRECISION ? precision : AFMT_FIXED_MAX_PRECISION;
+    uint32_t scale = pow10_u32(digits);
+    uint32_t frac = static_cast<uint32_t>((value - int_part) * scale + 0.5);
+    if (frac >= scale)
+    {
+        frac -= scale;
+        ++int_part;
+    }
+    write_fixed(out, int_part, frac, digits, precision, trim);
+    return true;
+}
+#endif
+
+// =============== Conversion Functions ===============
+
+// Convert integer to string
+template <typename T>
+void to_string(T value, buffer &out, format_specs specs)
+{
+    // Handle special case of 0
+    if (value == 0)
+    {
+        out.push_back('0');
+        return;
+    }
+
+    // Determine base based on type
+    int base = 10;
+    if (specs.type == presentation_type::hex)
+        base = 16;
+#if AFMT_USE_BIN_OCT
+    else if (specs.type == presentation_type::oct)
+        base = 8;
+    else if (specs.type == presentation_type::bin)
+        base = 2;
+#endif
+
+    // Handle negative numbers for signed types
+    bool negative = false;
+    if (std::is_signed<T>::value && value < 0)
+    {
+        negative = true;
+        value = -value;
+    }
+
+    // Convert to string (in reverse)
+#if AFMT_USE_BIN_OCT
     char buffer[64]; // Large enough for 64-bit integers in any base
+#else
+    char buffer[20]; // Large enough for 64-bit integers in decimal or hex
+#endif
     int pos = 0;
 
     while (value > 0)
@@ -948,6 +1792,7 @@ void to_string(T value, buffer &out, format_specs specs)
     {
         out.push_back('-');
     }
+#if AFMT_USE_SIGN
     else if (specs.sign_option == sign::plus)
     {
         out.push_back('+');
@@ -975,6 +1820,7 @@ void to_string(T value, buffer &out, format_specs specs)
             out.push_back('0');
         }
     }
+#endif
 
     // Output the digits in correct order
     for (int i = pos - 1; i >= 0; --i)
@@ -983,6 +1829,41 @@ void to_string(T value, buffer &out, format_specs specs)
     }
 }
 
+// Appends fixed notation text without trailing fractional zeros, and without the decimal point if nothing follows
+inline void append_trimmed(buffer &out, const buffer &fixed)
+{
+    size_t len = fixed.size();
+    const char *data = fixed.data();
+
+    // Find decimal point
+    size_t decimal_pos = len;
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (data[i] == '.')
+        {
+            decimal_pos = i;
+            break;
+        }
+    }
+
+    if (decimal_pos < len)
+    {
+        // Remove trailing zeros after decimal point
+        while (len > decimal_pos + 1 && data[len - 1] == '0')
+        {
+            len--;
+        }
+
+        // Remove decimal point if no fractional part remains
+        if (len == decimal_pos + 1)
+        {
+            len--;
+        }
+    }
+
+    out.append(data, data + len);
+}
+
 // Convert float to string
 inline void to_string(double value, buffer &out, format_specs specs)
 {
@@ -1065,6 +1946,7 @@ inline void to_string(double value, buffer &out, format_specs specs)
         out.push_back('-');
         value = -value;
     }
+#if AFMT_USE_SIGN
     else if (specs.sign_option == sign::plus)
     {
         out.push_back('+');
@@ -1073,7 +1955,14 @@ inline void to_string(double value, buffer &out, format_specs specs)
     {
         out.push_back(' ');
     }
+#endif
 
+#if AFMT_FLOAT_MODE == AFMT_FLOAT_MODE_FIXED
+    if (to_string_fixed_mode(value, out, specs))
+        return;
+#endif
+
+#if AFMT_USE_EXP_FLOAT
     // Default type for float/double - use general format behavior
     if (specs.type == presentation_type::none)
     {
@@ -1139,49 +2028,33 @@ inline void to_string(double value, buffer &out, format_specs specs)
             if (fixed_specs.precision < 0)
                 fixed_specs.precision = 0;
 
-            // Format with fixed notation
+            // Format with fixed notation, then remove trailing zeros and decimal point if not needed
             buffer temp;
             to_string(value, temp, fixed_specs);
-
-            // Remove trailing zeros and decimal point if not needed
-            size_t len = temp.size();
-            const char *data = temp.data();
-
-            // Find decimal point
-            size_t decimal_pos = len;
-            for (size_t i = 0; i < len; ++i)
-            {
-                if (data[i] == '.')
-                {
-                    decimal_pos = i;
-                    break;
-                }
-            }
-
-            if (decimal_pos < len)
-            {
-                // Remove trailing zeros after decimal point
-                while (len > decimal_pos + 1 && data[len - 1] == '0')
-                {
-                    len--;
-                }
-
-                // Remove decimal point if no fractional part remains
-                if (len == decimal_pos + 1)
-                {
-                    len--;
-                }
-            }
-
-            // Copy the trimmed result
-            out.append(data, data + len);
+            append_trimmed(out, temp);
         }
         return;
     }
+#else
+    // Without exponent notation every float is fixed, {} and g remove trailing zeros
+    if (specs.type != presentation_type::fixed)
+    {
+        format_specs fixed_specs = specs;
+        fixed_specs.type = presentation_type::fixed;
+        fixed_specs.sign_option = sign::none;
+        fixed_specs.precision = specs.precision >= 0 ? specs.precision : 6;
+
+        buffer temp;
+        to_string(value, temp, fixed_specs);
+        append_trimmed(out, temp);
+        return;
+    }
+#endif
 
     // Handle exp and fixed formatting
     int precision = specs.precision >= 0 ? specs.precision : 2;
 
+#if AFMT_USE_EXP_FLOAT
     if (specs.type == presentation_type::exp)
     {
         int exponent = 0;
@@ -1266,6 +2139,7 @@ inline void to_string(double value, buffer &out, format_specs specs)
         out.push_back('0' + (exponent % 10));
     }
     else
+#endif
     {
         // Fixed point formatting
         if (precision >= 0)
@@ -1329,6 +2203,7 @@ inline void pad_before(buffer &out, int width, char fill, align alignment, int c
             out.push_back(fill);
         }
     }
+#if AFMT_USE_CENTER_ALIGN
     else if (alignment == align::center)
     {
         int left_padding = padding / 2;
@@ -1336,10 +2211,8 @@ inline void pad_before(buffer &out, int width, char fill, align alignment, int c
         {
             out.push_back(fill);
         }
-
-        // Right padding will be added after the content
-        padding -= left_padding;
     }
+#endif
     // For align::left, no padding is needed here
 }
 
@@ -1357,6 +2230,7 @@ inline void pad_after(buffer &out, int width, char fill, align alignment, int co
             out.push_back(fill);
         }
     }
+#if AFMT_USE_CENTER_ALIGN
     else if (alignment == align::center)
     {
         int right_padding = padding / 2 + padding % 2;
@@ -1365,6 +2239,7 @@ inline void pad_after(buffer &out, int width, char fill, align alignment, int co
             out.push_back(fill);
         }
     }
+#endif
     // For align::right, no padding is needed here
 }
 
@@ -1380,7 +2255,7 @@ void format_value(const T &value, buffer &out, format_specs specs)
     if (specs.alignment == align::none)
     {
         // Use template traits instead of if constexpr
-        if (std::is_arithmetic<T>::value && !std::is_same<T, char>::value)
+        if ((std::is_arithmetic<T>::value && !std::is_same<T, char>::value) || is_fixed_point<T>::value)
         {
             specs.alignment = align::right; // Numbers are right-aligned by default
         }
@@ -1395,7 +2270,7 @@ void format_value(const T &value, buffer &out, format_specs specs)
     // For non-numeric types, convert zero padding to space padding
     if (specs.fill == '0' && specs.alignment == align::numeric)
     {
-        if (!std::is_arithmetic<T>::value || std::is_same<T, char>::value)
+        if ((!std::is_arithmetic<T>::value || std::is_same<T, char>::value) && !is_fixed_point<T>::value)
         {
             // Not a numeric type that should use zero padding - convert to space padding
             specs.fill = ' ';
@@ -1510,7 +2385,10 @@ void format_value(const T &value, buffer &out, format_specs specs)
                                                        typename std::conditional<
                                                            std::is_same<T, const void *>::value,
                                                            std::integral_constant<int, 8>,
-                                                           std::integral_constant<int, 0>>::type>::type>::type>::type>::type>::type>::type > ::type());
+                                                           typename std::conditional<
+                                                               is_fixed_point<T>::value,
+                                                               std::integral_constant<int, 9>,
+                                                               std::integral_constant<int, 0>>::type>::type>::type>::type>::type>::type>::type>::type > ::type());
 }
 
 // Type dispatch helpers for format_value
@@ -1594,7 +2472,7 @@ void format_value_dispatch_impl(const T &value, buffer &out, format_specs specs,
     {
         out.push_back('0');
         out.push_back('x');
-        uint32_t ptr_val = reinterpret_cast<uint32_t>(value);
+        uintptr_t ptr_val = reinterpret_cast<uintptr_t>(value);
 
         // Create temporary specs for hex format
         format_specs ptr_specs;
@@ -1613,6 +2491,12 @@ void format_value_dispatch_impl(const T &value, buffer &out, format_specs specs,
     }
 }
 
+template <typename T>
+void format_value_dispatch_impl(const T &value, buffer &out, format_specs specs, std::integral_constant<int, 9>) // Fixed-point
+{
+    to_string(value, out, specs);
+}
+
 template <typename T>
 void format_value_dispatch_impl(const T &value, buffer &out, format_specs specs, std::integral_constant<int, 0>) // Fallback
 {
@@ -1638,8 +2522,212 @@ struct format_visitor_impl
     {
         // Nothing to format
     }
+
+    void operator()(const custom_value &custom)
+    {
+        static const char empty_spec[] = "}";
+        custom.format(custom.value, empty_spec, empty_spec + 1, out);
+    }
+};
+
+// =============== Built-in Formatters ===============
+
+template <typename T>
+struct is_builtin_formattable : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+                                                                 std::is_same<T, const char *>::value ||
+                                                                 std::is_same<T, char *>::value ||
+                                                                 std::is_same<T, string_view>::value ||
+                                                                 is_fixed_point<T>::value>
+{
+};
+
+// Maps a value to the type format_value() handles: enums to their underlying integer, char * to const char *
+template <typename T, typename Enable = void>
+struct builtin_format_type
+{
+    typedef T type;
+};
+
+template <typename T>
+struct builtin_format_type<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+    typedef typename std::underlying_type<T>::type type;
+};
+
+template <>
+struct builtin_format_type<char *>
+{
+    typedef const char *type;
+};
+
+// Formatter for built-in types. User formatters can inherit it to reuse the standard spec.
+template <typename T>
+struct formatter<T, typename std::enable_if<is_builtin_formattable<T>::value>::type>
+{
+    format_specs specs;
+
+    const char *parse(const char *begin, const char *end)
+    {
+        if (begin == end || *begin == '}')
+            return begin;
+
+        parse_context ctx(string_view(begin, static_cast<size_t>(end - begin)));
+        return parse_format_specs(begin, end, specs, ctx);
+    }
+
+    void format(const T &value, buffer &out) const
+    {
+        typedef typename builtin_format_type<T>::type format_type;
+        format_value(static_cast<format_type>(value), out, specs);
+    }
+};
+
+template <>
+struct formatter<std::string> : formatter<string_view>
+{
+    void format(const std::string &value, buffer &out) const
+    {
+        formatter<string_view>::format(string_view(value.data(), value.size()), out);
+    }
+};
+
+#if AFMT_HAS_ARDUINO
+template <>
+struct formatter<String> : formatter<string_view>
+{
+    void format(const String &value, buffer &out) const
+    {
+        formatter<string_view>::format(string_view(value.c_str(), value.length()), out);
+    }
+};
+#endif
+
+// =============== Range Formatters ===============
+
+// Detects types iterable with begin()/end() (Vector, Array, std::vector, ...) excluding strings
+template <typename T>
+class is_range
+{
+    template <typename U>
+    static auto test(int) -> decltype(std::declval<const U &>().begin() != std::declval<const U &>().end(), std::true_type());
+    template <typename>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<T>(0))::value && !std::is_same<T, std::string>::value
+#if AFMT_HAS_ARDUINO
+                                  && !std::is_same<T, String>::value
+#endif
+        ;
+};
+
+template <typename It>
+struct range_element
+{
+    typedef typename std::decay<decltype(*std::declval<It>())>::type type;
+};
+
+// Writes each element with the shared element formatter, separated by sep
+template <typename It, typename ElementFormatter>
+void format_range(It first, It last, string_view sep, const ElementFormatter &element_formatter, buffer &out)
+{
+    for (It it = first; it != last; ++it)
+    {
+        if (it != first)
+        {
+            out.append(sep.data(), sep.data() + sep.size());
+        }
+        element_formatter.format(*it, out);
+    }
+}
+
+// Ranges format as "[1, 2, 3]". Spec: [n][:element-spec], 'n' drops the brackets.
+// "{::.2f}" formats every element with ".2f".
+template <typename Range>
+struct formatter<Range, typename std::enable_if<is_range<Range>::value>::type>
+{
+    typedef decltype(std::declval<const Range &>().begin()) iterator;
+
+    formatter<typename range_element<iterator>::type> element_formatter;
+    bool brackets = true;
+
+    const char *parse(const char *begin, const char *end)
+    {
+        if (begin != end && *begin == 'n')
+        {
+            brackets = false;
+            ++begin;
+        }
+        if (begin != end && *begin == ':')
+        {
+            ++begin;
+        }
+        return element_formatter.parse(begin, end);
+    }
+
+    void format(const Range &range, buffer &out) const
+    {
+        if (brackets)
+            out.push_back('[');
+        format_range(range.begin(), range.end(), ", ", element_formatter, out);
+        if (brackets)
+            out.push_back(']');
+    }
+};
+
+// Range view returned by join(), the spec applies to every element
+template <typename It>
+struct join_view
+{
+    It first;
+    It last;
+    string_view sep;
+};
+
+template <typename It>
+struct formatter<join_view<It>>
+{
+    formatter<typename range_element<It>::type> element_formatter;
+
+    const char *parse(const char *begin, const char *end)
+    {
+        return element_formatter.parse(begin, end);
+    }
+
+    void format(const join_view<It> &view, buffer &out) const
+    {
+        format_range(view.first, view.last, view.sep, element_formatter, out);
+    }
 };
 
+// Joins the elements of a range with a separator: format("{:02x}", join(bytes, ":"))
+template <typename Range>
+AFMT_CONSTEXPR join_view<decltype(std::declval<const Range &>().begin())> join(const Range &range, string_view sep)
+{
+    return {range.begin(), range.end(), sep};
+}
+
+template <typename T, size_t N>
+AFMT_CONSTEXPR join_view<const T *> join(const T (&range)[N], string_view sep)
+{
+    return {range, range + N, sep};
+}
+
+template <typename It>
+AFMT_CONSTEXPR join_view<It> join(It first, It last, string_view sep)
+{
+    return {first, last, sep};
+}
+
+template <typename T>
+const char *format_custom_arg(const void *value, const char *begin, const char *end, buffer &out)
+{
+    formatter<T> f;
+    begin = f.parse(begin, end);
+    f.format(*static_cast<const T *>(value), out);
+    return begin;
+}
+
 // =============== Format String Parsing ===============
 
 // Parse a replacement field starting with '{'
@@ -1658,6 +2746,10 @@ inline const char *parse_replacement_field(const char *begin, const char *end,
     {
         // Empty replacement field '{}'
         auto arg = args.get(ctx.next_arg_id());
+        if (arg.get_type() == format_arg_value::type::custom_type)
+        {
+            return arg.format_custom(begin, end, out) + 1;
+        }
         format_specs specs;
         arg.visit(format_visitor_impl(out, specs));
         return begin + 1;
@@ -1685,6 +2777,16 @@ inline const char *parse_replacement_field(const char *begin, const char *end,
     if (begin == end)
         return begin;
 
+    auto arg = args.get(arg_id);
+    if (arg.get_type() == format_arg_value::type::custom_type)
+    {
+        // Custom formatters parse their own spec
+        if (*begin == ':')
+            ++begin;
+        begin = arg.format_custom(begin, end, out);
+        return begin == end ? begin : begin + 1;
+    }
+
     // Check for format specifiers
     format_specs specs;
     if (*begin == ':')
@@ -1700,7 +2802,6 @@ inline const char *parse_replacement_field(const char *begin, const char *end,
     }
 
     // Format the argument
-    auto arg = args.get(arg_id);
     arg.visit(format_visitor_impl(out, specs));
 
     return begin + 1;
@@ -1708,44 +2809,62 @@ inline const char *parse_replacement_field(const char *begin, const char *end,
 
 // =============== Argument Storage Helper ===============
 
-// format_arg_store_n holds N format_arg_value objects.
-// This allows make_format_args to return a structure containing the arguments
-// by value, ensuring their lifetime for the duration of the formatting call.
-template <size_t N_args>
-class format_arg_store_n
+// format_arg_store packs the arguments of one formatting call: a 4-bit type tag per argument and
+// the values back to back, sized at compile time from the argument types. An int takes 4 bytes
+// instead of a full format_arg_value, which keeps the stack small for calls with many arguments.
+// The store is returned by value so it lives for the duration of the formatting call.
+template <typename... Args>
+class format_arg_store
 {
 public:
-    format_arg_value arg_buffer_[N_args > 0 ? N_args : 1];
-    size_t count_;
+    static constexpr size_t num_args = sizeof...(Args);
+    static constexpr size_t data_size = packed_args_size<Args...>::value;
 
-    template <typename... ArgsPack>
-    AFMT_CONSTEXPR format_arg_store_n(const ArgsPack &...actual_args)
-        : arg_buffer_{format_arg_value(actual_args)...}, count_(N_args) {}
+    format_arg_store(const Args &...args) : types_(), data_()
+    {
+        pack_args(0, 0, args...);
+    }
 
     // Implicit conversion to format_args, providing a view into the stored arguments.
     AFMT_CONSTEXPR operator format_args() const
     {
-        return format_args(arg_buffer_, count_);
+        return get_args();
     }
 
     // Explicit conversion to format_args, providing a view into the stored arguments.
     AFMT_CONSTEXPR format_args get_args() const
     {
-        return format_args(arg_buffer_, count_);
+        return format_args(types_, data_, static_cast<int>(num_args));
+    }
+
+private:
+    unsigned char types_[num_args > 0 ? (num_args + 1) / 2 : 1];
+    unsigned char data_[data_size > 0 ? data_size : 1];
+
+    void pack_args(size_t, size_t) {}
+
+    template <typename T, typename... Rest>
+    void pack_args(size_t index, size_t offset, const T &arg, const Rest &...rest)
+    {
+        const format_arg_value::type t = arg_type<T>::value;
+        format_arg_value(arg).pack(data_ + offset);
+        types_[index >> 1] |= static_cast<unsigned char>(static_cast<unsigned>(t) << ((index & 1) * 4));
+        pack_args(index + 1, offset + format_arg_value::packed_size(t), rest...);
     }
 };
 
-// Helper to create format_arg_store_n from variadic template arguments.
+// Helper to create format_arg_store from variadic template arguments.
 template <typename... Args>
-AFMT_CONSTEXPR inline format_arg_store_n<sizeof...(Args)> make_format_args(const Args &...args)
+inline format_arg_store<Args...> make_format_args(const Args &...args)
 {
-    return format_arg_store_n<sizeof...(Args)>(args...);
+    return format_arg_store<Args...>(args...);
 }
 
 struct format_to_result
 {
     char *out;
     bool truncated;
+    size_t size; // Full untruncated size of the formatted output, excluding null terminator
 
     AFMT_CONSTEXPR operator char *() const
     {
@@ -1792,18 +2911,76 @@ inline void vformat_to(buffer &out, string_view fmt, format_args args)
     }
 }
 
+#if AFMT_HAS_ARDUINO
+// Parse a format string in flash, F("...") or a PROGMEM array cast to const __FlashStringHelper *.
+// With AFMT_USE_PROGMEM_READ the literal text is read a byte at a time and only the current replacement
+// field is copied to RAM, so the format string never needs an SRAM copy.
+inline void vformat_to(buffer &out, const __FlashStringHelper *fmt, format_args args)
+{
+#if AFMT_USE_PROGMEM_READ
+    parse_context ctx((string_view()));
+    const char *it = reinterpret_cast<const char *>(fmt);
+    char field[AFMT_PROGMEM_FIELD_SIZE];
+
+    for (char c = static_cast<char>(pgm_read_byte(it)); c != '\0'; c = static_cast<char>(pgm_read_byte(it)))
+    {
+        ++it;
+        if (c == '{')
+        {
+            // Copy "{...}" or an escaped "{{", a field too long for the stack copy is cut short
+            size_t n = 0;
+            field[n++] = '{';
+            for (char f = static_cast<char>(pgm_read_byte(it)); f != '\0'; f = static_cast<char>(pgm_read_byte(it)))
+            {
+                ++it;
+                if (n < sizeof(field))
+                {
+                    field[n++] = f;
+                }
+                if (f == '}' || (f == '{' && n == 2))
+                {
+                    break;
+                }
+            }
+            parse_replacement_field(field, field + n, ctx, args, out);
+        }
+        else if (c == '}')
+        {
+            // Escaped '}}' or unmatched '}', both output a single '}'
+            if (pgm_read_byte(it) == '}')
+            {
+                ++it;
+            }
+            out.push_back('}');
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+#else
+    vformat_to(out, string_view(reinterpret_cast<const char *>(fmt)), args);
+#endif
+}
+#endif
+
 // Core formatting function vformat_to_n
-inline format_to_result vformat_to_n(char *out, size_t n, string_view fmt, format_args args)
+template <typename S>
+inline format_to_result vformat_to_n(char *out, size_t n, const S &fmt, format_args args)
 {
     if (n == 0)
     {
-        return format_to_result{out, true}; // No space for anything, not even null.
+        // No space for anything, not even null. Still count so the caller can size its buffer.
+        buffer counter((counting_mode()));
+        vformat_to(counter, fmt, args);
+        return format_to_result{out, true, counter.count()};
     }
 
     buffer temp_buffer(out, n);         // Operates in external mode.
     vformat_to(temp_buffer, fmt, args); // Writes formatted string into `out` via `temp_buffer`. Does NOT null terminate.
 
     size_t content_len = temp_buffer.size();
+    size_t full_len = temp_buffer.count();               // Keeps counting past the end of `out`.
     bool format_overflowed = temp_buffer.is_truncated(); // True if vformat_to tried to write > n chars.
 
     if (format_overflowed)
@@ -1811,7 +2988,7 @@ inline format_to_result vformat_to_n(char *out, size_t n, string_view fmt, forma
         // Content was longer than n. temp_buffer (and thus `out`) contains the first n chars.
         // Overwrite last char of `out` to place the null terminator. Result is truncated.
         out[n - 1] = '\0';
-        return format_to_result{out, true};
+        return format_to_result{out, true, full_len};
     }
     else
     {
@@ -1820,18 +2997,111 @@ inline format_to_result vformat_to_n(char *out, size_t n, string_view fmt, forma
         {
             // Content fit and there's space in `out` for null.
             out[content_len] = '\0';
-            return format_to_result{out, false}; // Not truncated
+            return format_to_result{out, false, full_len}; // Not truncated
         }
         else
         {
             // Content exactly filled n bytes (content_len == n).
             // No space for a separate null, must overwrite last char of `out`. Result is truncated.
             out[n - 1] = '\0';
-            return format_to_result{out, true};
+            return format_to_result{out, true, full_len};
         }
     }
 }
 
+// =============== Output Sinks ===============
+
+// Detects a sink with write(const char *, size_t), e.g. Arduino Print/Stream or std::ostream
+template <typename T>
+class has_write_method
+{
+    template <typename U>
+    static auto test(int) -> decltype(std::declval<U &>().write(static_cast<const char *>(nullptr), size_t()), std::true_type());
+    template <typename>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<T>(0))::value;
+};
+
+// Detects a container sink with push_back(char), e.g. std::string or Vector<char>
+template <typename T>
+class has_push_back_method
+{
+    template <typename U>
+    static auto test(int) -> decltype(std::declval<U &>().push_back(char()), std::true_type());
+    template <typename>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<T>(0))::value;
+};
+
+// Print subclasses often hide Print::write(const char *, size_t) by declaring their own write(uint8_t)
+template <typename T>
+struct is_write_sink : std::integral_constant<bool, has_write_method<T>::value
+#if AFMT_HAS_ARDUINO
+                                                        || std::is_base_of<Print, T>::value
+#endif
+                                              >
+{
+};
+
+template <typename T>
+struct is_sink : std::integral_constant<bool, (is_write_sink<T>::value || has_push_back_method<T>::value) &&
+                                                  !std::is_same<T, buffer>::value>
+{
+};
+
+// Sink forwarding each chunk to a user callback
+struct callback_sink
+{
+    buffer::flush_fn fn;
+    void *context;
+
+    void write(const char *data, size_t size)
+    {
+        fn(context, data, size);
+    }
+};
+
+template <typename Sink>
+inline void write_to_sink(Sink &sink, const char *data, size_t size, std::true_type) // write(data, size)
+{
+#if AFMT_HAS_ARDUINO
+    typedef typename std::conditional<std::is_base_of<Print, Sink>::value, Print, Sink>::type target_type;
+    static_cast<target_type &>(sink).write(data, size);
+#else
+    sink.write(data, size);
+#endif
+}
+
+template <typename Sink>
+inline void write_to_sink(Sink &sink, const char *data, size_t size, std::false_type) // push_back(c)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        sink.push_back(data[i]);
+    }
+}
+
+template <typename Sink>
+inline void flush_to_sink(void *context, const char *data, size_t size)
+{
+    write_to_sink(*static_cast<Sink *>(context), data, size, std::integral_constant<bool, is_write_sink<Sink>::value>());
+}
+
+// Streams formatted output into a sink in chunks of AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE, never touching the heap.
+// Returns the number of characters written.
+template <typename Sink, typename S>
+inline size_t vformat_to_sink(Sink &sink, const S &fmt, format_args args)
+{
+    buffer out(&flush_to_sink<Sink>, &sink);
+    vformat_to(out, fmt, args);
+    out.flush();
+    return out.count();
+}
+
 // =============== Public API Functions ===============
 
 // Format to buffer
@@ -1841,6 +3111,13 @@ inline void format_to(buffer &out, string_view fmt, const Args &...args)
     vformat_to(out, fmt, make_format_args(args...));
 }
 
+// Format to a sink: Print/Stream, std::string, Vector<char>, callback_sink, ...
+template <typename Sink, typename... Args>
+inline typename std::enable_if<is_sink<Sink>::value, size_t>::type format_to(Sink &out, string_view fmt, const Args &...args)
+{
+    return vformat_to_sink(out, fmt, make_format_args(args...));
+}
+
 // Format to a fixed-size array using external char[]
 template <size_t N, typename... Args>
 inline format_to_result format_to(char (&out)[N], string_view fmt, const Args &...args)
@@ -1855,18 +3132,24 @@ inline format_to_result format_to_n(char *out, size_t n, string_view fmt, const
     return vformat_to_n(out, n, fmt, make_format_args(args...));
 }
 
-// Get the size that would be required for formatting
+// Get the size that would be required for formatting, without storing or allocating
 template <typename... Args>
 inline size_t formatted_size(string_view fmt, const Args &...args)
 {
-    buffer buf;
-    vformat_to(buf, fmt, make_format_args(args...));
-    return buf.size(); // excluding null terminator
+    buffer counter((counting_mode()));
+    vformat_to(counter, fmt, make_format_args(args...));
+    return counter.count(); // excluding null terminator
 }
 
-inline std::string vformat(string_view fmt, format_args args)
+template <typename S>
+inline std::string vformat(const S &fmt, format_args args)
 {
+#if AFMT_USE_BUFFER_POOL
+    pooled_buffer pooled;
+    buffer &buf = pooled.get();
+#else
     buffer buf;
+#endif
     vformat_to(buf, fmt, args);
     return std::string(buf.data(), buf.size());
 }
@@ -1880,9 +3163,15 @@ inline std::string format(string_view fmt, const Args &...args)
 
 // Format for Arduino String
 #if AFMT_HAS_ARDUINO
-inline String avformat(string_view fmt, format_args args)
+template <typename S>
+inline String avformat(const S &fmt, format_args args)
 {
+#if AFMT_USE_BUFFER_POOL
+    pooled_buffer pooled;
+    buffer &buf = pooled.get();
+#else
     buffer buf;
+#endif
     vformat_to(buf, fmt, args);
     return String(buf.data(), buf.size());
 }
@@ -1896,13 +3185,73 @@ inline String aformat(string_view fmt, const Args &...args)
 template <typename... Args>
 inline void print(string_view fmt, const Args &...args)
 {
-    AFMT_SERIAL_OUTPUT.print(avformat(fmt, make_format_args(args...)));
+    vformat_to_sink(AFMT_SERIAL_OUTPUT, fmt, make_format_args(args...));
 }
 
 template <typename... Args>
 inline void println(string_view fmt, const Args &...args)
 {
-    AFMT_SERIAL_OUTPUT.println(avformat(fmt, make_format_args(args...)));
+    vformat_to_sink(AFMT_SERIAL_OUTPUT, fmt, make_format_args(args...));
+    AFMT_SERIAL_OUTPUT.println();
+}
+
+// Flash format strings: format(F("{} mV"), mv), print(F("..."), ...)
+
+template <typename... Args>
+inline void format_to(buffer &out, const __FlashStringHelper *fmt, const Args &...args)
+{
+    vformat_to(out, fmt, make_format_args(args...));
+}
+
+template <typename Sink, typename... Args>
+inline typename std::enable_if<is_sink<Sink>::value, size_t>::type format_to(Sink &out, const __FlashStringHelper *fmt, const Args &...args)
+{
+    return vformat_to_sink(out, fmt, make_format_args(args...));
+}
+
+template <size_t N, typename... Args>
+inline format_to_result format_to(char (&out)[N], const __FlashStringHelper *fmt, const Args &...args)
+{
+    return vformat_to_n(out, N, fmt, make_format_args(args...));
+}
+
+template <typename... Args>
+inline format_to_result format_to_n(char *out, size_t n, const __FlashStringHelper *fmt, const Args &...args)
+{
+    return vformat_to_n(out, n, fmt, make_format_args(args...));
+}
+
+template <typename... Args>
+inline size_t formatted_size(const __FlashStringHelper *fmt, const Args &...args)
+{
+    buffer counter((counting_mode()));
+    vformat_to(counter, fmt, make_format_args(args...));
+    return counter.count();
+}
+
+template <typename... Args>
+inline std::string format(const __FlashStringHelper *fmt, const Args &...args)
+{
+    return vformat(fmt, make_format_args(args...));
+}
+
+template <typename... Args>
+inline String aformat(const __FlashStringHelper *fmt, const Args &...args)
+{
+    return avformat(fmt, make_format_args(args...));
+}
+
+template <typename... Args>
+inline void print(const __FlashStringHelper *fmt, const Args &...args)
+{
+    vformat_to_sink(AFMT_SERIAL_OUTPUT, fmt, make_format_args(args...));
+}
+
+template <typename... Args>
+inline void println(const __FlashStringHelper *fmt, const Args &...args)
+{
+    vformat_to_sink(AFMT_SERIAL_OUTPUT, fmt, make_format_args(args...));
+    AFMT_SERIAL_OUTPUT.println();
 }
 #endif
 
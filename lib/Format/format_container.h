@@ -0,0 +1,70 @@
+//
+// afmt formatters for lib/Container types
+//
+// Vector and Array are ranges and already format through format.h. This header adds Optional and Result.
+//
+
+#ifndef ARDUINO_FMT_CONTAINER_H_
+#define ARDUINO_FMT_CONTAINER_H_
+
+#include "format.h"
+#include "Optional.h"
+#include "Result.h"
+
+AFMT_BEGIN_NAMESPACE
+
+// Formats as "optional(42)" or "none". The spec applies to the value.
+template <typename T>
+struct formatter<Optional<T>>
+{
+    formatter<T> value_formatter;
+
+    const char *parse(const char *begin, const char *end)
+    {
+        return value_formatter.parse(begin, end);
+    }
+
+    void format(const Optional<T> &optional, buffer &out) const
+    {
+        if (!optional.hasValue())
+        {
+            out.append("none", "none" + 4);
+            return;
+        }
+        out.append("optional(", "optional(" + 9);
+        value_formatter.format(optional.value(), out);
+        out.push_back(')');
+    }
+};
+
+// Formats as "ok(42)" or "error(3)". The spec applies to the value, the error uses the default format.
+template <typename T, typename Event>
+struct formatter<Result<T, Event>>
+{
+    formatter<T> value_formatter;
+    formatter<Event> error_formatter;
+
+    const char *parse(const char *begin, const char *end)
+    {
+        return value_formatter.parse(begin, end);
+    }
+
+    void format(const Result<T, Event> &result, buffer &out) const
+    {
+        if (result.hasError())
+        {
+            out.append("error(", "error(" + 6);
+            error_formatter.format(result.error, out);
+        }
+        else
+        {
+            out.append("ok(", "ok(" + 3);
+            value_formatter.format(result.value, out);
+        }
+        out.push_back(')');
+    }
+};
+
+AFMT_END_NAMESPACE
+
+#endif // ARDUINO_FMT_CONTAINER_H_
@@ -0,0 +1,242 @@
+//
+// afmt hex formatting for raw bytes
+//
+// format("{}", bytes(p, n))    -> "deadbeef"
+// format("{:X}", bytes(p, n))  -> "DEADBEEF"
+// format("{:#x}", bytes(p, n)) -> canonical dump with offsets and an ASCII gutter
+// hexdump(Serial, bytes(p, n), options)
+//
+
+#ifndef ARDUINO_FMT_HEX_H_
+#define ARDUINO_FMT_HEX_H_
+
+#include <stdint.h>
+#include "format.h"
+
+AFMT_BEGIN_NAMESPACE
+
+// Contiguous bytes to format as hex
+struct byte_span
+{
+    const uint8_t *data;
+    size_t size;
+};
+
+inline byte_span bytes(const void *data, size_t size)
+{
+    return {static_cast<const uint8_t *>(data), size};
+}
+
+// Whole array, note a string literal includes its '\0'
+template <typename T, size_t N>
+inline byte_span bytes(const T (&array)[N])
+{
+    return {reinterpret_cast<const uint8_t *>(array), sizeof(T) * N};
+}
+
+// =============== Hex Kernel ===============
+
+// Writes two hex digits per byte to dst, which must hold 2 * size chars.
+// Converts 16 bytes per step through the digit table, the fixed inner loop is unrolled by the compiler.
+inline void hex_encode(const uint8_t *src, size_t size, char *dst, bool upper = false)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    while (size >= 16)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            dst[2 * i] = digits[src[i] >> 4];
+            dst[2 * i + 1] = digits[src[i] & 0x0F];
+        }
+        src += 16;
+        dst += 32;
+        size -= 16;
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        dst[2 * i] = digits[src[i] >> 4];
+        dst[2 * i + 1] = digits[src[i] & 0x0F];
+    }
+}
+
+// Appends the bytes as one run of hex digits, converted in stack chunks
+inline void format_hex(byte_span span, buffer &out, bool upper = false)
+{
+    char chunk[64];
+    const uint8_t *src = span.data;
+    size_t remaining = span.size;
+
+    while (remaining > 0)
+    {
+        size_t n = remaining < sizeof(chunk) / 2 ? remaining : sizeof(chunk) / 2;
+        hex_encode(src, n, chunk, upper);
+        out.append(chunk, chunk + 2 * n);
+        src += n;
+        remaining -= n;
+    }
+}
+
+// =============== Hex Dump ===============
+
+struct hexdump_options
+{
+    uint8_t bytes_per_line; // Clamped to 1..32
+    uint8_t group;          // Extra space after every group bytes, 0 disables
+    bool offset;            // Offset column
+    bool ascii;             // ASCII gutter, non-printable bytes show as '.'
+    bool upper;             // Uppercase hex digits
+    uint32_t base_offset;   // Added to the offset column, e.g. a flash address
+
+    AFMT_CONSTEXPR hexdump_options()
+        : bytes_per_line(16),
+          group(8),
+          offset(true),
+          ascii(true),
+          upper(false),
+          base_offset(0) {}
+};
+
+// Dumps the bytes in the "hexdump -C" layout, one line per bytes_per_line bytes:
+// 00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a        |Hello, world!.|
+// Lines are separated by '\n' with no trailing newline.
+inline void hexdump(buffer &out, byte_span span, const hexdump_options &options = hexdump_options())
+{
+    const size_t per_line = options.bytes_per_line == 0 ? 1 : (options.bytes_per_line > 32 ? 32 : options.bytes_per_line);
+    const char *digits = options.upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    // Offset + 3 chars per byte + group gaps + gutter
+    char line[10 + 32 * 3 + 32 + 2 + 32 + 1];
+
+    for (size_t start = 0; start < span.size; start += per_line)
+    {
+        const uint8_t *src = span.data + start;
+        size_t count = span.size - start < per_line ? span.size - start : per_line;
+        size_t pos = 0;
+
+        if (start > 0)
+        {
+            out.push_back('\n');
+        }
+
+        if (options.offset)
+        {
+            uint32_t address = options.base_offset + static_cast<uint32_t>(start);
+            for (int shift = 28; shift >= 0; shift -= 4)
+            {
+                line[pos++] = digits[(address >> shift) & 0x0F];
+            }
+            line[pos++] = ' ';
+            line[pos++] = ' ';
+        }
+
+        // Hex columns, short lines are padded so the gutter lines up
+        for (size_t i = 0; i < per_line; ++i)
+        {
+            if (i < count)
+            {
+                line[pos++] = digits[src[i] >> 4];
+                line[pos++] = digits[src[i] & 0x0F];
+            }
+            else
+            {
+                line[pos++] = ' ';
+                line[pos++] = ' ';
+            }
+            line[pos++] = ' ';
+            if (options.group != 0 && (i + 1) % options.group == 0 && i + 1 < per_line)
+            {
+                line[pos++] = ' ';
+            }
+        }
+
+        if (options.ascii)
+        {
+            line[pos++] = ' ';
+            line[pos++] = '|';
+            for (size_t i = 0; i < count; ++i)
+            {
+                line[pos++] = (src[i] >= 0x20 && src[i] < 0x7F) ? static_cast<char>(src[i]) : '.';
+            }
+            line[pos++] = '|';
+        }
+        else
+        {
+            while (pos > 0 && line[pos - 1] == ' ')
+            {
+                --pos;
+            }
+        }
+
+        out.append(line, line + pos);
+    }
+}
+
+// A dump with its options, formats through "{}"
+struct hexdump_view
+{
+    byte_span span;
+    hexdump_options options;
+};
+
+// Spec: [#][x|X]. "x" is a compact run of hex digits, "X" uppercase, '#' the full dump.
+template <>
+struct formatter<byte_span>
+{
+    bool dump = false;
+    bool upper = false;
+
+    const char *parse(const char *begin, const char *end)
+    {
+        if (begin != end && *begin == '#')
+        {
+            dump = true;
+            ++begin;
+        }
+        if (begin != end && (*begin == 'x' || *begin == 'X'))
+        {
+            upper = *begin == 'X';
+            ++begin;
+        }
+        return begin;
+    }
+
+    void format(const byte_span &span, buffer &out) const
+    {
+        if (dump)
+        {
+            hexdump_options options;
+            options.upper = upper;
+            hexdump(out, span, options);
+        }
+        else
+        {
+            format_hex(span, out, upper);
+        }
+    }
+};
+
+template <>
+struct formatter<hexdump_view>
+{
+    const char *parse(const char *begin, const char *)
+    {
+        return begin;
+    }
+
+    void format(const hexdump_view &view, buffer &out) const
+    {
+        hexdump(out, view.span, view.options);
+    }
+};
+
+// Dumps straight to a sink (Serial, std::string, callback_sink, ...), returns the characters written
+template <typename Sink, typename = typename std::enable_if<is_sink<Sink>::value>::type>
+inline size_t hexdump(Sink &out, byte_span span, const hexdump_options &options = hexdump_options())
+{
+    return format_to(out, "{}", hexdump_view{span, options});
+}
+
+AFMT_END_NAMESPACE
+
+#endif // ARDUINO_FMT_HEX_H_
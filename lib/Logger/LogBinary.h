@@ -0,0 +1,237 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Binary Log Records
+ *
+ * LOG_PRINT_TYPE_BINARY sends each LOG call as a compact record instead of formatted text.
+ * The format string stays in the firmware, the record carries its address and the raw
+ * argument bytes. tools/logdecode turns records back into text using the firmware ELF.
+ *
+ *   u8   sync                0xB1
+ *   u8   length              bytes after this field
+ *   i32  format              format string address minus the anchor address
+ *   u32  timestamp           micros()
+ *   u8   count               number of arguments
+ *   u8   types[(count+1)/2]  4-bit WireType per argument, low nibble first
+ *   ...  values              little-endian, Str as u8 length + bytes
+ *-------------------------------------------------------------------------------------*/
+
+namespace logbin
+{
+    const uint8_t sync = 0xB1;
+    const size_t headerSize = 11; // sync to count
+    const size_t maxRecordSize = 2 + 255;
+
+    enum class WireType : uint8_t
+    {
+        None, // Argument did not fit in the record
+        I32,  // Signed integers up to 32 bits
+        U32,  // Unsigned integers up to 32 bits
+        I64,
+        U64,
+        Bool,
+        Char,
+        F32, // float, and double where it is 32 bits (AVR)
+        F64,
+        Str,     // u8 length + bytes, for strings that only exist at runtime
+        StrRef,  // i32 address relative to the anchor, for literals and static strings
+        FileRef, // Like StrRef, decoded as the file name without directory and extension
+        Ptr32,
+        Ptr64,
+    };
+
+    // Unique bytes the decoder finds in the ELF. Addresses are sent relative to this so they
+    // decode the same for position independent host builds.
+#if defined(__AVR__)
+    inline constexpr char anchor[] PROGMEM = "\x7fLOGBIN\x01";
+#else
+    inline constexpr char anchor[] = "\x7fLOGBIN\x01";
+#endif
+
+    // A string literal or static string, only its address is sent
+    struct StringRef
+    {
+        const char *str;
+    };
+
+    // __FILE__, sent by address and decoded to the file name without directory and extension
+    struct FileRef
+    {
+        const char *path;
+    };
+
+    inline int32_t relativeAddress(const void *ptr)
+    {
+        return static_cast<int32_t>(reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(anchor));
+    }
+
+    class Writer
+    {
+    private:
+        uint8_t *out;
+        size_t capacity;
+        size_t pos;
+        int index;
+
+        void setType(WireType type)
+        {
+            out[headerSize + index / 2] |= static_cast<uint8_t>(static_cast<uint8_t>(type) << ((index & 1) * 4));
+            index++;
+        }
+
+        void putLE(uint64_t value, size_t bytes)
+        {
+            for (size_t i = 0; i < bytes; i++)
+            {
+                out[pos++] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+    public:
+        Writer(uint8_t *out, size_t capacity, size_t pos) : out(out), capacity(capacity), pos(pos), index(0) {}
+
+        size_t size() const { return pos; }
+
+        void value(WireType type, uint64_t value, size_t bytes)
+        {
+            if (capacity - pos < bytes)
+            {
+                setType(WireType::None);
+                return;
+            }
+            setType(type);
+            putLE(value, bytes);
+        }
+
+        void string(const char *str, size_t length)
+        {
+            if (capacity - pos < 1)
+            {
+                setType(WireType::None);
+                return;
+            }
+            size_t room = capacity - pos - 1;
+            length = length < room ? length : room;
+            length = length < 255 ? length : 255;
+            setType(WireType::Str);
+            out[pos++] = static_cast<uint8_t>(length);
+            memcpy(out + pos, str, length);
+            pos += length;
+        }
+    };
+
+    // Argument encoders, one overload per wire type
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    inline void encode(Writer &w, T value)
+    {
+        if (sizeof(T) <= 4)
+            w.value(WireType::I32, static_cast<uint64_t>(static_cast<int64_t>(value)), 4);
+        else
+            w.value(WireType::I64, static_cast<uint64_t>(static_cast<int64_t>(value)), 8);
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+    inline void encode(Writer &w, T value)
+    {
+        if (sizeof(T) <= 4)
+            w.value(WireType::U32, static_cast<uint64_t>(value), 4);
+        else
+            w.value(WireType::U64, static_cast<uint64_t>(value), 8);
+    }
+
+    template <typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+    inline void encode(Writer &w, T value)
+    {
+        encode(w, static_cast<typename std::underlying_type<T>::type>(value));
+    }
+
+    inline void encode(Writer &w, bool value) { w.value(WireType::Bool, value ? 1 : 0, 1); }
+    inline void encode(Writer &w, char value) { w.value(WireType::Char, static_cast<uint8_t>(value), 1); }
+
+    inline void encode(Writer &w, float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        w.value(WireType::F32, bits, 4);
+    }
+
+    inline void encode(Writer &w, double value)
+    {
+        if (sizeof(double) == 4)
+        {
+            encode(w, static_cast<float>(value));
+            return;
+        }
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        w.value(WireType::F64, bits, 8);
+    }
+
+    inline void encode(Writer &w, const char *value)
+    {
+        if (value == nullptr)
+            value = "";
+        w.string(value, strlen(value));
+    }
+
+    inline void encode(Writer &w, char *value) { encode(w, static_cast<const char *>(value)); }
+    inline void encode(Writer &w, StringRef value) { w.value(WireType::StrRef, static_cast<uint32_t>(relativeAddress(value.str)), 4); }
+    inline void encode(Writer &w, FileRef value) { w.value(WireType::FileRef, static_cast<uint32_t>(relativeAddress(value.path)), 4); }
+
+    template <typename T>
+    inline void encode(Writer &w, T *value)
+    {
+        if (sizeof(void *) <= 4)
+            w.value(WireType::Ptr32, reinterpret_cast<uintptr_t>(value), 4);
+        else
+            w.value(WireType::Ptr64, reinterpret_cast<uintptr_t>(value), 8);
+    }
+
+    // String, std::string and anything else with c_str() and length()
+    template <typename T, typename = decltype(std::declval<const T &>().length()), typename = decltype(std::declval<const T &>().c_str())>
+    inline void encode(Writer &w, const T &value)
+    {
+        w.string(value.c_str(), value.length());
+    }
+
+    // Writes one record into out, returns its size or 0 when out cannot hold the header
+    template <typename... Args>
+    inline size_t writeRecord(uint8_t *out, size_t capacity, uint32_t timestamp, const char *format, const Args &...args)
+    {
+        const size_t count = sizeof...(Args);
+        const size_t typesSize = (count + 1) / 2;
+        static_assert(count <= 255, "Binary log records hold at most 255 arguments");
+
+        capacity = capacity < maxRecordSize ? capacity : maxRecordSize;
+        if (capacity < headerSize + typesSize)
+        {
+            return 0;
+        }
+
+        int32_t address = relativeAddress(format);
+        out[0] = sync;
+        for (int i = 0; i < 4; i++)
+        {
+            out[2 + i] = static_cast<uint8_t>(static_cast<uint32_t>(address) >> (8 * i));
+            out[6 + i] = static_cast<uint8_t>(timestamp >> (8 * i));
+        }
+        out[10] = static_cast<uint8_t>(count);
+        memset(out + headerSize, 0, typesSize);
+
+        Writer w(out, capacity, headerSize + typesSize);
+        int expand[] = {0, (encode(w, args), 0)...};
+        (void)expand;
+
+        out[1] = static_cast<uint8_t>(w.size() - 2);
+        return w.size();
+    }
+} // namespace logbin
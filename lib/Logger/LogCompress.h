@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Compression.h>
+#include "LogSink.h"
+#if defined(ESP32) || !defined(ARDUINO)
+#include <mutex>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Compressed Sink
+ *
+ * A stage in front of another sink: records are compressed with LzEncoder from lib/Compression
+ * and the compressed bytes are written to the next sink, e.g. a LogFileSink or a LogPrintSink on
+ * a UART. Register only this sink, the next one gets its bytes with level 0.
+ *
+ * The encoder holds up to 1 << LookaheadBits bytes until more records come in. A record at
+ * flushLevel or more severe, flush() and logFlush() sync the stream and flush the next sink, so
+ * everything up to that record can be decoded.
+ *-------------------------------------------------------------------------------------*/
+
+template <uint8_t WindowBits = 8, uint8_t LookaheadBits = 4>
+class LogCompressSink : public LogSink
+{
+private:
+    LogSink &next;
+    LzEncoder<WindowBits, LookaheadBits> encoder;
+    uint8_t flushLevel;
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+#if defined(ESP32) || !defined(ARDUINO)
+    std::mutex lock;
+#endif
+
+    void lockWrites()
+    {
+#if defined(ESP32) || !defined(ARDUINO)
+        lock.lock();
+#endif
+    }
+
+    void unlockWrites()
+    {
+#if defined(ESP32) || !defined(ARDUINO)
+        lock.unlock();
+#endif
+    }
+
+    void drain()
+    {
+        uint8_t chunk[64];
+        size_t size;
+        while ((size = encoder.pull(chunk, sizeof(chunk))) > 0)
+        {
+            bytesOut += static_cast<uint32_t>(size);
+            next.write(0, reinterpret_cast<const char *>(chunk), size);
+        }
+    }
+
+    void sync()
+    {
+        encoder.flush();
+        drain();
+        next.flush();
+    }
+
+public:
+    explicit LogCompressSink(LogSink &next, uint8_t level = 5)
+        : LogSink(level), next(next), flushLevel(1), bytesIn(0), bytesOut(0) {}
+
+    // Records at level or more severe sync the stream, 0 leaves it to flush()
+    void setFlushLevel(uint8_t level) { flushLevel = level; }
+
+    void write(uint8_t level, const char *data, size_t size) override
+    {
+        lockWrites();
+        bytesIn += static_cast<uint32_t>(size);
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+        while (size > 0)
+        {
+            size_t taken = encoder.push(bytes, size);
+            bytes += taken;
+            size -= taken;
+            drain();
+        }
+        if (level != 0 && level <= flushLevel)
+        {
+            sync();
+        }
+        unlockWrites();
+    }
+
+    void flush() override
+    {
+        lockWrites();
+        sync();
+        unlockWrites();
+    }
+
+    uint32_t recordBytes() const { return bytesIn; }      // Bytes of the records
+    uint32_t compressedBytes() const { return bytesOut; } // Bytes written to the next sink
+};
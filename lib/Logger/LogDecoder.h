@@ -0,0 +1,366 @@
+#pragma once
+
+// Host side decoder for LOG_PRINT_TYPE_BINARY records, used by tools/logdecode.
+// Needs a hosted standard library, it is not meant to be built for a board.
+
+#include <stdio.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include "LogBinary.h"
+#include "format.h"
+
+/**--------------------------------------------------------------------------------------
+ * ELF String Table
+ *
+ * Resolves the format string addresses of binary records from the firmware ELF. The anchor
+ * bytes are searched in the loaded sections, addresses in records are relative to them.
+ *-------------------------------------------------------------------------------------*/
+
+class LogStringTable
+{
+private:
+    struct Section
+    {
+        uint64_t address;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::vector<uint8_t> image;
+    std::vector<Section> sections;
+    uint64_t anchorAddress = 0;
+    bool anchorFound = false;
+
+    uint64_t read(uint64_t offset, int bytes) const
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint64_t>(image[offset + i]) << (8 * i);
+        }
+        return value;
+    }
+
+    bool parseSections()
+    {
+        // Little-endian ELF32 or ELF64 only, which covers Xtensa, RISC-V, ARM, AVR and x86
+        if (image.size() < 52 || memcmp(image.data(), "\x7f" "ELF", 4) != 0 || image[5] != 1)
+        {
+            return false;
+        }
+        const bool is64 = image[4] == 2;
+        const int word = is64 ? 8 : 4;
+        const uint64_t shoff = read(is64 ? 0x28 : 0x20, word);
+        const uint64_t shentsize = read(is64 ? 0x3A : 0x2E, 2);
+        const uint64_t shnum = read(is64 ? 0x3C : 0x30, 2);
+
+        for (uint64_t i = 0; i < shnum; i++)
+        {
+            uint64_t header = shoff + i * shentsize;
+            if (header + shentsize > image.size())
+            {
+                return false;
+            }
+            uint32_t type = static_cast<uint32_t>(read(header + 4, 4));
+            uint64_t flags = read(header + 8, word);
+            Section section;
+            section.address = read(header + 8 + word, word);
+            section.offset = read(header + 8 + 2 * word, word);
+            section.size = read(header + 8 + 3 * word, word);
+
+            const uint32_t nobits = 8;
+            const uint64_t alloc = 2;
+            if (type != nobits && (flags & alloc) && section.offset + section.size <= image.size())
+            {
+                sections.push_back(section);
+            }
+        }
+        return !sections.empty();
+    }
+
+    void findAnchor()
+    {
+        const size_t length = sizeof(logbin::anchor);
+        for (const Section &section : sections)
+        {
+            const uint8_t *begin = image.data() + section.offset;
+            for (uint64_t i = 0; i + length <= section.size; i++)
+            {
+                if (memcmp(begin + i, logbin::anchor, length) == 0)
+                {
+                    anchorAddress = section.address + i;
+                    anchorFound = true;
+                    return;
+                }
+            }
+        }
+    }
+
+public:
+    bool load(const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        image.clear();
+        sections.clear();
+        anchorFound = false;
+
+        uint8_t chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            image.insert(image.end(), chunk, chunk + n);
+        }
+        fclose(file);
+
+        if (!parseSections())
+        {
+            return false;
+        }
+        findAnchor();
+        return anchorFound;
+    }
+
+    // String at an anchor relative address, nullptr when it is not inside a loaded section
+    const char *string(int32_t relative) const
+    {
+        if (!anchorFound)
+        {
+            return nullptr;
+        }
+        uint64_t address = anchorAddress + static_cast<int64_t>(relative);
+        for (const Section &section : sections)
+        {
+            if (address >= section.address && address < section.address + section.size)
+            {
+                const char *begin = reinterpret_cast<const char *>(image.data() + section.offset + (address - section.address));
+                const char *end = reinterpret_cast<const char *>(image.data() + section.offset + section.size);
+                return memchr(begin, '\0', end - begin) != nullptr ? begin : nullptr;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/**--------------------------------------------------------------------------------------
+ * Record Decoder
+ *
+ * Turns a byte stream of records back into text. Bytes outside records, such as boot
+ * messages or LOG_PRINT output, are passed through unchanged.
+ *-------------------------------------------------------------------------------------*/
+
+class LogDecoder
+{
+public:
+    enum class Time
+    {
+        None,
+        Micros,
+        Millis,
+    };
+
+private:
+    const LogStringTable &table;
+    Time time;
+    std::vector<uint8_t> pending;
+    uint32_t decodedCount = 0;
+    uint32_t invalidCount = 0;
+
+    static uint64_t read(const uint8_t *p, int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    static afmt::string_view fileName(const char *path)
+    {
+        const char *name = path;
+        for (const char *p = path; *p; p++)
+        {
+            if (*p == '/' || *p == '\\')
+            {
+                name = p + 1;
+            }
+        }
+        const char *dot = strchr(name, '.');
+        return afmt::string_view(name, dot ? static_cast<size_t>(dot - name) : strlen(name));
+    }
+
+    void writeTime(uint32_t timestamp, std::string &out) const
+    {
+        if (time == Time::Micros)
+        {
+            afmt::format_to(out, "[{:>11}]", timestamp);
+        }
+        else if (time == Time::Millis)
+        {
+            afmt::format_to(out, "[{:>8}.{:03}]", timestamp / 1000, timestamp % 1000);
+        }
+    }
+
+public:
+    LogDecoder(const LogStringTable &table, Time time = Time::Millis) : table(table), time(time) {}
+
+    uint32_t decoded() const { return decodedCount; }
+    uint32_t invalid() const { return invalidCount; }
+
+    // Decodes one complete record starting at the sync byte, false when it is not a valid record
+    bool decodeRecord(const uint8_t *record, size_t size, std::string &out)
+    {
+        if (size < logbin::headerSize || record[0] != logbin::sync || static_cast<size_t>(record[1]) + 2 != size)
+        {
+            return false;
+        }
+        const char *format = table.string(static_cast<int32_t>(read(record + 2, 4)));
+        if (format == nullptr)
+        {
+            return false;
+        }
+        const uint32_t timestamp = static_cast<uint32_t>(read(record + 6, 4));
+        const int count = record[10];
+        const uint8_t *types = record + logbin::headerSize;
+        size_t pos = logbin::headerSize + (count + 1) / 2;
+        if (pos > size)
+        {
+            return false;
+        }
+
+        // Rebuild an afmt packed argument store with host types
+        std::vector<unsigned char> tags((count + 1) / 2, 0);
+        std::vector<unsigned char> data;
+        std::deque<std::string> strings;
+
+        for (int i = 0; i < count; i++)
+        {
+            logbin::WireType wire = static_cast<logbin::WireType>((types[i / 2] >> ((i & 1) * 4)) & 0x0F);
+            const size_t widths[] = {0, 4, 4, 8, 8, 1, 1, 4, 8, 1, 4, 4, 4, 8};
+            size_t width = static_cast<size_t>(wire) < sizeof(widths) / sizeof(widths[0]) ? widths[static_cast<size_t>(wire)] : 0;
+            if (wire != logbin::WireType::None && (width == 0 || pos + width > size))
+            {
+                return false;
+            }
+
+            const uint8_t *p = record + pos;
+            uint64_t raw = read(p, static_cast<int>(width));
+            afmt::format_arg_value arg;
+            switch (wire)
+            {
+            case logbin::WireType::I32:
+                arg = afmt::format_arg_value(static_cast<int>(static_cast<int32_t>(raw)));
+                break;
+            case logbin::WireType::U32:
+                arg = afmt::format_arg_value(static_cast<unsigned>(raw));
+                break;
+            case logbin::WireType::I64:
+                arg = afmt::format_arg_value(static_cast<long long>(raw));
+                break;
+            case logbin::WireType::U64:
+                arg = afmt::format_arg_value(static_cast<unsigned long long>(raw));
+                break;
+            case logbin::WireType::Bool:
+                arg = afmt::format_arg_value(raw != 0);
+                break;
+            case logbin::WireType::Char:
+                arg = afmt::format_arg_value(static_cast<char>(raw));
+                break;
+            case logbin::WireType::F32:
+            {
+                uint32_t bits = static_cast<uint32_t>(raw);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                arg = afmt::format_arg_value(value);
+                break;
+            }
+            case logbin::WireType::F64:
+            {
+                double value;
+                memcpy(&value, &raw, sizeof(value));
+                arg = afmt::format_arg_value(value);
+                break;
+            }
+            case logbin::WireType::Str:
+                if (pos + 1 + raw > size)
+                {
+                    return false;
+                }
+                strings.emplace_back(reinterpret_cast<const char *>(p + 1), static_cast<size_t>(raw));
+                arg = afmt::format_arg_value(afmt::string_view(strings.back().data(), strings.back().size()));
+                width += static_cast<size_t>(raw);
+                break;
+            case logbin::WireType::StrRef:
+            case logbin::WireType::FileRef:
+            {
+                const char *str = table.string(static_cast<int32_t>(raw));
+                afmt::string_view view = str == nullptr ? afmt::string_view("?") : wire == logbin::WireType::FileRef ? fileName(str)
+                                                                                                                   : afmt::string_view(str);
+                arg = afmt::format_arg_value(view);
+                break;
+            }
+            case logbin::WireType::Ptr32:
+            case logbin::WireType::Ptr64:
+                arg = afmt::format_arg_value(reinterpret_cast<const void *>(static_cast<uintptr_t>(raw)));
+                break;
+            default:
+                arg = afmt::format_arg_value(afmt::string_view("?"));
+                break;
+            }
+            pos += width;
+
+            tags[i / 2] |= static_cast<unsigned char>(static_cast<unsigned char>(arg.get_type()) << ((i & 1) * 4));
+            size_t offset = data.size();
+            data.resize(offset + afmt::format_arg_value::packed_size(arg.get_type()));
+            arg.pack(data.data() + offset);
+        }
+        if (pos != size)
+        {
+            return false;
+        }
+
+        writeTime(timestamp, out);
+        afmt::buffer buf;
+        afmt::vformat_to(buf, afmt::string_view(format), afmt::format_args(tags.data(), data.data(), count));
+        out.append(buf.data(), buf.size());
+        decodedCount++;
+        return true;
+    }
+
+    // Decodes a chunk of the stream, a record split across chunks is kept until the rest arrives
+    void feed(const uint8_t *data, size_t size, std::string &out)
+    {
+        pending.insert(pending.end(), data, data + size);
+
+        size_t pos = 0;
+        while (pos < pending.size())
+        {
+            if (pending[pos] != logbin::sync)
+            {
+                out.push_back(static_cast<char>(pending[pos++]));
+                continue;
+            }
+            if (pending.size() - pos < 2 || pending.size() - pos < static_cast<size_t>(pending[pos + 1]) + 2)
+            {
+                break; // Incomplete record
+            }
+            size_t length = static_cast<size_t>(pending[pos + 1]) + 2;
+            if (decodeRecord(pending.data() + pos, length, out))
+            {
+                pos += length;
+            }
+            else
+            {
+                // Not a record after all, pass the byte through and resync
+                invalidCount++;
+                out.push_back(static_cast<char>(pending[pos++]));
+            }
+        }
+        pending.erase(pending.begin(), pending.begin() + pos);
+    }
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "LogSink.h"
+#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_RP2040)
+#include <FS.h>
+#define LOG_FILE_FS 1
+#elif !defined(ARDUINO)
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#endif
+#if defined(ESP32) || !defined(ARDUINO)
+#include <mutex>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * File Sink
+ *
+ * Collects records in a RAM block and writes the file one block at a time, so LittleFS or SD
+ * sees few large writes instead of one small write per line. A write always ends on a block
+ * boundary of the file, after a partial flush the next write is shorter to line up again.
+ *
+ *   flush     records at flushLevel or more severe, the oldest buffered record reaching
+ *             flushMs, flush() and logFlush()
+ *   rotation  before a record once the file holds maxSize bytes: path.N-1 is removed, each
+ *             path.i becomes path.i+1 and path becomes path.1, maxFiles files are kept
+ *
+ * Uses fs::FS (LittleFS, SD, SPIFFS) on ESP32, ESP8266 and RP2040, and POSIX files on the host.
+ *-------------------------------------------------------------------------------------*/
+
+#if defined(LOG_FILE_FS) || !defined(ARDUINO)
+
+template <size_t BlockSize = 4096>
+class LogFileSink : public LogSink
+{
+private:
+    static_assert(BlockSize >= 64 && (BlockSize & (BlockSize - 1)) == 0, "BlockSize must be a power of two of at least 64");
+    static const size_t maxPath = 48;
+
+#if defined(LOG_FILE_FS)
+    fs::FS &fs;
+    fs::File file;
+#else
+    int fd;
+#endif
+    char path[maxPath];
+    char block[BlockSize];
+    size_t used;     // Buffered bytes, they go at fileSize in the file
+    size_t fileSize; // Bytes in the file
+    size_t maxSize;
+    uint8_t maxFiles;
+    uint8_t flushLevel;
+    uint32_t flushMs;
+    uint32_t bufferedAt; // When the oldest buffered record came in
+    uint32_t writes;
+    uint32_t dropped;
+#if defined(ESP32) || !defined(ARDUINO)
+    std::mutex lock;
+#endif
+
+    void lockWrites()
+    {
+#if defined(ESP32) || !defined(ARDUINO)
+        lock.lock();
+#endif
+    }
+
+    void unlockWrites()
+    {
+#if defined(ESP32) || !defined(ARDUINO)
+        lock.unlock();
+#endif
+    }
+
+    // path, or path.index for a rotated file
+    void rotatedPath(char *out, uint8_t index) const
+    {
+        if (index == 0)
+        {
+            snprintf(out, maxPath + 4, "%s", path);
+            return;
+        }
+        snprintf(out, maxPath + 4, "%s.%u", path, static_cast<unsigned>(index));
+    }
+
+#if defined(LOG_FILE_FS)
+    bool openFile()
+    {
+        file = fs.open(path, "a");
+        fileSize = file ? file.size() : 0;
+        return static_cast<bool>(file);
+    }
+
+    bool isOpen() { return static_cast<bool>(file); }
+    void closeFile() { file.close(); }
+    size_t writeFile(const char *data, size_t size) { return file.write(reinterpret_cast<const uint8_t *>(data), size); }
+    void syncFile() { file.flush(); }
+
+    void removeFile(const char *name)
+    {
+        if (fs.exists(name))
+        {
+            fs.remove(name);
+        }
+    }
+
+    void renameFile(const char *from, const char *to)
+    {
+        if (fs.exists(from))
+        {
+            fs.rename(from, to);
+        }
+    }
+#else
+    bool openFile()
+    {
+        fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        off_t end = fd >= 0 ? lseek(fd, 0, SEEK_END) : 0;
+        fileSize = end > 0 ? static_cast<size_t>(end) : 0;
+        return fd >= 0;
+    }
+
+    bool isOpen() { return fd >= 0; }
+
+    void closeFile()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    size_t writeFile(const char *data, size_t size)
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n <= 0)
+            {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return done;
+    }
+
+    void syncFile() {}
+    void removeFile(const char *name) { ::unlink(name); }
+    void renameFile(const char *from, const char *to) { ::rename(from, to); }
+#endif
+
+    // Writes the buffered bytes, counted as dropped when the file takes less
+    void writeOut()
+    {
+        if (used == 0)
+        {
+            return;
+        }
+        size_t written = writeFile(block, used);
+        fileSize += written;
+        dropped += static_cast<uint32_t>(used - written);
+        writes++;
+        used = 0;
+    }
+
+    bool flushDue(uint32_t time) const { return flushMs != 0 && used > 0 && time - bufferedAt >= flushMs; }
+
+    void rotate()
+    {
+        closeFile();
+        char from[maxPath + 4];
+        char to[maxPath + 4];
+        rotatedPath(to, maxFiles - 1);
+        removeFile(to);
+        for (uint8_t index = maxFiles - 1; index > 0; index--)
+        {
+            rotatedPath(from, index - 1);
+            rotatedPath(to, index);
+            renameFile(from, to);
+        }
+        openFile();
+    }
+
+public:
+#if defined(LOG_FILE_FS)
+    // fs is LittleFS, SD or SPIFFS, mounted before begin()
+    LogFileSink(fs::FS &fs, const char *path, uint8_t level = 5)
+        : LogSink(level), fs(fs), used(0), fileSize(0), maxSize(64 * 1024), maxFiles(4), flushLevel(1), flushMs(5000),
+          bufferedAt(0), writes(0), dropped(0)
+    {
+        snprintf(this->path, sizeof(this->path), "%s", path);
+    }
+#else
+    explicit LogFileSink(const char *path, uint8_t level = 5)
+        : LogSink(level), fd(-1), used(0), fileSize(0), maxSize(64 * 1024), maxFiles(4), flushLevel(1), flushMs(5000),
+          bufferedAt(0), writes(0), dropped(0)
+    {
+        snprintf(this->path, sizeof(this->path), "%s", path);
+    }
+#endif
+
+    ~LogFileSink() override
+    {
+        flush();
+        closeFile();
+    }
+
+    // Opens the file to append to, false when it cannot be opened. Records are dropped until it is.
+    bool begin()
+    {
+        lockWrites();
+        bool opened = isOpen() || openFile();
+        unlockWrites();
+        return opened;
+    }
+
+    // Rotates once a file holds maxSize bytes and keeps maxFiles files, 1 starts the file over
+    void setRotation(size_t maxSize, uint8_t maxFiles)
+    {
+        this->maxSize = maxSize;
+        this->maxFiles = maxFiles > 0 ? maxFiles : 1;
+    }
+
+    // Records at level or more severe are written out at once, 0 leaves it to the timer
+    void setFlushLevel(uint8_t level) { flushLevel = level; }
+
+    // Longest a record stays in RAM, checked on each write and in update(). 0 waits for full blocks.
+    void setFlushInterval(uint32_t ms) { flushMs = ms; }
+
+    static uint32_t now()
+    {
+#if defined(ARDUINO)
+        return millis();
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    void write(uint8_t level, const char *data, size_t size) override
+    {
+        lockWrites();
+        if (!isOpen())
+        {
+            dropped += static_cast<uint32_t>(size);
+            unlockWrites();
+            return;
+        }
+        if (fileSize + used >= maxSize)
+        {
+            writeOut();
+            rotate();
+        }
+
+        uint32_t time = now();
+        if (used == 0)
+        {
+            bufferedAt = time;
+        }
+        while (size > 0)
+        {
+            size_t limit = BlockSize - fileSize % BlockSize; // To the next block boundary of the file
+            size_t n = size < limit - used ? size : limit - used;
+            memcpy(block + used, data, n);
+            used += n;
+            data += n;
+            size -= n;
+            if (used == limit)
+            {
+                writeOut();
+                bufferedAt = time;
+            }
+        }
+
+        if ((level != 0 && level <= flushLevel) || flushDue(time))
+        {
+            writeOut();
+            syncFile();
+        }
+        unlockWrites();
+    }
+
+    void flush() override
+    {
+        lockWrites();
+        if (isOpen())
+        {
+            writeOut();
+            syncFile();
+        }
+        unlockWrites();
+    }
+
+    // Call from loop() to flush on the timer while no records come in
+    void update(uint32_t now = LogFileSink::now())
+    {
+        lockWrites();
+        if (isOpen() && flushDue(now))
+        {
+            writeOut();
+            syncFile();
+        }
+        unlockWrites();
+    }
+
+    size_t buffered() const { return used; }
+    size_t size() const { return fileSize; } // Bytes in the current file
+    uint32_t fileWrites() const { return writes; } // Whole blocks and flushes
+    uint32_t droppedBytes() const { return dropped; }
+};
+
+#endif
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <crc.h>
+#include "LogSink.h"
+#if defined(ESP32)
+#include <esp_attr.h>
+#include <freertos/FreeRTOS.h>
+#elif !defined(ARDUINO)
+#include <mutex>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Flight Recorder
+ *
+ * Keeps the latest log records in RAM that is not cleared at reset, so what was logged before
+ * a crash, watchdog or soft reset can be read back on the next boot. Power loss clears it.
+ *
+ *   control   magic, capacity, boots, CRC16 of those, then tail, used and next sequence
+ *   records   u32 sequence, u16 size, u8 level, u8 boot, u16 CRC16 of the first 8 bytes and the text, text
+ *
+ * A record is copied in first and counted last, a reset in the middle of a write loses only
+ * that record. On boot begin() checks the control block and walks the records, keeping them up
+ * to the first one whose CRC or sequence is wrong.
+ *-------------------------------------------------------------------------------------*/
+
+// Where LOG_FLIGHT_STORAGE puts the buffer. RTC slow memory on ESP32 also survives deep sleep,
+// use __NOINIT_ATTR for a buffer larger than it.
+#ifndef LOG_FLIGHT_ATTR
+#if defined(ESP32)
+#define LOG_FLIGHT_ATTR RTC_NOINIT_ATTR
+#elif defined(ARDUINO_ARCH_RP2040)
+#define LOG_FLIGHT_ATTR __attribute__((section(".uninitialized_data")))
+#elif defined(ARDUINO)
+#define LOG_FLIGHT_ATTR __attribute__((section(".noinit")))
+#else
+#define LOG_FLIGHT_ATTR
+#endif
+#endif
+
+// Smallest buffer a LogFlightRecorder uses, the control block and room for records of 15 bytes.
+// A recorder given less keeps nothing.
+#define LOG_FLIGHT_MIN_SIZE 128
+
+// Declares a buffer for a LogFlightRecorder that the startup code leaves alone
+#define LOG_FLIGHT_STORAGE(name, size)                                                              \
+    static_assert((size) >= LOG_FLIGHT_MIN_SIZE, "LOG_FLIGHT_STORAGE needs LOG_FLIGHT_MIN_SIZE bytes"); \
+    LOG_FLIGHT_ATTR static uint32_t name[(size) / 4]
+
+// One recovered record, text is only valid during the callback
+struct LogFlightRecord
+{
+    uint32_t sequence;
+    uint8_t level;
+    uint8_t boot; // Low byte of boots() when it was written
+    const char *text;
+    size_t size;
+};
+
+class LogFlightRecorder : public LogSink
+{
+private:
+    static const uint32_t magic = 0x464C4F47; // "FLOG"
+    static const size_t headerSize = 10;
+    static const size_t maxText = 256;
+
+    struct Control
+    {
+        uint32_t magic;
+        uint32_t capacity;
+        uint32_t boots;
+        uint16_t crc; // Of the fields above
+        uint16_t reserved;
+        uint32_t tail; // Offset of the oldest record
+        uint32_t used; // Bytes of complete records, a record counts once it is fully written
+        uint32_t sequence;
+    };
+
+    Control *control;
+    uint8_t *data;
+    uint32_t capacity;
+    bool recovered;
+#if defined(ESP32)
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#elif !defined(ARDUINO)
+    std::mutex lock;
+#endif
+
+    static uint16_t crc(const void *bytes, size_t size)
+    {
+        return calculateCRC16(static_cast<uint8_t *>(const_cast<void *>(bytes)), static_cast<uint16_t>(size));
+    }
+
+    uint16_t controlCrc() const { return crc(control, offsetof(Control, crc)); }
+
+    // CRC of the record header and its text, the text may wrap around the end of the buffer
+    uint16_t recordCrc(const uint8_t *header, uint32_t textOffset, size_t size) const
+    {
+        uint16_t check = crc(header, 8);
+        size_t first = size <= capacity - textOffset ? size : capacity - textOffset;
+        check = calculateCRC16(data + textOffset, static_cast<uint16_t>(first), check);
+        return calculateCRC16(data, static_cast<uint16_t>(size - first), check);
+    }
+
+    // Offsets stay below twice the capacity, a compare is cheaper than a division
+    uint32_t wrap(uint32_t offset) const { return offset >= capacity ? offset - capacity : offset; }
+
+    void copyIn(uint32_t offset, const void *from, size_t size)
+    {
+        if (size <= capacity - offset)
+        {
+            memcpy(data + offset, from, size);
+            return;
+        }
+        size_t first = capacity - offset;
+        memcpy(data + offset, from, first);
+        memcpy(data, static_cast<const uint8_t *>(from) + first, size - first);
+    }
+
+    void copyOut(uint32_t offset, void *to, size_t size) const
+    {
+        if (size <= capacity - offset)
+        {
+            memcpy(to, data + offset, size);
+            return;
+        }
+        size_t first = capacity - offset;
+        memcpy(to, data + offset, first);
+        memcpy(static_cast<uint8_t *>(to) + first, data, size - first);
+    }
+
+    void readHeader(uint32_t offset, uint8_t *header, uint32_t &sequence, uint16_t &size) const
+    {
+        copyOut(offset, header, headerSize);
+        memcpy(&sequence, header, 4);
+        memcpy(&size, header + 4, 2);
+    }
+
+    // False when the CRC of the record at offset does not match its header and text
+    bool checkRecord(uint32_t offset, const uint8_t *header, uint16_t size) const
+    {
+        uint16_t check;
+        memcpy(&check, header + 8, 2);
+        return check == recordCrc(header, wrap(offset + headerSize), size);
+    }
+
+    // Keeps the records up to the first broken one, returns how many were kept
+    uint32_t validate()
+    {
+        if (control->tail >= capacity || control->used > capacity)
+        {
+            control->tail = 0;
+            control->used = 0;
+            return 0;
+        }
+
+        uint8_t header[headerSize];
+        uint32_t offset = control->tail;
+        uint32_t kept = 0;
+        uint32_t used = 0;
+        uint32_t expected = 0;
+        while (used + headerSize <= control->used)
+        {
+            uint32_t sequence;
+            uint16_t size;
+            readHeader(offset, header, sequence, size);
+            if (used + headerSize + size > control->used || !checkRecord(offset, header, size) || (kept > 0 && sequence != expected))
+            {
+                break;
+            }
+            expected = sequence + 1;
+            used += headerSize + size;
+            offset = wrap(offset + headerSize + size);
+            kept++;
+        }
+        control->used = used;
+        if (kept > 0)
+        {
+            control->sequence = expected;
+        }
+        return kept;
+    }
+
+    void lockWrites()
+    {
+#if defined(ESP32)
+        portENTER_CRITICAL(&lock);
+#elif !defined(ARDUINO)
+        lock.lock();
+#endif
+    }
+
+    void unlockWrites()
+    {
+#if defined(ESP32)
+        portEXIT_CRITICAL(&lock);
+#elif !defined(ARDUINO)
+        lock.unlock();
+#endif
+    }
+
+public:
+    // memory must be 4 byte aligned, use LOG_FLIGHT_STORAGE to declare it. With less than
+    // LOG_FLIGHT_MIN_SIZE bytes the recorder is off, memory is not touched and writes are dropped.
+    LogFlightRecorder(void *memory, size_t size, uint8_t level = 5)
+        : LogSink(level), control(static_cast<Control *>(memory)), data(static_cast<uint8_t *>(memory) + sizeof(Control)),
+          capacity(size >= LOG_FLIGHT_MIN_SIZE ? static_cast<uint32_t>(size - sizeof(Control)) : 0), recovered(false)
+    {
+    }
+
+    // Call once at boot before the first write. True when records from before the reset were kept.
+    bool begin()
+    {
+        if (capacity == 0)
+        {
+            return false;
+        }
+        bool valid = control->magic == magic && control->capacity == capacity && control->crc == controlCrc();
+        recovered = valid && validate() > 0;
+        if (!valid)
+        {
+            control->magic = magic;
+            control->capacity = capacity;
+            control->boots = 0;
+            control->tail = 0;
+            control->used = 0;
+            control->sequence = 0;
+        }
+        control->boots++;
+        control->crc = controlCrc();
+        return recovered;
+    }
+
+    bool hasRecovered() const { return recovered; }
+    uint32_t boots() const { return capacity > 0 ? control->boots : 0; }
+    size_t used() const { return capacity > 0 ? control->used : 0; }
+
+    // Longest text kept per record, longer records are cut
+    size_t maxRecord() const
+    {
+        size_t quarter = capacity / 4 > headerSize ? capacity / 4 - headerSize : 0;
+        return quarter < maxText ? quarter : maxText;
+    }
+
+    // Two memcpy and a CRC of the header and text, the oldest records make room
+    void write(uint8_t level, const char *text, size_t size) override
+    {
+        if (capacity == 0)
+        {
+            return;
+        }
+        size = size < maxRecord() ? size : maxRecord();
+        const uint32_t need = static_cast<uint32_t>(headerSize + size);
+
+        lockWrites();
+        while (control->used + need > capacity && control->used > 0)
+        {
+            uint16_t oldest;
+            copyOut(wrap(control->tail + 4), &oldest, 2);
+            uint32_t length = headerSize + oldest;
+            length = length < control->used ? length : control->used;
+            control->used -= length;
+            control->tail = wrap(control->tail + length);
+        }
+
+        uint8_t header[headerSize];
+        uint32_t sequence = control->sequence;
+        uint16_t length = static_cast<uint16_t>(size);
+        memcpy(header, &sequence, 4);
+        memcpy(header + 4, &length, 2);
+        header[6] = level;
+        header[7] = static_cast<uint8_t>(control->boots);
+        uint16_t check = calculateCRC16(reinterpret_cast<uint8_t *>(const_cast<char *>(text)), static_cast<uint16_t>(size), crc(header, 8));
+        memcpy(header + 8, &check, 2);
+
+        uint32_t offset = wrap(control->tail + control->used);
+        copyIn(wrap(offset + headerSize), text, size);
+        copyIn(offset, header, headerSize);
+        control->sequence = sequence + 1;
+        control->used += need; // Commits the record
+        unlockWrites();
+    }
+
+    // Calls callback(const LogFlightRecord &) for the last records at maxLevel and more severe,
+    // oldest first. Meant for boot, before the logger writes again.
+    template <typename Callback>
+    size_t forEach(Callback callback, uint8_t maxLevel = 5, size_t last = static_cast<size_t>(-1)) const
+    {
+        size_t matching = 0;
+        if (capacity == 0)
+        {
+            return 0;
+        }
+        for (int pass = 0; pass < 2; pass++)
+        {
+            size_t index = 0;
+            size_t skip = matching > last ? matching - last : 0;
+            uint32_t offset = control->tail;
+            uint32_t walked = 0;
+            while (walked < control->used)
+            {
+                uint8_t header[headerSize];
+                uint32_t sequence;
+                uint16_t size;
+                readHeader(offset, header, sequence, size);
+                if (header[6] <= maxLevel)
+                {
+                    if (pass == 1 && index >= skip)
+                    {
+                        char text[maxText];
+                        size_t copied = size < sizeof(text) ? size : sizeof(text);
+                        copyOut(wrap(offset + headerSize), text, copied);
+                        LogFlightRecord record = {sequence, header[6], header[7], text, copied};
+                        callback(record);
+                    }
+                    index++;
+                }
+                walked += headerSize + size;
+                offset = wrap(offset + headerSize + size);
+            }
+            matching = index;
+        }
+        return matching < last ? matching : last;
+    }
+
+#if defined(ARDUINO)
+    // Prints the last records at maxLevel and more severe, e.g. dump(Serial, LOG_LEVEL_WARNING, 200)
+    size_t dump(Print &out, uint8_t maxLevel = 5, size_t last = static_cast<size_t>(-1)) const
+    {
+        return forEach([&out](const LogFlightRecord &record)
+                       { out.write(reinterpret_cast<const uint8_t *>(record.text), record.size); },
+                       maxLevel, last);
+    }
+#endif
+
+    void clear()
+    {
+        if (capacity == 0)
+        {
+            return;
+        }
+        lockWrites();
+        control->used = 0;
+        unlockWrites();
+    }
+};
@@ -0,0 +1,437 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "format.h"
+
+/**--------------------------------------------------------------------------------------
+ * Key-Value Records
+ *
+ * Encoders behind LOG_KV. A record is one JSON object on its own line, or one CBOR map for a
+ * CBOR sequence, with the time, level, tag and event first and then the fields:
+ *
+ *   {"ms":1234,"lvl":"warn","tag":"MOTOR","ev":"stall","rpm":1200,"amps":3.25,"ok":false}
+ *
+ * Keys are literals. Each is turned into its quoted and escaped JSON text, or its CBOR header
+ * and bytes, at compile time. Values are written straight to the output, JSON numbers through
+ * afmt's converters and CBOR numbers as their binary encoding. Nothing is built in between.
+ *
+ * The output only needs write(const char *, size_t) and push_back(char).
+ *-------------------------------------------------------------------------------------*/
+
+namespace logkv
+{
+    // Indexed by level, LOG_LEVEL_ERROR is 1
+    inline const char *levelName(uint8_t level)
+    {
+        static const char *const names[] = {"print", "error", "warn", "info", "debug", "verbose"};
+        return names[level < 6 ? level : 0];
+    }
+
+    // Bytes of c in a JSON string. Writes them to out when it is not null.
+    constexpr size_t escapeChar(char c, char *out)
+    {
+        const char hex[] = "0123456789abcdef";
+        const uint8_t byte = static_cast<uint8_t>(c);
+        char shortEscape = byte == '"' ? '"' : byte == '\\' ? '\\' : byte == '\n' ? 'n' : byte == '\r' ? 'r' : byte == '\t' ? 't' : 0;
+        if (byte >= 0x20 && shortEscape == 0)
+        {
+            if (out != nullptr)
+            {
+                out[0] = c;
+            }
+            return 1;
+        }
+        if (shortEscape != 0)
+        {
+            if (out != nullptr)
+            {
+                out[0] = '\\';
+                out[1] = shortEscape;
+            }
+            return 2;
+        }
+        if (out != nullptr)
+        {
+            out[0] = '\\';
+            out[1] = 'u';
+            out[2] = '0';
+            out[3] = '0';
+            out[4] = hex[byte >> 4];
+            out[5] = hex[byte & 15];
+        }
+        return 6;
+    }
+
+    // Bytes of a CBOR head for a length or value
+    constexpr size_t cborHeadSize(uint64_t value)
+    {
+        return value < 24 ? 1 : value <= 0xFF ? 2 : value <= 0xFFFF ? 3 : value <= 0xFFFFFFFF ? 5 : 9;
+    }
+
+    constexpr size_t writeCborHead(char *out, uint8_t major, uint64_t value)
+    {
+        const size_t size = cborHeadSize(value);
+        const uint8_t info = size == 1 ? static_cast<uint8_t>(value) : size == 2 ? 24 : size == 3 ? 25 : size == 5 ? 26 : 27;
+        out[0] = static_cast<char>((major << 5) | info);
+        for (size_t i = 1; i < size; i++)
+        {
+            out[i] = static_cast<char>(value >> (8 * (size - 1 - i)));
+        }
+        return size;
+    }
+
+    constexpr size_t length(const char *text)
+    {
+        size_t size = 0;
+        while (text[size] != '\0')
+        {
+            size++;
+        }
+        return size;
+    }
+
+    // Integers written as numbers, bool and char have their own overloads
+    template <typename T>
+    struct IsInteger : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>
+    {
+    };
+
+    // String, std::string and anything else with c_str() and length()
+    template <typename T, typename = void>
+    struct IsStringObject : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct IsStringObject<T, decltype((void)std::declval<const T &>().c_str(), (void)std::declval<const T &>().length())> : std::true_type
+    {
+    };
+
+    /**--------------------------------------------------------------------------------------
+     * JSON Lines
+     *-------------------------------------------------------------------------------------*/
+
+    namespace json
+    {
+        // Bytes of ,"key": with the key escaped
+        constexpr size_t keySize(const char *key)
+        {
+            size_t size = 4;
+            for (size_t i = 0; key[i] != '\0'; i++)
+            {
+                size += escapeChar(key[i], nullptr);
+            }
+            return size;
+        }
+
+        template <size_t N>
+        struct Key
+        {
+            char text[N];
+
+            constexpr explicit Key(const char *key) : text()
+            {
+                size_t pos = 0;
+                text[pos++] = ',';
+                text[pos++] = '"';
+                for (size_t i = 0; key[i] != '\0'; i++)
+                {
+                    pos += escapeChar(key[i], text + pos);
+                }
+                text[pos++] = '"';
+                text[pos++] = ':';
+            }
+        };
+
+        // Copies runs that need no escape in one write
+        template <typename Out>
+        inline void writeString(Out &out, const char *text, size_t size)
+        {
+            out.push_back('"');
+            size_t start = 0;
+            for (size_t i = 0; i < size; i++)
+            {
+                const uint8_t byte = static_cast<uint8_t>(text[i]);
+                if (byte >= 0x20 && byte != '"' && byte != '\\')
+                {
+                    continue;
+                }
+                out.write(text + start, i - start);
+                char escaped[6] = {};
+                out.write(escaped, escapeChar(text[i], escaped));
+                start = i + 1;
+            }
+            out.write(text + start, size - start);
+            out.push_back('"');
+        }
+
+        // Through afmt's "{}" converters, null when the text does not fit
+        template <typename Out, typename T>
+        inline void writeNumber(Out &out, T number)
+        {
+            char text[32];
+            afmt::buffer digits(text);
+            afmt::to_string(number, digits, afmt::format_specs());
+            if (digits.is_truncated())
+            {
+                out.write("null", 4);
+                return;
+            }
+            out.write(digits.data(), digits.size());
+        }
+
+        template <typename Out, typename T, typename std::enable_if<IsInteger<T>::value, int>::type = 0>
+        inline void value(Out &out, T number)
+        {
+            writeNumber(out, number);
+        }
+
+        template <typename Out, typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+        inline void value(Out &out, T number)
+        {
+            writeNumber(out, static_cast<typename std::underlying_type<T>::type>(number));
+        }
+
+        // NaN and infinity have no JSON number
+        template <typename Out>
+        inline void value(Out &out, double number)
+        {
+            if (number != number || number - number != 0)
+            {
+                out.write("null", 4);
+                return;
+            }
+            writeNumber(out, number);
+        }
+
+        template <typename Out>
+        inline void value(Out &out, float number) { value(out, static_cast<double>(number)); }
+
+        template <typename Out>
+        inline void value(Out &out, bool flag) { flag ? out.write("true", 4) : out.write("false", 5); }
+
+        template <typename Out>
+        inline void value(Out &out, char c) { writeString(out, &c, 1); }
+
+        template <typename Out>
+        inline void value(Out &out, const char *text)
+        {
+            if (text == nullptr)
+            {
+                out.write("null", 4);
+                return;
+            }
+            writeString(out, text, strlen(text));
+        }
+
+        template <typename Out>
+        inline void value(Out &out, char *text) { value(out, static_cast<const char *>(text)); }
+
+        template <typename Out>
+        inline void value(Out &out, decltype(nullptr)) { out.write("null", 4); }
+
+        template <typename Out, typename T, typename std::enable_if<IsStringObject<T>::value, int>::type = 0>
+        inline void value(Out &out, const T &text)
+        {
+            writeString(out, text.c_str(), text.length());
+        }
+
+        template <typename Out>
+        inline void head(Out &out, uint8_t level, const char *tag, const char *event)
+        {
+            out.write("\"lvl\":\"", 7);
+            const char *name = levelName(level);
+            out.write(name, strlen(name));
+            out.write("\",\"tag\":", 8);
+            value(out, tag);
+            out.write(",\"ev\":", 6);
+            value(out, event);
+        }
+
+        // Opens a record without a time
+        template <typename Out>
+        inline void begin(Out &out, size_t fields, uint8_t level, const char *tag, const char *event)
+        {
+            (void)fields;
+            out.push_back('{');
+            head(out, level, tag, event);
+        }
+
+        // Opens a record, timeKey is "ms" or "us"
+        template <typename Out>
+        inline void begin(Out &out, size_t fields, const char *timeKey, uint32_t time, uint8_t level, const char *tag, const char *event)
+        {
+            (void)fields;
+            out.write("{\"", 2);
+            out.write(timeKey, strlen(timeKey));
+            out.write("\":", 2);
+            writeNumber(out, time);
+            out.push_back(',');
+            head(out, level, tag, event);
+        }
+
+        template <typename Out, size_t N, typename T>
+        inline void field(Out &out, const Key<N> &key, const T &fieldValue)
+        {
+            out.write(key.text, N);
+            value(out, fieldValue);
+        }
+
+        template <typename Out>
+        inline void end(Out &out) { out.write("}\n", 2); }
+    } // namespace json
+
+    /**--------------------------------------------------------------------------------------
+     * CBOR (RFC 8949), one map per record
+     *-------------------------------------------------------------------------------------*/
+
+    namespace cbor
+    {
+        constexpr size_t keySize(const char *key) { return cborHeadSize(length(key)) + length(key); }
+
+        template <size_t N>
+        struct Key
+        {
+            char text[N];
+
+            constexpr explicit Key(const char *key) : text()
+            {
+                size_t pos = writeCborHead(text, 3, length(key));
+                for (size_t i = 0; key[i] != '\0'; i++)
+                {
+                    text[pos++] = key[i];
+                }
+            }
+        };
+
+        template <typename Out>
+        inline void writeHead(Out &out, uint8_t major, uint64_t value)
+        {
+            char head[9] = {};
+            out.write(head, writeCborHead(head, major, value));
+        }
+
+        template <typename Out>
+        inline void writeString(Out &out, const char *text, size_t size)
+        {
+            writeHead(out, 3, size);
+            out.write(text, size);
+        }
+
+        template <typename Out, typename T, typename std::enable_if<IsInteger<T>::value && std::is_signed<T>::value, int>::type = 0>
+        inline void value(Out &out, T number)
+        {
+            const int64_t wide = number;
+            wide < 0 ? writeHead(out, 1, static_cast<uint64_t>(-1 - wide)) : writeHead(out, 0, static_cast<uint64_t>(wide));
+        }
+
+        template <typename Out, typename T, typename std::enable_if<IsInteger<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+        inline void value(Out &out, T number)
+        {
+            writeHead(out, 0, number);
+        }
+
+        template <typename Out, typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+        inline void value(Out &out, T number)
+        {
+            value(out, static_cast<typename std::underlying_type<T>::type>(number));
+        }
+
+        template <typename Out>
+        inline void value(Out &out, float number)
+        {
+            uint32_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            char bytes[5] = {static_cast<char>(0xFA), static_cast<char>(bits >> 24), static_cast<char>(bits >> 16),
+                             static_cast<char>(bits >> 8), static_cast<char>(bits)};
+            out.write(bytes, sizeof(bytes));
+        }
+
+        template <typename Out>
+        inline void value(Out &out, double number)
+        {
+            if (sizeof(double) == 4)
+            {
+                value(out, static_cast<float>(number));
+                return;
+            }
+            uint64_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            char bytes[9] = {static_cast<char>(0xFB)};
+            for (size_t i = 1; i < sizeof(bytes); i++)
+            {
+                bytes[i] = static_cast<char>(bits >> (8 * (8 - i)));
+            }
+            out.write(bytes, sizeof(bytes));
+        }
+
+        template <typename Out>
+        inline void value(Out &out, bool flag) { out.push_back(static_cast<char>(flag ? 0xF5 : 0xF4)); }
+
+        template <typename Out>
+        inline void value(Out &out, char c) { writeString(out, &c, 1); }
+
+        template <typename Out>
+        inline void value(Out &out, const char *text)
+        {
+            if (text == nullptr)
+            {
+                out.push_back(static_cast<char>(0xF6));
+                return;
+            }
+            writeString(out, text, strlen(text));
+        }
+
+        template <typename Out>
+        inline void value(Out &out, char *text) { value(out, static_cast<const char *>(text)); }
+
+        template <typename Out>
+        inline void value(Out &out, decltype(nullptr)) { out.push_back(static_cast<char>(0xF6)); }
+
+        template <typename Out, typename T, typename std::enable_if<IsStringObject<T>::value, int>::type = 0>
+        inline void value(Out &out, const T &text)
+        {
+            writeString(out, text.c_str(), text.length());
+        }
+
+        template <typename Out>
+        inline void head(Out &out, uint8_t level, const char *tag, const char *event)
+        {
+            out.write("\x63lvl", 4);
+            value(out, levelName(level));
+            out.write("\x63tag", 4);
+            value(out, tag);
+            out.write("\x62" "ev", 3);
+            value(out, event);
+        }
+
+        template <typename Out>
+        inline void begin(Out &out, size_t fields, uint8_t level, const char *tag, const char *event)
+        {
+            writeHead(out, 5, fields + 3);
+            head(out, level, tag, event);
+        }
+
+        template <typename Out>
+        inline void begin(Out &out, size_t fields, const char *timeKey, uint32_t time, uint8_t level, const char *tag, const char *event)
+        {
+            writeHead(out, 5, fields + 4);
+            value(out, timeKey);
+            value(out, time);
+            head(out, level, tag, event);
+        }
+
+        template <typename Out, size_t N, typename T>
+        inline void field(Out &out, const Key<N> &key, const T &fieldValue)
+        {
+            out.write(key.text, N);
+            value(out, fieldValue);
+        }
+
+        template <typename Out>
+        inline void end(Out &out) { (void)out; }
+    } // namespace cbor
+} // namespace logkv
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if !defined(__AVR__)
+#include <atomic>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Log Limits
+ *
+ * State behind LOG_EVERY_N, LOG_EVERY_MS, LOG_ONCE, LOG_RATE_LIMITED and LOG_DEDUP. Each call
+ * site keeps a static LogSite. Its constructor is constexpr, so the site is constant initialized
+ * and the check is a load and compare without a guard variable. A site joins the list reported
+ * by logReportSuppressed() the first time it skips a record.
+ *-------------------------------------------------------------------------------------*/
+
+#if defined(__AVR__)
+template <typename T>
+using LogAtomic = T; // Single core without threads
+#else
+template <typename T>
+using LogAtomic = std::atomic<T>;
+#endif
+
+class LogSite;
+
+namespace _logger
+{
+    // Logger.cpp
+    void addSite(LogSite &site);                          // Links the site into the suppressed list once
+    bool rateAllow(uint32_t tagHash, uint32_t perSecond); // Takes a token from the bucket of the tag
+}
+
+class LogSite
+{
+public:
+    const char *const file;
+    const int line;
+    LogAtomic<uint32_t> suppressed;
+    LogAtomic<bool> listed;
+    LogSite *next;
+
+    constexpr LogSite(const char *file, int line) : file(file), line(line), suppressed(0), listed(false), next(nullptr) {}
+
+    void suppress()
+    {
+        suppressed++;
+        if (!listed)
+        {
+            _logger::addSite(*this);
+        }
+    }
+};
+
+// Passes the first call and every n-th after it, every call when n is 0 or 1
+class LogEveryN : public LogSite
+{
+private:
+    LogAtomic<uint32_t> count;
+
+public:
+    constexpr LogEveryN(const char *file, int line) : LogSite(file, line), count(0) {}
+
+    bool ready(uint32_t n)
+    {
+        if (n == 0 || count++ % n == 0)
+        {
+            return true;
+        }
+        suppress();
+        return false;
+    }
+};
+
+// Passes the first call and then at most once per period
+class LogEveryMs : public LogSite
+{
+private:
+    LogAtomic<uint32_t> last;
+    LogAtomic<bool> started;
+
+public:
+    constexpr LogEveryMs(const char *file, int line) : LogSite(file, line), last(0), started(false) {}
+
+    bool ready(uint32_t period, uint32_t now)
+    {
+        if (!started || now - last >= period)
+        {
+            last = now;
+            started = true;
+            return true;
+        }
+        suppress();
+        return false;
+    }
+};
+
+// Passes the first call only
+class LogOnce : public LogSite
+{
+private:
+    LogAtomic<bool> done;
+
+public:
+    constexpr LogOnce(const char *file, int line) : LogSite(file, line), done(false) {}
+
+    bool ready()
+    {
+#if defined(__AVR__)
+        bool first = !done;
+        done = true;
+#else
+        bool first = !done && !done.exchange(true);
+#endif
+        if (first)
+        {
+            return true;
+        }
+        suppress();
+        return false;
+    }
+};
+
+// Passes while the bucket of its tag has tokens, the bucket is shared with other sites of the tag
+class LogRateLimited : public LogSite
+{
+public:
+    constexpr LogRateLimited(const char *file, int line) : LogSite(file, line) {}
+
+    bool ready(uint32_t tagHash, uint32_t perSecond)
+    {
+        if (_logger::rateAllow(tagHash, perSecond))
+        {
+            return true;
+        }
+        suppress();
+        return false;
+    }
+};
+
+// Gates behind the LOG_EVERY_N, LOG_EVERY_MS, LOG_ONCE and LOG_RATE_LIMITED macros of logger.h. Each
+// ends in an else, so the gated statement may be followed by an else of an enclosing if.
+#define _IF_LOG_EVERY_N(n) \
+    if (static LogEveryN _log_site(__FILE__, __LINE__); !_log_site.ready(n)) {} else
+#define _IF_LOG_EVERY_MS(ms, now) \
+    if (static LogEveryMs _log_site(__FILE__, __LINE__); !_log_site.ready(ms, now)) {} else
+#define _IF_LOG_ONCE() \
+    if (static LogOnce _log_site(__FILE__, __LINE__); !_log_site.ready()) {} else
+#define _IF_LOG_RATE_LIMITED(tagHash, perSecond) \
+    if (static LogRateLimited _log_site(__FILE__, __LINE__); !_log_site.ready(tagHash, perSecond)) {} else
+
+// Token buckets shared by every LOG_RATE_LIMITED site of a tag, found by tag hash with open
+// addressing. A bucket holds one second worth of records, so a quiet tag may burst that many.
+// Not thread safe, Logger.cpp locks around it.
+template <size_t Slots>
+class LogRateTable
+{
+private:
+    struct Bucket
+    {
+        uint32_t hash;   // 0 for a free slot
+        uint32_t tokens; // Thousandths of a record
+        uint32_t last;   // millis() of the last refill
+    };
+
+    Bucket buckets[Slots];
+
+public:
+    LogRateTable() : buckets() {}
+
+    // True when the tag may log now. Once every slot is taken new tags are not limited.
+    bool allow(uint32_t hash, uint32_t perSecond, uint32_t now)
+    {
+        const uint32_t full = perSecond * 1000;
+        for (size_t i = hash % Slots, probes = 0; probes < Slots; i = (i + 1) % Slots, probes++)
+        {
+            Bucket &bucket = buckets[i];
+            if (bucket.hash == 0)
+            {
+                bucket.hash = hash;
+                bucket.tokens = full;
+                bucket.last = now;
+            }
+            if (bucket.hash != hash)
+            {
+                continue;
+            }
+
+            uint32_t elapsed = now - bucket.last;
+            bucket.last = now;
+            uint32_t refill = (elapsed < 1000 ? elapsed : 1000) * perSecond; // A full second refills the bucket
+            bucket.tokens = full - bucket.tokens > refill ? bucket.tokens + refill : full;
+            if (bucket.tokens < 1000)
+            {
+                return false;
+            }
+            bucket.tokens -= 1000;
+            return true;
+        }
+        return true;
+    }
+};
+
+// Remembers the last record written so an identical one is counted instead of written again.
+// Records are compared by a hash of their bytes, then by the size and the first PrefixSize bytes
+// of their text after the timestamp. Two records only differing past the prefix and with the same
+// hash are still taken as repeats, 1 in 2^32 for text that differs. Not thread safe, Logger.cpp
+// locks around it.
+class LogDedup
+{
+public:
+    static constexpr size_t PrefixSize = 32;
+
+private:
+    uint32_t hash;
+    size_t size;
+    uint32_t repeats;
+    uint8_t level;
+    bool valid;
+    char prefix[PrefixSize];
+
+public:
+    LogDedup() : hash(0), size(0), repeats(0), level(0), valid(false), prefix() {}
+
+    // FNV-1a over the record without the bytes in [skipBegin, skipEnd), e.g. the timestamp
+    static uint32_t hashRecord(const char *data, size_t size, size_t skipBegin = 0, size_t skipEnd = 0)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (i == skipBegin && skipEnd > skipBegin)
+            {
+                i = skipEnd - 1;
+                continue;
+            }
+            hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    // End of the "[time]" a text record starts with, after its color code, 0 without one. LOG_PRINTF
+    // text and the logger's own notices (level 0) carry no time, a bracket there is part of the text.
+    static size_t timeEnd(uint8_t level, const char *data, size_t size)
+    {
+        if (level == 0)
+        {
+            return 0;
+        }
+        size_t start = 0;
+        if (size > 0 && data[0] == '\033')
+        {
+            const char *color = static_cast<const char *>(memchr(data, 'm', size < 16 ? size : 16));
+            if (color == nullptr)
+            {
+                return 0;
+            }
+            start = color - data + 1;
+        }
+        if (start >= size || data[start] != '[')
+        {
+            return 0;
+        }
+        size_t left = size - start;
+        const char *close = static_cast<const char *>(memchr(data + start, ']', left < 32 ? left : 32));
+        return close != nullptr ? close - data + 1 : 0;
+    }
+
+    // True when the record repeats the last one, it is counted and should not be written. text is
+    // the record after its timestamp.
+    bool repeat(uint32_t recordHash, const char *text, size_t textSize)
+    {
+        if (valid && recordHash == hash && textSize == size &&
+            memcmp(text, prefix, textSize < PrefixSize ? textSize : PrefixSize) == 0)
+        {
+            repeats++;
+            return true;
+        }
+        return false;
+    }
+
+    // Starts comparing against a new record
+    void remember(uint8_t recordLevel, uint32_t recordHash, const char *text, size_t textSize)
+    {
+        hash = recordHash;
+        size = textSize;
+        level = recordLevel;
+        valid = true;
+        memcpy(prefix, text, textSize < PrefixSize ? textSize : PrefixSize);
+    }
+
+    // Repeats counted since the last call, with the level of the repeated record
+    uint32_t takeRepeats(uint8_t &recordLevel)
+    {
+        uint32_t count = repeats;
+        repeats = 0;
+        recordLevel = level;
+        return count;
+    }
+};
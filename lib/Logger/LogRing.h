@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**--------------------------------------------------------------------------------------
+ * Lock-free Log Ring
+ *
+ * Multi-producer single-consumer ring of variable length records. Producers reserve space
+ * with a CAS on the write index, copy their record and publish it by stamping its header.
+ * The consumer copies whole published records out in batches.
+ *
+ * Record layout, 8-byte aligned so a header never wraps:
+ *   [commit: position + 1][tag << 24 | size][payload ... padding]
+ *-------------------------------------------------------------------------------------*/
+
+struct LogRingStats
+{
+    uint32_t pushed;      // Records accepted
+    uint32_t dropped;     // Records rejected because the ring was full
+    uint32_t overwritten; // Oldest records discarded to make space
+    uint32_t peak;        // Most bytes in use at once
+};
+
+template <size_t Capacity>
+class LogRing
+{
+    static_assert(Capacity >= 64 && (Capacity & (Capacity - 1)) == 0, "LogRing capacity must be a power of two of at least 64");
+    static_assert(Capacity <= (1UL << 24), "LogRing capacity must fit the 24-bit record size");
+
+    struct Header
+    {
+        uint32_t commit; // Position + 1 once the record is complete
+        uint32_t size;   // Payload size and a caller tag. Both fields are accessed with __atomic builtins, an overwriting producer may race a reader
+    };
+
+    static const uint32_t mask = Capacity - 1;
+    static const uint32_t sizeMask = 0xFFFFFF;
+
+    alignas(8) uint8_t data[Capacity];
+    std::atomic<uint32_t> writeIndex;
+    std::atomic<uint32_t> readIndex;
+    std::atomic<uint32_t> pushedCount;
+    std::atomic<uint32_t> droppedCount;
+    std::atomic<uint32_t> overwrittenCount;
+    std::atomic<uint32_t> peakBytes;
+
+    static uint32_t recordSize(size_t payload) { return (sizeof(Header) + payload + 7) & ~static_cast<uint32_t>(7); }
+
+    Header *header(uint32_t position) { return reinterpret_cast<Header *>(data + (position & mask)); }
+
+    void copyIn(uint32_t position, const char *src, size_t size)
+    {
+        size_t offset = position & mask;
+        size_t first = size < Capacity - offset ? size : Capacity - offset;
+        memcpy(data + offset, src, first);
+        memcpy(data, src + first, size - first);
+    }
+
+    void copyOut(uint32_t position, char *dst, size_t size)
+    {
+        size_t offset = position & mask;
+        size_t first = size < Capacity - offset ? size : Capacity - offset;
+        memcpy(dst, data + offset, first);
+        memcpy(dst + first, data, size - first);
+    }
+
+    // Discards the oldest record if it is complete, false when it is still being written
+    bool dropOldest(uint32_t read)
+    {
+        Header *h = header(read);
+        if (__atomic_load_n(&h->commit, __ATOMIC_ACQUIRE) != read + 1)
+        {
+            return false;
+        }
+        if (readIndex.compare_exchange_strong(read, read + recordSize(__atomic_load_n(&h->size, __ATOMIC_RELAXED) & sizeMask)))
+        {
+            overwrittenCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool reserveAndWrite(const char *record, size_t size, bool overwrite, uint8_t tag)
+    {
+        if (size > maxRecord)
+        {
+            size = maxRecord;
+        }
+        const uint32_t need = recordSize(size);
+
+        uint32_t write;
+        uint32_t read;
+        while (true)
+        {
+            // Read first, the reader never passes a write index loaded after it, so write - read
+            // cannot underflow. Both are loaded again on every pass.
+            read = readIndex.load(std::memory_order_acquire);
+            write = writeIndex.load(std::memory_order_relaxed);
+            if (write - read + need > Capacity)
+            {
+                if (!overwrite || !dropOldest(read))
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (writeIndex.compare_exchange_weak(write, write + need, std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        Header *h = header(write);
+        __atomic_store_n(&h->size, static_cast<uint32_t>(size) | static_cast<uint32_t>(tag) << 24, __ATOMIC_RELAXED);
+        copyIn(write + sizeof(Header), record, size);
+        __atomic_store_n(&h->commit, write + 1, __ATOMIC_RELEASE);
+
+        pushedCount.fetch_add(1, std::memory_order_relaxed);
+        uint32_t used = write + need - read;
+        uint32_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (used > peak && !peakBytes.compare_exchange_weak(peak, used, std::memory_order_relaxed))
+        {
+        }
+        return true;
+    }
+
+    size_t copyRecords(char *out, size_t capacity, size_t maxRecords, uint8_t *tag)
+    {
+        size_t count = 0;
+        size_t records = 0;
+        uint32_t read = readIndex.load(std::memory_order_acquire);
+
+        while (records < maxRecords && read != writeIndex.load(std::memory_order_acquire))
+        {
+            Header *h = header(read);
+            if (__atomic_load_n(&h->commit, __ATOMIC_ACQUIRE) != read + 1)
+            {
+                break; // Next record is still being written
+            }
+
+            uint32_t sizeAndTag = __atomic_load_n(&h->size, __ATOMIC_RELAXED);
+            size_t size = sizeAndTag & sizeMask;
+            const uint32_t need = recordSize(size);
+            if (count + size > capacity)
+            {
+                if (count > 0)
+                {
+                    break;
+                }
+                size = capacity;
+            }
+            copyOut(read + sizeof(Header), out + count, size);
+
+            // Fails when a producer overwrote the record while it was copied, the copy is discarded
+            if (readIndex.compare_exchange_strong(read, read + need, std::memory_order_acq_rel))
+            {
+                count += size;
+                read += need;
+                records++;
+                if (tag != nullptr)
+                {
+                    *tag = static_cast<uint8_t>(sizeAndTag >> 24);
+                }
+            }
+        }
+        return count;
+    }
+
+public:
+    // Longest payload, longer records are truncated so one line cannot take the whole ring
+    static const size_t maxRecord = Capacity / 2 - sizeof(Header);
+
+    LogRing() : writeIndex(0), readIndex(0), pushedCount(0), droppedCount(0), overwrittenCount(0), peakBytes(0)
+    {
+        memset(data, 0, sizeof(data));
+    }
+
+    // Producer side, safe from any number of threads. Counts a drop when the record does not fit,
+    // with overwrite the oldest complete records are discarded instead. The tag is returned by pop().
+    bool push(const char *record, size_t size, bool overwrite = false, uint8_t tag = 0)
+    {
+        if (reserveAndWrite(record, size, overwrite, tag))
+        {
+            return true;
+        }
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Like push() without counting a drop, for producers that wait and retry
+    bool tryPush(const char *record, size_t size, uint8_t tag = 0)
+    {
+        return reserveAndWrite(record, size, false, tag);
+    }
+
+    // Consumer side, one thread at a time. Copies as many complete records as fit into out and
+    // returns the bytes copied. A record larger than out on its own is truncated.
+    size_t drain(char *out, size_t capacity)
+    {
+        return copyRecords(out, capacity, static_cast<size_t>(-1), nullptr);
+    }
+
+    // Like drain() for the oldest record only, with the tag it was pushed with
+    size_t pop(char *out, size_t capacity, uint8_t &tag)
+    {
+        return copyRecords(out, capacity, 1, &tag);
+    }
+
+    size_t used() const { return writeIndex.load(std::memory_order_relaxed) - readIndex.load(std::memory_order_relaxed); }
+    bool empty() const { return used() == 0; }
+
+    LogRingStats stats() const
+    {
+        return {pushedCount.load(std::memory_order_relaxed), droppedCount.load(std::memory_order_relaxed),
+                overwrittenCount.load(std::memory_order_relaxed), peakBytes.load(std::memory_order_relaxed)};
+    }
+
+    void resetStats()
+    {
+        pushedCount = 0;
+        droppedCount = 0;
+        overwrittenCount = 0;
+        peakBytes = 0;
+    }
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(ARDUINO)
+#include <Arduino.h>
+#endif
+#if !defined(__AVR__)
+#include "LogRing.h"
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Log Sinks
+ *
+ * With LOG_SINKS_ENABLE every record is formatted once and the same buffer is handed to each
+ * registered sink whose level lets it through. Records written with LOG_PRINTF carry level 0
+ * and reach every sink.
+ *-------------------------------------------------------------------------------------*/
+
+class LogSink
+{
+private:
+    uint8_t level;
+
+public:
+    explicit LogSink(uint8_t level = 5) : level(level) {} // LOG_LEVEL_VERBOSE
+    virtual ~LogSink() {}
+
+    // Called with the formatted record, data is only valid during the call
+    virtual void write(uint8_t level, const char *data, size_t size) = 0;
+    virtual void flush() {}
+
+    void setLevel(uint8_t level) { this->level = level; }
+    uint8_t getLevel() const { return level; }
+    bool accepts(uint8_t recordLevel) const { return recordLevel <= level; }
+};
+
+// Any output with write(const uint8_t *, size_t) and flush(), such as LOG_OUTPUT on the host
+template <typename Output>
+class LogOutputSink : public LogSink
+{
+private:
+    Output &out;
+
+public:
+    explicit LogOutputSink(Output &out, uint8_t level = 5) : LogSink(level), out(out) {}
+
+    void write(uint8_t, const char *data, size_t size) override { out.write(reinterpret_cast<const uint8_t *>(data), size); }
+    void flush() override { out.flush(); }
+};
+
+#if defined(ARDUINO)
+// Serial, another UART, or an open File from SD or LittleFS
+typedef LogOutputSink<Print> LogPrintSink;
+#endif
+
+// Hands each record to a function, e.g. to send it over UDP or MQTT
+class LogCallbackSink : public LogSink
+{
+public:
+    typedef void (*Callback)(uint8_t level, const char *data, size_t size, void *context);
+
+private:
+    Callback callback;
+    void *context;
+
+public:
+    LogCallbackSink(Callback callback, void *context = nullptr, uint8_t level = 5) : LogSink(level), callback(callback), context(context) {}
+
+    void write(uint8_t level, const char *data, size_t size) override { callback(level, data, size, context); }
+};
+
+#if !defined(__AVR__)
+// Keeps the latest records in RAM, the oldest are overwritten. Read them back for a crash report
+// or a diagnostics page.
+template <size_t Capacity>
+class LogRingSink : public LogSink
+{
+private:
+    LogRing<Capacity> ring;
+
+public:
+    explicit LogRingSink(uint8_t level = 5) : LogSink(level) {}
+
+    void write(uint8_t level, const char *data, size_t size) override { ring.push(data, size, true, level); }
+
+    // Moves the kept records into out, oldest first, returns the bytes copied
+    size_t read(char *out, size_t capacity) { return ring.drain(out, capacity); }
+    size_t used() const { return ring.used(); }
+    LogRingStats stats() const { return ring.stats(); }
+};
+#endif
+
+// Fixed size registry the logger writes through, sinks are registered by reference
+template <size_t MaxSinks>
+class LogSinkList
+{
+private:
+    LogSink *sinks[MaxSinks];
+
+public:
+    LogSinkList() : sinks() {}
+
+    // False when the sink is already registered or the list is full
+    bool add(LogSink &sink)
+    {
+        for (LogSink *&slot : sinks)
+        {
+            if (slot == &sink)
+            {
+                return false;
+            }
+        }
+        for (LogSink *&slot : sinks)
+        {
+            if (slot == nullptr)
+            {
+                slot = &sink;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void remove(LogSink &sink)
+    {
+        for (LogSink *&slot : sinks)
+        {
+            if (slot == &sink)
+            {
+                slot = nullptr;
+            }
+        }
+    }
+
+    // The same buffer goes to every sink that accepts the level
+    void write(uint8_t level, const char *data, size_t size)
+    {
+        for (LogSink *sink : sinks)
+        {
+            if (sink != nullptr && sink->accepts(level))
+            {
+                sink->write(level, data, size);
+            }
+        }
+    }
+
+    void flush()
+    {
+        for (LogSink *sink : sinks)
+        {
+            if (sink != nullptr)
+            {
+                sink->flush();
+            }
+        }
+    }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**--------------------------------------------------------------------------------------
+ * Log Statistics
+ *
+ * Counters behind LOG_STATS_ENABLE: records and bytes per level and per tag, time spent building
+ * records against time spent in the output write, the largest record and the records longer than
+ * LOG_STATIC_BUFFER_SIZE. Level 0 counts LOG_PRINTF and the logger's own notices. Not thread safe,
+ * Logger.cpp locks around it.
+ *-------------------------------------------------------------------------------------*/
+
+#ifndef LOG_STATS_TAG_SLOTS
+#define LOG_STATS_TAG_SLOTS 8 // Most tags counted on their own, a power of two
+#endif
+
+struct LogTagStats
+{
+    uint32_t hash; // 0 for a free slot
+    char tag[24];  // Copied from the first record of the tag, not terminated when 24 bytes long
+    uint32_t records;
+    uint32_t bytes;
+};
+
+struct LogStats
+{
+    uint32_t records[6]; // Indexed by level, LOG_LEVEL_ERROR is 1
+    uint32_t bytes[6];
+    uint32_t formatMicros;  // Building records, arguments and timestamp included
+    uint32_t outputMicros;  // Blocked in the write to LOG_OUTPUT, the sinks or the async ring
+    uint32_t largestRecord; // Bytes
+    uint32_t longRecords;   // Records longer than LOG_STATIC_BUFFER_SIZE, written in parts or cut
+    uint32_t cutRecords;    // Long records cut at LOG_STATIC_BUFFER_SIZE
+    uint32_t untrackedTags; // Tagged records not counted per tag because every slot was taken
+    LogTagStats tags[LOG_STATS_TAG_SLOTS];
+
+    uint32_t totalRecords() const
+    {
+        uint32_t total = 0;
+        for (uint32_t count : records)
+        {
+            total += count;
+        }
+        return total;
+    }
+
+    uint32_t totalBytes() const
+    {
+        uint32_t total = 0;
+        for (uint32_t count : bytes)
+        {
+            total += count;
+        }
+        return total;
+    }
+
+    // Counters of a tag by its hash, nullptr when it has none
+    const LogTagStats *findTag(uint32_t hash) const
+    {
+        const uint32_t mask = LOG_STATS_TAG_SLOTS - 1;
+        for (uint32_t i = hash & mask, probes = 0; probes < LOG_STATS_TAG_SLOTS; i = (i + 1) & mask, probes++)
+        {
+            if (tags[i].hash == hash)
+            {
+                return &tags[i];
+            }
+            if (tags[i].hash == 0)
+            {
+                break;
+            }
+        }
+        return nullptr;
+    }
+
+    // Counts bytes of a record, a long record is written in parts. tagHash is 0 for an untagged record.
+    void countBytes(uint8_t level, size_t size, uint32_t tagHash, const char *tag)
+    {
+        level = level < 6 ? level : 0;
+        bytes[level] += static_cast<uint32_t>(size);
+        LogTagStats *slot = tagSlot(tagHash, tag);
+        if (slot != nullptr)
+        {
+            slot->bytes += static_cast<uint32_t>(size);
+        }
+    }
+
+    // Counts a record once all its bytes are counted
+    void countRecord(uint8_t level, size_t recordSize, uint32_t tagHash, const char *tag)
+    {
+        level = level < 6 ? level : 0;
+        records[level]++;
+        largestRecord = recordSize > largestRecord ? static_cast<uint32_t>(recordSize) : largestRecord;
+        LogTagStats *slot = tagSlot(tagHash, tag);
+        if (slot != nullptr)
+        {
+            slot->records++;
+        }
+        else if (tagHash != 0)
+        {
+            untrackedTags++;
+        }
+    }
+
+    // Counts a record written at once
+    void count(uint8_t level, size_t size, uint32_t tagHash, const char *tag)
+    {
+        countBytes(level, size, tagHash, tag);
+        countRecord(level, size, tagHash, tag);
+    }
+
+    void reset()
+    {
+        *this = LogStats();
+    }
+
+private:
+    // Slot of a tag, taken on its first record. nullptr without a tag or once every slot is taken.
+    LogTagStats *tagSlot(uint32_t hash, const char *tag)
+    {
+        if (hash == 0)
+        {
+            return nullptr;
+        }
+        const uint32_t mask = LOG_STATS_TAG_SLOTS - 1;
+        for (uint32_t i = hash & mask, probes = 0; probes < LOG_STATS_TAG_SLOTS; i = (i + 1) & mask, probes++)
+        {
+            LogTagStats &slot = tags[i];
+            if (slot.hash == 0)
+            {
+                slot.hash = hash;
+                size_t length = tag != nullptr ? strlen(tag) : 0;
+                if (length > 0)
+                {
+                    memcpy(slot.tag, tag, length < sizeof(slot.tag) ? length : sizeof(slot.tag)); // A free slot is all zero
+                }
+            }
+            if (slot.hash == hash)
+            {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+};
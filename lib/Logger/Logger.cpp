@@ -1,116 +1,585 @@
 #include "log.h"
 
+#if LOG_MODE == LOG_MODE_ASYNC
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif !defined(ARDUINO)
+#include <chrono>
+#include <thread>
+#endif
+#endif
+
+#if defined(ESP32) || !defined(ARDUINO)
+#include <mutex>
+#endif
+
+// Records go through output() one at a time instead of straight to LOG_OUTPUT
+#define _LOG_OUTPUT_PER_RECORD (LOG_SINKS == LOG_SINKS_ENABLE || LOG_DEDUP == LOG_DEDUP_ENABLE)
+
 namespace _logger
 {
-#if LOG_LEVEL > LOG_LEVEL_DISABLE && LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
-    void vprintf(const char *format, va_list arg)
-    {
-        char buf[LOG_STATIC_BUFFER_SIZE];
-        char *temp = buf;
-        va_list copy;
-        va_copy(copy, arg);
-        int len = vsnprintf(temp, sizeof(buf), format, copy);
-        va_end(copy);
-        if (len < 0)
+    // Guards state shared between tasks, boards without threads need no lock
+#if defined(ESP32) || !defined(ARDUINO)
+    static std::mutex stateMutex;
+#define _LOG_LOCK() std::lock_guard<std::mutex> _log_lock(_logger::stateMutex)
+#else
+#define _LOG_LOCK()
+#endif
+
+    // Each task or thread keeps its own copy, single core boards share one
+#if defined(ESP32) || !defined(ARDUINO)
+#define _LOG_THREAD_LOCAL thread_local
+#else
+#define _LOG_THREAD_LOCAL
+#endif
+
+#if LOG_SINKS == LOG_SINKS_ENABLE
+    // Typed after LOG_OUTPUT, so the host build takes its stand-in as well as a Print on boards
+    static LogOutputSink<decltype(LOG_OUTPUT)> outputSink(LOG_OUTPUT);
+
+    // LOG_OUTPUT is registered on first use so the list never depends on static init order
+    static LogSinkList<LOG_SINKS_MAX> &sinks()
+    {
+        static LogSinkList<LOG_SINKS_MAX> list;
+        static bool registered = list.add(outputSink);
+        (void)registered;
+        return list;
+    }
+
+#endif
+
+#if _LOG_OUTPUT_PER_RECORD
+    static void emit(uint8_t level, const char *data, size_t size)
+    {
+#if LOG_SINKS == LOG_SINKS_ENABLE
+        sinks().write(level, data, size);
+#else
+        (void)level;
+        LOG_OUTPUT.write(reinterpret_cast<const uint8_t *>(data), size);
+#endif
+    }
+
+#if LOG_DEDUP == LOG_DEDUP_ENABLE
+    static LogDedup dedup;
+
+    // Timestamps differ between otherwise identical records, [begin, end) is left out of the comparison
+    static void timeSpan(uint8_t level, const char *data, size_t size, size_t &begin, size_t &end)
+    {
+        begin = 0;
+        end = 0;
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
+        (void)level;
+        if (size >= 10)
+        {
+            begin = 6; // u32 timestamp
+            end = 10;
+        }
+#elif LOG_TIME != LOG_TIME_DISABLE
+        end = LogDedup::timeEnd(level, data, size);
+#else
+        (void)level;
+        (void)data;
+        (void)size;
+#endif
+    }
+
+    // Call with the lock held
+    static void writeRepeats()
+    {
+        uint8_t level;
+        uint32_t repeats = dedup.takeRepeats(level);
+        if (repeats > 0)
+        {
+            char text[48];
+            int len = snprintf(text, sizeof(text), "[LOG] last message repeated %lu times" LOG_EOL, (unsigned long)repeats);
+            emit(level, text, len < (int)sizeof(text) ? len : sizeof(text) - 1);
+        }
+    }
+#endif
+
+    // The lock also keeps logAddSink() and logRemoveSink() from changing the sinks during a write
+    void output(uint8_t level, const char *data, size_t size)
+    {
+#if LOG_DEDUP == LOG_DEDUP_ENABLE
+        size_t timeBegin, timeEnd;
+        timeSpan(level, data, size, timeBegin, timeEnd);
+        uint32_t hash = LogDedup::hashRecord(data, size, timeBegin, timeEnd);
+#endif
+        _LOG_LOCK();
+#if LOG_DEDUP == LOG_DEDUP_ENABLE
+        if (dedup.repeat(hash, data + timeEnd, size - timeEnd))
         {
-            va_end(arg);
             return;
         }
-        if (len >= (int)sizeof(buf))
+        writeRepeats();
+        dedup.remember(level, hash, data + timeEnd, size - timeEnd);
+#endif
+        emit(level, data, size);
+    }
+#endif
+
+#if LOG_STATS == LOG_STATS_ENABLE
+    static LogStats stats = {};
+    static _LOG_THREAD_LOCAL StatsScope *statsScope = nullptr; // Innermost log call of this task
+
+    StatsScope::StatsScope(uint32_t tagHash, const char *tag)
+        : start(micros()), counted(0), partial(0), tagHash(tagHash), tag(tag), previous(statsScope)
+    {
+        statsScope = this;
+    }
+
+    StatsScope::~StatsScope()
+    {
+        uint32_t elapsed = micros() - start;
+        statsScope = previous;
+        if (previous != nullptr)
+        {
+            previous->counted += elapsed;
+        }
+        _LOG_LOCK();
+        stats.formatMicros += elapsed - counted;
+    }
+
+    void statsWrite(uint8_t level, const char *data, size_t size, bool recordEnd)
+    {
+        uint32_t start = micros();
+        _LOG_OUTPUT_WRITE(level, data, size);
+        uint32_t elapsed = micros() - start;
+
+        StatsScope *scope = statsScope;
+        uint32_t tagHash = scope != nullptr ? scope->tagHash : 0;
+        const char *tag = scope != nullptr ? scope->tag : nullptr;
+        size_t recordSize = size;
+        if (scope != nullptr)
+        {
+            scope->counted += elapsed;
+            recordSize += scope->partial;
+            scope->partial = recordEnd ? 0 : static_cast<uint32_t>(recordSize);
+        }
+
+        _LOG_LOCK();
+        stats.outputMicros += elapsed;
+        stats.countBytes(level, size, tagHash, tag);
+        if (recordEnd)
+        {
+            stats.countRecord(level, recordSize, tagHash, tag);
+            stats.longRecords += recordSize > size ? 1 : 0;
+        }
+    }
+#endif
+
+    void RecordWriter::overflow()
+    {
+#if _LOG_WHOLE_RECORDS
+        cut = true;
+#else
+        _LOG_WRITE_PART(level, data, size);
+        size = 0;
+#endif
+    }
+
+    void RecordWriter::finish()
+    {
+        if (cut)
         {
-            temp = (char *)malloc(len + 1);
-            if (temp == NULL)
+            // Ends the line so the next record starts on its own, LOG_PRINTF text is left as it is
+            static const char tail[] = "..." _LOG_RESET_COLOR LOG_EOL;
+            const size_t tailLength = sizeof(tail) - 1;
+            if (level > 0)
             {
-                va_end(arg);
-                return;
+                memcpy(data + size - tailLength, tail, tailLength);
             }
-            len = vsnprintf(temp, len + 1, format, arg);
+#if LOG_STATS == LOG_STATS_ENABLE
+            _LOG_LOCK();
+            stats.longRecords++;
+            stats.cutRecords++;
+#endif
         }
-        va_end(arg);
-        LOG_OUTPUT.print(temp);
-        if (temp != buf)
+        _LOG_WRITE(level, data, size);
+    }
+
+    static LogAtomic<uint32_t> kvDropped(0);
+
+    void RecordWriter::finishWhole()
+    {
+        if (!cut)
+        {
+            finish();
+            return;
+        }
+        kvDropped++;
+#if LOG_STATS == LOG_STATS_ENABLE
+        _LOG_LOCK();
+        stats.longRecords++;
+#endif
+    }
+
+    static LogSite *suppressedSites = nullptr;
+    static LogRateTable<LOG_RATE_LIMIT_SLOTS> rateTable;
+
+    void addSite(LogSite &site)
+    {
+        _LOG_LOCK();
+        if (!site.listed)
+        {
+            site.next = suppressedSites;
+            suppressedSites = &site;
+            site.listed = true;
+        }
+    }
+
+    bool rateAllow(uint32_t tagHash, uint32_t perSecond)
+    {
+        uint32_t now = millis();
+        _LOG_LOCK();
+        return rateTable.allow(tagHash, perSecond, now);
+    }
+
+#if LOG_LEVEL > LOG_LEVEL_DISABLE && LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
+    typedef int (*vsnprintf_t)(char *, size_t, const char *, va_list);
+
+    // Shared by the RAM and flash format string variants, print is vsnprintf or vsnprintf_P. vsnprintf
+    // cannot carry on where it stopped, so a line longer than the buffer is cut rather than formatted twice.
+    static void vprintfWith(uint8_t level, vsnprintf_t print, const char *format, va_list arg)
+    {
+        RecordWriter writer(level);
+        int len = print(writer.data, sizeof(writer.data), format, arg);
+        if (len < 0)
         {
-            free(temp);
+            return;
         }
+        writer.cut = len >= (int)sizeof(writer.data);
+        writer.size = writer.cut ? sizeof(writer.data) - 1 : len;
+        writer.finish();
+    }
+
+    void vprintf(uint8_t level, const char *format, va_list arg)
+    {
+        vprintfWith(level, vsnprintf, format, arg);
+    }
+
+    void printf(uint8_t level, const char *format, ...)
+    {
+        va_list arg;
+        va_start(arg, format);
+        vprintf(level, format, arg);
+        va_end(arg);
+    }
+
+#if defined(__AVR__)
+    void vprintf(uint8_t level, const __FlashStringHelper *format, va_list arg)
+    {
+        vprintfWith(level, vsnprintf_P, reinterpret_cast<const char *>(format), arg);
     }
 
-    void printf(const char *format, ...)
+    void printf(uint8_t level, const __FlashStringHelper *format, ...)
     {
         va_list arg;
         va_start(arg, format);
-        vprintf(format, arg);
+        vprintf(level, format, arg);
         va_end(arg);
     }
+#endif
 #endif // LOG_LEVEL > LOG_LEVEL_DISABLE
 
+#if LOG_MODE == LOG_MODE_ASYNC
+#if _LOG_OUTPUT_PER_RECORD
+#define _LOG_OUTPUT_LOST(data, size) output(0, data, size)
+#else
+#define _LOG_OUTPUT_LOST(data, size) LOG_OUTPUT.write(reinterpret_cast<const uint8_t *>(data), size)
+#endif
+
+    static LogRing<LOG_ASYNC_BUFFER_SIZE> ring;
+    static std::atomic_flag draining = ATOMIC_FLAG_INIT;
+    static std::atomic<bool> started(false);
+    static uint32_t reportedLost = 0;
+
+    // Writes every committed record to LOG_OUTPUT in batches, or record by record to output() so
+    // sinks see its level and repeats are counted. Only one drainer runs at a time, returns false when another one
+    // holds the ring.
+    static bool drain()
+    {
+        if (draining.test_and_set(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        static char batch[LOG_ASYNC_BATCH_SIZE];
+        size_t size;
+#if _LOG_OUTPUT_PER_RECORD
+        uint8_t level;
+        while ((size = ring.pop(batch, sizeof(batch), level)) > 0)
+        {
+            output(level, batch, size);
+        }
+#else
+        while ((size = ring.drain(batch, sizeof(batch))) > 0)
+        {
+            LOG_OUTPUT.write(reinterpret_cast<const uint8_t *>(batch), size);
+        }
+#endif
+
+        LogRingStats stats = ring.stats();
+        uint32_t lost = stats.dropped + stats.overwritten;
+        if (lost != reportedLost)
+        {
+            int len = snprintf(batch, sizeof(batch), "[LOG] %lu records lost" LOG_EOL, (unsigned long)(lost - reportedLost));
+            _LOG_OUTPUT_LOST(batch, len < (int)sizeof(batch) ? len : sizeof(batch) - 1);
+            reportedLost = lost;
+        }
+
+        draining.clear(std::memory_order_release);
+        return true;
+    }
+
+#if defined(ESP32)
+    static std::atomic<TaskHandle_t> task(nullptr);
+
+    static void drainTask(void *)
+    {
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_ASYNC_FLUSH_MS));
+            drain();
+        }
+    }
+
+    static void start()
+    {
+        TaskHandle_t handle;
+        xTaskCreatePinnedToCore(drainTask, "log", LOG_ASYNC_TASK_STACK, nullptr, LOG_ASYNC_TASK_PRIORITY, &handle, LOG_ASYNC_TASK_CORE);
+        task = handle;
+    }
+
+    static void wake()
+    {
+        TaskHandle_t handle = task;
+        if (handle != nullptr)
+        {
+            xTaskNotifyGive(handle);
+        }
+    }
+
+    static void wait()
+    {
+        wake();
+        vTaskDelay(1);
+    }
+#elif !defined(ARDUINO)
+    static void drainThread()
+    {
+        while (true)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_ASYNC_FLUSH_MS));
+            drain();
+        }
+    }
+
+    static void start()
+    {
+        std::thread(drainThread).detach();
+    }
+
+    static void wake() {}
+
+    static void wait()
+    {
+        std::this_thread::yield();
+    }
+#else
+    // No background task, the ring is drained by logFlush() and whenever a producer has to wait
+    static void start() {}
+    static void wake() {}
+
+    static void wait()
+    {
+        drain();
+    }
+#endif
+
+    void write(uint8_t level, const char *data, size_t size)
+    {
+        if (!started.load(std::memory_order_relaxed) && !started.exchange(true))
+        {
+            start();
+        }
+
+#if LOG_ASYNC_OVERFLOW == LOG_ASYNC_OVERFLOW_BLOCK
+        while (!ring.tryPush(data, size, level))
+        {
+            wait();
+        }
+#else
+        ring.push(data, size, LOG_ASYNC_OVERFLOW == LOG_ASYNC_OVERFLOW_OVERWRITE, level);
+#endif
+
+        if (ring.used() >= LOG_ASYNC_BUFFER_SIZE / 2)
+        {
+            wake();
+        }
+    }
+#endif // LOG_MODE == LOG_MODE_ASYNC
+
 #if LOG_TIME != LOG_TIME_DISABLE
+    // Each task or thread renders into its own cache
+    struct TimeCache
+    {
+        char text[16];
+        uint32_t value;       // Last rendered time
+        uint32_t secondStart; // Time at the start of the rendered second, for the split formats
+        uint8_t start;        // Offset of the first character
+        bool valid;
+    };
+
+    static _LOG_THREAD_LOCAL TimeCache timeCache;
+
+    // Writes value right aligned into [begin, end). Without full only the digits that differ from
+    // previous are written, usually one or two for consecutive log lines.
+    static void renderDigits(char *begin, char *end, uint32_t value, uint32_t previous, char pad, bool full)
+    {
+        char *p = end;
+        bool first = true;
+        while (p > begin && (full || first || value != previous))
+        {
+            *--p = (value == 0 && !first) ? pad : static_cast<char>('0' + value % 10);
+            value /= 10;
+            previous /= 10;
+            first = false;
+        }
+    }
+
+    static uint32_t timeNow()
+    {
+#if LOG_TIME == LOG_TIME_MICROS || LOG_TIME == LOG_TIME_SECONDS_MICROS
+        return micros();
+#elif LOG_TIME == LOG_TIME_CYCLES && defined(ESP32)
+        return ESP.getCycleCount();
+#elif LOG_TIME == LOG_TIME_CYCLES
+        return micros();
+#else
+        return millis();
+#endif
+    }
+
     const char *formatTime()
     {
-#if LOG_TIME == LOG_TIME_MICROS
-        static char timeFormat[12];
-        sprintf(timeFormat, "%11lu", micros());
+        TimeCache &cache = timeCache;
+        const uint32_t now = timeNow();
+        if (cache.valid && now == cache.value)
+        {
+            return cache.text + cache.start; // Same tick as the last line, nothing to render
+        }
+
+#if LOG_TIME == LOG_TIME_MICROS || LOG_TIME == LOG_TIME_CYCLES
+        // "%11lu", a 32-bit value has at most 10 digits
+        renderDigits(cache.text, cache.text + 11, now, cache.value, ' ', !cache.valid);
+        cache.text[11] = '\0';
+        cache.value = now;
+        cache.start = 0;
+        cache.valid = true;
+        return cache.text;
 #elif LOG_TIME == LOG_TIME_MILLIS
-        static char timeFormat[9];
-        sprintf(timeFormat, "%8lu", millis());
-#elif (LOG_TIME == LOG_TIME_HHMMSSMS) || (LOG_TIME == LOG_TIME_HHHHMMSSMS)
-        unsigned long ms = millis();
-        unsigned long seconds = ms / 1000;
-        unsigned long minutes = seconds / 60;
-        unsigned long hours = minutes / 60;
+        // "%8lu", widened to 10 digits after 27 hours
+        renderDigits(cache.text, cache.text + 10, now, cache.value, ' ', !cache.valid);
+        cache.text[10] = '\0';
+        cache.value = now;
+        cache.start = now < 100000000 ? 2 : now < 1000000000 ? 1 : 0;
+        cache.valid = true;
+        return cache.text + cache.start;
+#else
+#if LOG_TIME == LOG_TIME_SECONDS_MICROS
+        const uint32_t perSecond = 1000000;
+        const int fractionDigits = 6;
+#else
+        const uint32_t perSecond = 1000;
+        const int fractionDigits = 3;
+#endif
+        const int fractionStart = 15 - fractionDigits;
+        uint32_t fraction = now - cache.secondStart;
+        if (cache.valid && now >= cache.secondStart && fraction < perSecond) // Not across a counter wrap
+        {
+            // Same second, only the fraction changes and it is found with a subtraction
+            renderDigits(cache.text + fractionStart, cache.text + 15, fraction, cache.value - cache.secondStart, '0', false);
+            cache.value = now;
+            return cache.text + cache.start;
+        }
+
+        // New second, render everything once
+        uint32_t seconds = now / perSecond;
+        fraction = now % perSecond;
+        cache.secondStart = now - fraction;
+        cache.value = now;
+        cache.valid = true;
+        renderDigits(cache.text + fractionStart, cache.text + 15, fraction, 0, '0', true);
+        cache.text[fractionStart - 1] = LOG_TIME == LOG_TIME_SECONDS_MICROS ? '.' : ':';
+
+#if LOG_TIME == LOG_TIME_SECONDS_MICROS
+        renderDigits(cache.text + 4, cache.text + 8, seconds, 0, ' ', true); // "%4lu.%06lu", seconds wrap with micros() at 4294
+        cache.start = 4;
+#else
+        uint32_t minutes = seconds / 60;
+        uint32_t hours = minutes / 60;
 #if LOG_TIME == LOG_TIME_HHMMSSMS
-        static char timeFormat[13];
-        sprintf(timeFormat, "%02lu:%02lu:%02lu:%03lu", hours % 24, minutes % 60, seconds % 60, ms % 1000);
-#elif LOG_TIME == LOG_TIME_HHHHMMSSMS
-        static char timeFormat[15];
-        sprintf(timeFormat, "%04lu:%02lu:%02lu:%03lu", hours, minutes % 60, seconds % 60, ms % 1000);
-#endif // LOG_TIME == LOG_TIME_HHMMSSMS
+        hours %= 24;
 #else
-        static char timeFormat[1] = {'\0'}; // Default to an empty string as a safeguard.
-#endif // LOG_TIME == LOG_TIME_MICROS
-        return timeFormat;
+        hours %= 10000;
+#endif
+        renderDigits(cache.text + 9, cache.text + 11, seconds % 60, 0, '0', true);
+        cache.text[8] = ':';
+        renderDigits(cache.text + 6, cache.text + 8, minutes % 60, 0, '0', true);
+        cache.text[5] = ':';
+        renderDigits(cache.text + 1, cache.text + 5, hours, 0, '0', true);
+        cache.start = LOG_TIME == LOG_TIME_HHMMSSMS ? 3 : 1; // "%02lu:%02lu:%02lu:%03lu" or "%04lu:..."
+#endif
+        cache.text[15] = '\0';
+        return cache.text + cache.start;
+#endif
     }
 #endif // LOG_TIME != LOG_TIME_DISABLE
 
 #if LOG_FILTER != LOG_FILTER_DISABLE
-    bool logFilter(const char *tag)
+    // The list is hashed at compile time, a log call compares hashes instead of strings
+    constexpr const char *filterList[] = LOG_FILTER_LIST;
+    constexpr size_t filterLength = sizeof(filterList) / sizeof(filterList[0]);
+
+    struct FilterHashes
     {
-        static const char *filterList[] = LOG_FILTER_LIST;
-        static const int length = sizeof(filterList) / sizeof(filterList[0]);
+        uint32_t hash[filterLength];
+    };
 
-        bool inFilter = false;
-        for (int i = 0; i < length; i++)
+    constexpr FilterHashes hashFilterList()
+    {
+        FilterHashes hashes = {};
+        for (size_t i = 0; i < filterLength; i++)
         {
-            if (strcmp(filterList[i], tag) == 0)
-            {
-                inFilter = true;
-                break;
-            }
+            hashes.hash[i] = tagHash(filterList[i]);
         }
-        return LOG_FILTER ? inFilter : !inFilter; // INCLUDE or EXCLUDE
+        return hashes;
     }
-#endif // LOG_LOG_FILTER != LOG_FILTER_DISABLE
 
-    const char *filePathToName(const char *path)
+    constexpr FilterHashes filterHashes = hashFilterList();
+
+    bool logFilter(uint32_t tagHash)
     {
-        size_t i = 0;
-        size_t pos = 0;
-        char *p = (char *)path;
-        while (*p)
+        bool inFilter = false;
+        for (size_t i = 0; i < filterLength; i++)
         {
-            i++;
-            if (*p == '/' || *p == '\\')
+            if (filterHashes.hash[i] == tagHash)
             {
-                pos = i;
-            }
-            if (*p == '.')
-            {
-                *p = '\0';
+                inFilter = true;
                 break;
             }
-            p++;
         }
-        return path + pos;
+        return LOG_FILTER ? inFilter : !inFilter; // INCLUDE or EXCLUDE
     }
+#endif // LOG_LOG_FILTER != LOG_FILTER_DISABLE
+
+#if LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE
+    TagLevel tagLevels[LOG_TAG_LEVEL_SLOTS] = {};
+    uint8_t tagLevelCount = 0;
+    uint8_t defaultLevel = LOG_LEVEL;
+#endif
 
     void assertion(bool condition, const char *file, int line, const char *func, const char *expr, const char *message)
     {
@@ -119,12 +588,14 @@ namespace _logger
             return;
         }
 
-        file = filePathToName(file);
+        logFlush(); // Queued records come before the assertion
+        int nameLength = static_cast<int>(fileNameLength(file));
+        file += fileNameOffset(file);
         char buff[256];
 #if LOG_COLOR == LOG_COLOR_ENABLE
-        snprintf(buff, sizeof(buff), _LOG_COLOR_E "[ASSERT] %s:%d - %s(): (%s) => %s" _LOG_RESET_COLOR, file, line, func, expr, message);
+        snprintf(buff, sizeof(buff), _LOG_COLOR_E "[ASSERT] %.*s:%d - %s(): (%s) => %s" _LOG_RESET_COLOR, nameLength, file, line, func, expr, message);
 #else
-        snprintf(buff, sizeof(buff), "[ASSERT] %s:%d - %s(): (%s) => %s", file, line, func, expr, message);
+        snprintf(buff, sizeof(buff), "[ASSERT] %.*s:%d - %s(): (%s) => %s", nameLength, file, line, func, expr, message);
 #endif
 
         LOG_PRINTLN(buff);
@@ -135,4 +606,176 @@ namespace _logger
             delay(1000);
         };
     }
-} // namespace _logger
\ No newline at end of file
+} // namespace _logger
+
+void logFlush()
+{
+#if LOG_MODE == LOG_MODE_ASYNC
+    while (!_logger::drain())
+    {
+        _logger::wait(); // The background task is draining, drain again after it so nothing queued is left
+    }
+#endif
+#if LOG_DEDUP == LOG_DEDUP_ENABLE
+    {
+        _LOG_LOCK();
+        _logger::writeRepeats();
+    }
+#endif
+#if LOG_SINKS == LOG_SINKS_ENABLE
+    _LOG_LOCK();
+    _logger::sinks().flush();
+#else
+    LOG_OUTPUT.flush();
+#endif
+}
+
+void logReportSuppressed()
+{
+    for (const LogSite *site = logSuppressedSites(); site != nullptr; site = site->next)
+    {
+        char text[64];
+        int len = snprintf(text, sizeof(text), "[LOG] %.*s:%d suppressed %lu" LOG_EOL, static_cast<int>(_logger::fileNameLength(site->file)),
+                           site->file + _logger::fileNameOffset(site->file), site->line, (unsigned long)site->suppressed);
+        _LOG_WRITE(0, text, len < (int)sizeof(text) ? len : sizeof(text) - 1);
+    }
+}
+
+const LogSite *logSuppressedSites()
+{
+    _LOG_LOCK();
+    return _logger::suppressedSites;
+}
+
+uint32_t logKvDropped()
+{
+    return _logger::kvDropped;
+}
+
+#if LOG_SINKS == LOG_SINKS_ENABLE
+bool logAddSink(LogSink &sink)
+{
+    _LOG_LOCK();
+    return _logger::sinks().add(sink);
+}
+
+void logRemoveSink(LogSink &sink)
+{
+    _LOG_LOCK();
+    _logger::sinks().remove(sink);
+}
+
+LogSink &logOutputSink()
+{
+    return _logger::outputSink;
+}
+#endif
+
+#if LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE
+// Levels are meant to be changed from one task, a log call racing a change sees the old or new level
+void logSetLevel(uint8_t level)
+{
+    _logger::defaultLevel = level;
+}
+
+bool logSetLevel(const char *tag, uint8_t level)
+{
+    const uint32_t hash = _logger::tagHash(tag);
+    const uint32_t mask = LOG_TAG_LEVEL_SLOTS - 1;
+    for (uint32_t i = hash & mask, probes = 0; probes < LOG_TAG_LEVEL_SLOTS; i = (i + 1) & mask, probes++)
+    {
+        _logger::TagLevel &slot = _logger::tagLevels[i];
+        if (slot.hash == hash)
+        {
+            slot.level = level;
+            return true;
+        }
+        if (slot.hash == 0)
+        {
+            slot.level = level;
+            slot.hash = hash;
+            _logger::tagLevelCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t logGetLevel(const char *tag)
+{
+    return _logger::tagLevel(_logger::tagHash(tag));
+}
+
+void logClearLevels()
+{
+    _logger::tagLevelCount = 0;
+    for (_logger::TagLevel &slot : _logger::tagLevels)
+    {
+        slot.hash = 0;
+    }
+}
+#endif
+
+#if LOG_STATS == LOG_STATS_ENABLE
+LogStats logStats()
+{
+    _LOG_LOCK();
+    return _logger::stats;
+}
+
+void logResetStats()
+{
+    _LOG_LOCK();
+    _logger::stats.reset();
+}
+
+void logReportStats()
+{
+    static const char *const levelNames[] = {"PRINT", "ERROR", "WARN", "INFO", "DEBUG", "VERB"};
+    const LogStats stats = logStats(); // Taken first so the report does not count itself
+    char text[112];
+    int len = snprintf(text, sizeof(text), "[LOG] records %lu bytes %lu largest %lu long %lu cut %lu format %lu us output %lu us" LOG_EOL,
+                       (unsigned long)stats.totalRecords(), (unsigned long)stats.totalBytes(), (unsigned long)stats.largestRecord,
+                       (unsigned long)stats.longRecords, (unsigned long)stats.cutRecords, (unsigned long)stats.formatMicros,
+                       (unsigned long)stats.outputMicros);
+    _LOG_OUTPUT_WRITE(0, text, len < (int)sizeof(text) ? len : sizeof(text) - 1);
+
+    for (size_t level = 0; level < 6; level++)
+    {
+        if (stats.records[level] > 0)
+        {
+            len = snprintf(text, sizeof(text), "[LOG] %s records %lu bytes %lu" LOG_EOL, levelNames[level],
+                           (unsigned long)stats.records[level], (unsigned long)stats.bytes[level]);
+            _LOG_OUTPUT_WRITE(0, text, len < (int)sizeof(text) ? len : sizeof(text) - 1);
+        }
+    }
+
+    for (const LogTagStats &tag : stats.tags)
+    {
+        if (tag.hash != 0)
+        {
+            len = snprintf(text, sizeof(text), "[LOG] tag %.24s records %lu bytes %lu" LOG_EOL, tag.tag,
+                           (unsigned long)tag.records, (unsigned long)tag.bytes);
+            _LOG_OUTPUT_WRITE(0, text, len < (int)sizeof(text) ? len : sizeof(text) - 1);
+        }
+    }
+    if (stats.untrackedTags > 0)
+    {
+        len = snprintf(text, sizeof(text), "[LOG] other tags records %lu" LOG_EOL, (unsigned long)stats.untrackedTags);
+        _LOG_OUTPUT_WRITE(0, text, len < (int)sizeof(text) ? len : sizeof(text) - 1);
+    }
+}
+#endif
+
+#if LOG_MODE == LOG_MODE_ASYNC
+LogRingStats logAsyncStats()
+{
+    return _logger::ring.stats();
+}
+
+void logAsyncResetStats()
+{
+    _logger::ring.resetStats();
+    _logger::reportedLost = 0;
+}
+#endif
\ No newline at end of file
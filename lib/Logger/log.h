@@ -20,6 +20,8 @@ LOG_TIME
    LOG_TIME_MILLIS
    LOG_TIME_HHMMSSMS
    LOG_TIME_HHHHMMSSMS
+   LOG_TIME_SECONDS_MICROS
+   LOG_TIME_CYCLES
 
 LOG_FILENAME
    LOG_FILENAME_DISABLE
@@ -34,31 +36,107 @@ LOG_FILTER
    LOG_FILTER_EXCLUDE
    LOG_FILTER_INCLUDE
 
+LOG_TAG_LEVEL
+   LOG_TAG_LEVEL_DISABLE
+   LOG_TAG_LEVEL_ENABLE
+
 LOG_PRINT_TYPE
    LOG_PRINT_TYPE_PRINTF
    LOG_PRINT_TYPE_CUSTOM_FORMAT
    LOG_PRINT_TYPE_STD_FORMAT
    LOG_PRINT_TYPE_FMT_FORMAT
+   LOG_PRINT_TYPE_BINARY
+
+LOG_SINKS
+   LOG_SINKS_DISABLE
+   LOG_SINKS_ENABLE
+
+LOG_DEDUP
+   LOG_DEDUP_DISABLE
+   LOG_DEDUP_ENABLE
+
+LOG_STATS
+   LOG_STATS_DISABLE
+   LOG_STATS_ENABLE
+
+LOG_KV_FORMAT
+   LOG_KV_FORMAT_JSON
+   LOG_KV_FORMAT_CBOR
+
+LOG_MODE
+   LOG_MODE_SYNC
+   LOG_MODE_ASYNC
+
+LOG_ASYNC_OVERFLOW
+   LOG_ASYNC_OVERFLOW_DROP
+   LOG_ASYNC_OVERFLOW_BLOCK
+   LOG_ASYNC_OVERFLOW_OVERWRITE
 */
 
+// Each setting can also be set with a build flag, e.g. -D LOG_TIME=LOG_TIME_MICROS
+
+#ifndef LOG_LEVEL
 #define LOG_LEVEL LOG_LEVEL_VERBOSE
+#endif
 
+#ifndef LOG_LEVEL_TEXT_FORMAT
 #define LOG_LEVEL_TEXT_FORMAT LOG_LEVEL_TEXT_FORMAT_SHORT
+#endif
 
+#ifndef LOG_TIME
 #define LOG_TIME LOG_TIME_DISABLE
+#endif
 
+#ifndef LOG_FILENAME
 #define LOG_FILENAME LOG_FILENAME_ENABLE
+#endif
 
+#ifndef LOG_COLOR
 #define LOG_COLOR LOG_COLOR_ENABLE
+#endif
 
+#ifndef LOG_FILTER
 #define LOG_FILTER LOG_FILTER_DISABLE
+#endif
 
+#ifndef LOG_FILTER_LIST
 #define LOG_FILTER_LIST {""}
+#endif
+
+#ifndef LOG_TAG_LEVEL
+#define LOG_TAG_LEVEL LOG_TAG_LEVEL_DISABLE
+#endif
 
+#ifndef LOG_STATIC_BUFFER_SIZE
 #define LOG_STATIC_BUFFER_SIZE 128
+#endif
 
+#ifndef LOG_PRINT_TYPE
 #define LOG_PRINT_TYPE LOG_PRINT_TYPE_FMT_FORMAT
+#endif
 
+#ifndef LOG_OUTPUT
 #define LOG_OUTPUT Serial
+#endif
+
+#ifndef LOG_SINKS
+#define LOG_SINKS LOG_SINKS_DISABLE
+#endif
+
+#ifndef LOG_DEDUP
+#define LOG_DEDUP LOG_DEDUP_DISABLE
+#endif
+
+#ifndef LOG_STATS
+#define LOG_STATS LOG_STATS_DISABLE
+#endif
+
+#ifndef LOG_KV_FORMAT
+#define LOG_KV_FORMAT LOG_KV_FORMAT_JSON
+#endif
+
+#ifndef LOG_MODE
+#define LOG_MODE LOG_MODE_SYNC
+#endif
 
 #include <logger.h>
\ No newline at end of file
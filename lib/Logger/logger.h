@@ -27,6 +27,8 @@
 #define LOG_TIME_MILLIS 2
 #define LOG_TIME_HHMMSSMS 3
 #define LOG_TIME_HHHHMMSSMS 4
+#define LOG_TIME_SECONDS_MICROS 5 // Seconds with a microsecond fraction
+#define LOG_TIME_CYCLES 6         // CPU cycle counter on ESP32, micros() on other boards
 
 #define LOG_COLOR_DISABLE 0
 #define LOG_COLOR_ENABLE 1
@@ -39,10 +41,33 @@
 #define LOG_FILTER_EXCLUDE 0
 #define LOG_FILTER_INCLUDE 1
 
+#define LOG_TAG_LEVEL_DISABLE 0
+#define LOG_TAG_LEVEL_ENABLE 1 // Levels can be changed at runtime, globally and per tag with logSetLevel()
+
 #define LOG_PRINT_TYPE_PRINTF 0
 #define LOG_PRINT_TYPE_CUSTOM_FORMAT 1
 #define LOG_PRINT_TYPE_STD_FORMAT 2
 #define LOG_PRINT_TYPE_FMT_FORMAT 3
+#define LOG_PRINT_TYPE_BINARY 4 // Compact records decoded on the host by tools/logdecode
+
+#define LOG_SINKS_DISABLE 0 // Records go to LOG_OUTPUT
+#define LOG_SINKS_ENABLE 1  // Records go to every registered sink with a level that lets them through
+
+#define LOG_DEDUP_DISABLE 0
+#define LOG_DEDUP_ENABLE 1 // An identical record right after another is counted, then "last message repeated N times"
+
+#define LOG_STATS_DISABLE 0
+#define LOG_STATS_ENABLE 1 // Count records, bytes and time spent logging, read with logStats()
+
+#define LOG_KV_FORMAT_JSON 0 // LOG_KV writes one JSON object per line
+#define LOG_KV_FORMAT_CBOR 1 // LOG_KV writes one CBOR map per record
+
+#define LOG_MODE_SYNC 0  // Print each record before the LOG call returns
+#define LOG_MODE_ASYNC 1 // Queue each record in a lock-free ring, written to LOG_OUTPUT in the background
+
+#define LOG_ASYNC_OVERFLOW_DROP 0      // Discard the new record
+#define LOG_ASYNC_OVERFLOW_BLOCK 1     // Wait until the record fits
+#define LOG_ASYNC_OVERFLOW_OVERWRITE 2 // Discard the oldest records
 
 /**--------------------------------------------------------------------------------------
  * Logger Default Settings
@@ -76,34 +101,138 @@
 #define LOG_FILTER_LIST {""}
 #endif
 
+#ifndef LOG_TAG_LEVEL
+#define LOG_TAG_LEVEL LOG_TAG_LEVEL_DISABLE
+#endif
+
+#ifndef LOG_TAG_LEVEL_SLOTS
+#define LOG_TAG_LEVEL_SLOTS 16 // Most tags with their own level, a power of two
+#endif
+
 #ifndef LOG_STATIC_BUFFER_SIZE
-#define LOG_STATIC_BUFFER_SIZE 64
+#define LOG_STATIC_BUFFER_SIZE 64 // Bytes formatted before a record is written out, the longest async, sink or dedup record
 #endif
 
 #ifndef LOG_PRINT_TYPE
 #define LOG_PRINT_TYPE LOG_PRINT_TYPE_PRINTF
 #endif
 
+#ifndef LOG_BINARY_RECORD_SIZE
+#define LOG_BINARY_RECORD_SIZE 128 // Largest binary record, arguments past it are sent as missing
+#endif
+
 #ifndef LOG_OUTPUT
 #define LOG_OUTPUT Serial
 #endif
 
+#ifndef LOG_SINKS
+#define LOG_SINKS LOG_SINKS_DISABLE
+#endif
+
+#ifndef LOG_SINKS_MAX
+#define LOG_SINKS_MAX 4 // Most sinks registered at once, LOG_OUTPUT included
+#endif
+
+#ifndef LOG_DEDUP
+#define LOG_DEDUP LOG_DEDUP_DISABLE
+#endif
+
+#ifndef LOG_RATE_LIMIT_SLOTS
+#define LOG_RATE_LIMIT_SLOTS 8 // Most tags with a LOG_RATE_LIMITED bucket, a power of two
+#endif
+
+#ifndef LOG_STATS
+#define LOG_STATS LOG_STATS_DISABLE
+#endif
+
+#ifndef LOG_STATS_TAG_SLOTS
+#define LOG_STATS_TAG_SLOTS 8 // Most tags counted on their own, a power of two
+#endif
+
+#ifndef LOG_KV_FORMAT
+#define LOG_KV_FORMAT LOG_KV_FORMAT_JSON
+#endif
+
 #ifndef LOG_EOL
 #define LOG_EOL "\r\n"
 #endif
 
+#ifndef LOG_MODE
+#define LOG_MODE LOG_MODE_SYNC
+#endif
+
+#ifndef LOG_ASYNC_BUFFER_SIZE
+#define LOG_ASYNC_BUFFER_SIZE 4096 // Ring size in bytes, a power of two
+#endif
+
+#ifndef LOG_ASYNC_OVERFLOW
+#define LOG_ASYNC_OVERFLOW LOG_ASYNC_OVERFLOW_DROP
+#endif
+
+#ifndef LOG_ASYNC_BATCH_SIZE
+#define LOG_ASYNC_BATCH_SIZE 256 // Bytes handed to LOG_OUTPUT per write
+#endif
+
+#ifndef LOG_ASYNC_FLUSH_MS
+#define LOG_ASYNC_FLUSH_MS 10 // Longest a record waits in the ring while it is less than half full
+#endif
+
+#ifndef LOG_ASYNC_TASK_STACK
+#define LOG_ASYNC_TASK_STACK 3072
+#endif
+
+#ifndef LOG_ASYNC_TASK_PRIORITY
+#define LOG_ASYNC_TASK_PRIORITY 1
+#endif
+
+#ifndef LOG_ASYNC_TASK_CORE
+#define LOG_ASYNC_TASK_CORE tskNO_AFFINITY
+#endif
+
 /**--------------------------------------------------------------------------------------
  * Logger Settings Check
  *-------------------------------------------------------------------------------------*/
 
 static_assert(LOG_LEVEL >= LOG_LEVEL_DISABLE && LOG_LEVEL <= LOG_LEVEL_VERBOSE, "LOG_LEVEL must be between LOG_LEVEL_DISABLE and LOG_LEVEL_VERBOSE");
 static_assert(LOG_LEVEL_TEXT_FORMAT >= LOG_LEVEL_TEXT_FORMAT_LETTER && LOG_LEVEL_TEXT_FORMAT <= LOG_LEVEL_TEXT_FORMAT_FULL, "LOG_LEVEL_TEXT_FORMAT must be either LOG_LEVEL_TEXT_FORMAT_LETTER, LOG_LEVEL_TEXT_FORMAT_SHORT or LOG_LEVEL_TEXT_FORMAT_LONG");
-static_assert(LOG_TIME >= LOG_TIME_DISABLE && LOG_TIME <= LOG_TIME_HHHHMMSSMS, "LOG_TIME must be between LOG_TIME_DISABLE and LOG_TIME_HHHHMMSSMS");
+static_assert(LOG_TIME >= LOG_TIME_DISABLE && LOG_TIME <= LOG_TIME_CYCLES, "LOG_TIME must be between LOG_TIME_DISABLE and LOG_TIME_CYCLES");
 static_assert(LOG_FILTER >= LOG_FILTER_DISABLE && LOG_FILTER <= LOG_FILTER_INCLUDE, "LOG_FILTER must be between LOG_FILTER_DISABLE and LOG_FILTER_INCLUDE");
-static_assert(LOG_PRINT_TYPE >= LOG_PRINT_TYPE_PRINTF || LOG_PRINT_TYPE <= LOG_PRINT_TYPE_FMT_FORMAT, "LOG_PRINT_TYPE must be either LOG_PRINT_TYPE_PRINTF, LOG_PRINT_TYPE_CUSTOM_FORMAT, LOG_PRINT_TYPE_STD_FORMAT or LOG_PRINT_TYPE_FMT_FORMAT");
+static_assert(LOG_PRINT_TYPE >= LOG_PRINT_TYPE_PRINTF && LOG_PRINT_TYPE <= LOG_PRINT_TYPE_BINARY, "LOG_PRINT_TYPE must be either LOG_PRINT_TYPE_PRINTF, LOG_PRINT_TYPE_CUSTOM_FORMAT, LOG_PRINT_TYPE_STD_FORMAT, LOG_PRINT_TYPE_FMT_FORMAT or LOG_PRINT_TYPE_BINARY");
 static_assert(LOG_FILENAME == LOG_FILENAME_DISABLE || LOG_FILENAME == LOG_FILENAME_ENABLE, "LOG_FILENAME must be either LOG_FILENAME_DISABLE or LOG_FILENAME_ENABLE");
 static_assert(LOG_COLOR == LOG_COLOR_DISABLE || LOG_COLOR == LOG_COLOR_ENABLE, "LOG_COLOR must be either LOG_COLOR_DISABLE or LOG_COLOR_ENABLE");
-static_assert(LOG_STATIC_BUFFER_SIZE > 0, "LOG_STATIC_BUFFER_SIZE must be greater than 0");
+static_assert(LOG_TAG_LEVEL == LOG_TAG_LEVEL_DISABLE || LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE, "LOG_TAG_LEVEL must be either LOG_TAG_LEVEL_DISABLE or LOG_TAG_LEVEL_ENABLE");
+static_assert(LOG_TAG_LEVEL_SLOTS >= 2 && LOG_TAG_LEVEL_SLOTS <= 256 && (LOG_TAG_LEVEL_SLOTS & (LOG_TAG_LEVEL_SLOTS - 1)) == 0, "LOG_TAG_LEVEL_SLOTS must be a power of two between 2 and 256");
+static_assert(LOG_STATIC_BUFFER_SIZE >= 16, "LOG_STATIC_BUFFER_SIZE must be at least 16");
+static_assert(LOG_BINARY_RECORD_SIZE >= 32 && LOG_BINARY_RECORD_SIZE <= 257, "LOG_BINARY_RECORD_SIZE must be between 32 and 257");
+static_assert(LOG_SINKS == LOG_SINKS_DISABLE || LOG_SINKS == LOG_SINKS_ENABLE, "LOG_SINKS must be either LOG_SINKS_DISABLE or LOG_SINKS_ENABLE");
+static_assert(LOG_SINKS_MAX > 0, "LOG_SINKS_MAX must be greater than 0");
+static_assert(LOG_DEDUP == LOG_DEDUP_DISABLE || LOG_DEDUP == LOG_DEDUP_ENABLE, "LOG_DEDUP must be either LOG_DEDUP_DISABLE or LOG_DEDUP_ENABLE");
+static_assert(LOG_RATE_LIMIT_SLOTS >= 2 && (LOG_RATE_LIMIT_SLOTS & (LOG_RATE_LIMIT_SLOTS - 1)) == 0, "LOG_RATE_LIMIT_SLOTS must be a power of two of at least 2");
+static_assert(LOG_STATS == LOG_STATS_DISABLE || LOG_STATS == LOG_STATS_ENABLE, "LOG_STATS must be either LOG_STATS_DISABLE or LOG_STATS_ENABLE");
+static_assert(LOG_STATS_TAG_SLOTS >= 2 && (LOG_STATS_TAG_SLOTS & (LOG_STATS_TAG_SLOTS - 1)) == 0, "LOG_STATS_TAG_SLOTS must be a power of two of at least 2");
+static_assert(LOG_KV_FORMAT == LOG_KV_FORMAT_JSON || LOG_KV_FORMAT == LOG_KV_FORMAT_CBOR, "LOG_KV_FORMAT must be either LOG_KV_FORMAT_JSON or LOG_KV_FORMAT_CBOR");
+static_assert(LOG_MODE == LOG_MODE_SYNC || LOG_MODE == LOG_MODE_ASYNC, "LOG_MODE must be either LOG_MODE_SYNC or LOG_MODE_ASYNC");
+static_assert(LOG_ASYNC_OVERFLOW >= LOG_ASYNC_OVERFLOW_DROP && LOG_ASYNC_OVERFLOW <= LOG_ASYNC_OVERFLOW_OVERWRITE, "LOG_ASYNC_OVERFLOW must be LOG_ASYNC_OVERFLOW_DROP, LOG_ASYNC_OVERFLOW_BLOCK or LOG_ASYNC_OVERFLOW_OVERWRITE");
+static_assert(LOG_ASYNC_BUFFER_SIZE >= 64 && (LOG_ASYNC_BUFFER_SIZE & (LOG_ASYNC_BUFFER_SIZE - 1)) == 0, "LOG_ASYNC_BUFFER_SIZE must be a power of two of at least 64");
+static_assert(LOG_ASYNC_BATCH_SIZE > 0, "LOG_ASYNC_BATCH_SIZE must be greater than 0");
+
+#if LOG_MODE == LOG_MODE_ASYNC && defined(__AVR__)
+#error "LOG_MODE_ASYNC needs <atomic>, which AVR does not provide"
+#endif
+
+#if LOG_MODE == LOG_MODE_ASYNC
+#include "LogRing.h"
+#endif
+
+#if LOG_SINKS == LOG_SINKS_ENABLE
+#include "LogSink.h"
+#endif
+
+#if LOG_STATS == LOG_STATS_ENABLE
+#include "LogStats.h"
+#endif
+
+#include "LogLimit.h"
 
 /**--------------------------------------------------------------------------------------
  * Logger Private Functions
@@ -112,26 +241,278 @@ static_assert(LOG_STATIC_BUFFER_SIZE > 0, "LOG_STATIC_BUFFER_SIZE must be greate
 namespace _logger
 {
 #if LOG_LEVEL > LOG_LEVEL_DISABLE && LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
-    void vprintf(const char *format, va_list arg);
-    void printf(const char *format, ...);
+    void vprintf(uint8_t level, const char *format, va_list arg);
+    void printf(uint8_t level, const char *format, ...);
+#if defined(__AVR__)
+    void vprintf(uint8_t level, const __FlashStringHelper *format, va_list arg);
+    void printf(uint8_t level, const __FlashStringHelper *format, ...);
+#endif
 #endif
 
 #if LOG_TIME != LOG_TIME_DISABLE
     const char *formatTime();
 #endif
 
+    // FNV-1a of a tag. The compiler folds it for literal and constexpr tags, 0 is kept for empty slots.
+    constexpr uint32_t tagHash(const char *tag)
+    {
+        uint32_t hash = 2166136261u;
+        while (*tag)
+        {
+            hash = (hash ^ static_cast<uint8_t>(*tag++)) * 16777619u;
+        }
+        return hash != 0 ? hash : 1;
+    }
+
 #if LOG_FILTER != LOG_FILTER_DISABLE
-    bool logFilter(const char *tag);
+    bool logFilter(uint32_t tagHash);
+#endif
+
+#if LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE
+    struct TagLevel
+    {
+        uint32_t hash;
+        uint8_t level;
+    };
+
+    extern TagLevel tagLevels[LOG_TAG_LEVEL_SLOTS]; // Open addressing, indexed by the low bits of the hash
+    extern uint8_t tagLevelCount;
+    extern uint8_t defaultLevel;
+
+    inline uint8_t tagLevel(uint32_t hash)
+    {
+        const uint32_t mask = LOG_TAG_LEVEL_SLOTS - 1;
+        for (uint32_t i = hash & mask, probes = 0; probes < LOG_TAG_LEVEL_SLOTS; i = (i + 1) & mask, probes++)
+        {
+            if (tagLevels[i].hash == hash)
+            {
+                return tagLevels[i].level;
+            }
+            if (tagLevels[i].hash == 0)
+            {
+                break;
+            }
+        }
+        return defaultLevel;
+    }
+
+    inline bool levelEnabled(uint8_t level) { return level <= defaultLevel; }
+
+    // Without per tag levels this is the same single load and compare as an untagged log, the tag
+    // is only hashed once a per tag level is set
+    inline bool tagLevelEnabled(const char *tag, uint8_t level)
+    {
+        return level <= (tagLevelCount == 0 ? defaultLevel : tagLevel(tagHash(tag)));
+    }
+#endif
+
+#if LOG_MODE == LOG_MODE_ASYNC
+    void write(uint8_t level, const char *data, size_t size);
+#endif
+
+#if LOG_SINKS == LOG_SINKS_ENABLE || LOG_DEDUP == LOG_DEDUP_ENABLE
+    void output(uint8_t level, const char *data, size_t size);
 #endif
 
-    const char *filePathToName(const char *path);
+#if LOG_STATS == LOG_STATS_ENABLE
+    // Times one log call, records it writes are counted against its tag. An argument that logs
+    // opens a nested scope whose time is left out of the outer one.
+    class StatsScope
+    {
+    public:
+        uint32_t start;
+        uint32_t counted; // Micros already counted, in the output write or in nested log calls
+        uint32_t partial; // Bytes of the record written so far in parts
+        uint32_t tagHash; // 0 without a tag
+        const char *tag;
+        StatsScope *previous;
+
+        StatsScope(uint32_t tagHash, const char *tag);
+        ~StatsScope();
+    };
+
+    // Times the write and counts the bytes, the record is counted with its last part
+    void statsWrite(uint8_t level, const char *data, size_t size, bool recordEnd);
+#endif
+
+    // Collects one record for every print type except binary in a fixed buffer. When the buffer fills,
+    // the part so far is written out and the buffer reused, so a long line takes no heap and no more
+    // stack. Records that have to stay whole, for the async ring, the sinks or dedup, are cut at the
+    // buffer size instead.
+    class RecordWriter
+    {
+    public:
+        typedef char value_type; // For std::back_inserter
+
+        char data[LOG_STATIC_BUFFER_SIZE];
+        size_t size;
+        uint8_t level;
+        bool cut;
+
+        explicit RecordWriter(uint8_t level) : size(0), level(level), cut(false) {}
+
+        void push_back(char c)
+        {
+            if (size == sizeof(data))
+            {
+                overflow();
+                if (cut)
+                {
+                    return;
+                }
+            }
+            data[size++] = c;
+        }
+
+        void write(const char *text, size_t length)
+        {
+            while (length > 0)
+            {
+                if (size == sizeof(data))
+                {
+                    overflow();
+                    if (cut)
+                    {
+                        return;
+                    }
+                }
+                size_t room = sizeof(data) - size;
+                size_t n = length < room ? length : room;
+                memcpy(data + size, text, n);
+                size += n;
+                text += n;
+                length -= n;
+            }
+        }
+
+        void overflow();    // Writes out the full buffer or cuts the record
+        void finish();      // Writes out the rest of the record
+        void finishWhole(); // Like finish(), but drops and counts a cut record, for LOG_KV
+    };
+
+    template <size_t N>
+    struct Constant
+    {
+        static constexpr size_t value = N; // Forces compile time evaluation, also without <type_traits>
+    };
+
+    // Start of the file name in a path
+    constexpr size_t fileNameOffset(const char *path)
+    {
+        size_t offset = 0;
+        for (size_t i = 0; path[i] != '\0'; i++)
+        {
+            if (path[i] == '/' || path[i] == '\\')
+            {
+                offset = i + 1;
+            }
+        }
+        return offset;
+    }
+
+    // Length of the file name in a path without its extension
+    constexpr size_t fileNameLength(const char *path)
+    {
+        const char *name = path + fileNameOffset(path);
+        size_t length = 0;
+        while (name[length] != '\0' && name[length] != '.')
+        {
+            length++;
+        }
+        return length;
+    }
+
     void assertion(bool flag, const char *file, int line, const char *func, const char *expr, const char *message = "");
 }
 
+/**--------------------------------------------------------------------------------------
+ * Logger Public Functions
+ *-------------------------------------------------------------------------------------*/
+
+// Writes out every queued record and flushes LOG_OUTPUT. In LOG_MODE_ASYNC this is also how boards
+// without a background task (anything but ESP32 and the host build) drain the ring, call it from loop().
+void logFlush();
+
+#if LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE
+// Level for untagged logs and tags without their own, starts at LOG_LEVEL. LOG_LEVEL still removes
+// anything above it at compile time, so build with the most verbose level you may want in the field.
+void logSetLevel(uint8_t level);
+
+// Level for one tag, false when all LOG_TAG_LEVEL_SLOTS are taken
+bool logSetLevel(const char *tag, uint8_t level);
+uint8_t logGetLevel(const char *tag);
+
+// Drops every per tag level
+void logClearLevels();
+#endif
+
+#if LOG_SINKS == LOG_SINKS_ENABLE
+// Registers a sink by reference, it must outlive its registration. False when LOG_SINKS_MAX sinks
+// are registered. Safe from any task on ESP32 and the host, a removed sink is not written to once
+// logRemoveSink() returns.
+bool logAddSink(LogSink &sink);
+void logRemoveSink(LogSink &sink);
+
+// The sink for LOG_OUTPUT, registered from the start. Set its level or remove it like any other.
+LogSink &logOutputSink();
+#endif
+
+// Logs one line per LOG_EVERY_N, LOG_EVERY_MS, LOG_ONCE or LOG_RATE_LIMITED call site that skipped
+// records, with how many it skipped
+void logReportSuppressed();
+
+// First call site that skipped records, follow next for the others
+const LogSite *logSuppressedSites();
+
+// LOG_KV records dropped for being longer than LOG_STATIC_BUFFER_SIZE. Only async mode, sinks and
+// LOG_DEDUP drop them, they need whole records and a cut one is not valid JSON or CBOR.
+uint32_t logKvDropped();
+
+#if LOG_STATS == LOG_STATS_ENABLE
+// Counters since boot or the last logResetStats(). Time is in micros(), compare formatMicros with
+// outputMicros to see whether formatting or the output is the cost.
+LogStats logStats();
+void logResetStats();
+
+// Logs the counters, a line for the totals, one per level and one per tag
+void logReportStats();
+#endif
+
+#if LOG_MODE == LOG_MODE_ASYNC
+LogRingStats logAsyncStats();
+void logAsyncResetStats();
+#endif
+
 /**--------------------------------------------------------------------------------------
  * Logger Private Macros
  *-------------------------------------------------------------------------------------*/
 
+// Output
+
+#if LOG_MODE == LOG_MODE_ASYNC
+#define _LOG_OUTPUT_WRITE(level, data, size) _logger::write(level, data, size)
+#elif LOG_SINKS == LOG_SINKS_ENABLE || LOG_DEDUP == LOG_DEDUP_ENABLE
+#define _LOG_OUTPUT_WRITE(level, data, size) _logger::output(level, data, size)
+#else
+#define _LOG_OUTPUT_WRITE(level, data, size) ((void)(level), LOG_OUTPUT.write(reinterpret_cast<const uint8_t *>(data), size))
+#endif
+
+// _LOG_WRITE_PART writes a part of a record longer than LOG_STATIC_BUFFER_SIZE, its last part goes
+// through _LOG_WRITE. Async, sinks and dedup take whole records, there long records are cut.
+#if LOG_MODE == LOG_MODE_ASYNC || LOG_SINKS == LOG_SINKS_ENABLE || LOG_DEDUP == LOG_DEDUP_ENABLE
+#define _LOG_WHOLE_RECORDS 1
+#else
+#define _LOG_WHOLE_RECORDS 0
+#endif
+
+#if LOG_STATS == LOG_STATS_ENABLE
+#define _LOG_WRITE(level, data, size) _logger::statsWrite(level, data, size, true)
+#define _LOG_WRITE_PART(level, data, size) _logger::statsWrite(level, data, size, false)
+#else
+#define _LOG_WRITE(level, data, size) _LOG_OUTPUT_WRITE(level, data, size)
+#define _LOG_WRITE_PART(level, data, size) _LOG_OUTPUT_WRITE(level, data, size)
+#endif
+
 // Colors
 
 #if LOG_COLOR == LOG_COLOR_ENABLE
@@ -165,8 +546,8 @@ namespace _logger
 // Filter
 
 #if LOG_FILTER != LOG_FILTER_DISABLE
-#define _IF_LOG_FILTER_BEGIN(tag) \
-    if (_logger::logFilter(tag))  \
+#define _IF_LOG_FILTER_BEGIN(tag)                    \
+    if (_logger::logFilter(_logger::tagHash(tag))) \
     {
 #define _IF_LOG_FILTER_END }
 #else
@@ -174,6 +555,18 @@ namespace _logger
 #define _IF_LOG_FILTER_END
 #endif // LOG_LOG_FILTER != LOG_FILTER_DISABLE
 
+// Runtime level, checked before any argument is evaluated. The empty if keeps a following else attached.
+
+#if LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE
+#define _IF_LOG_LEVEL(level) \
+    if (!_logger::levelEnabled(level)) {} else
+#define _IF_LOG_TAG_LEVEL(tag, level) \
+    if (!_logger::tagLevelEnabled(tag, level)) {} else
+#else
+#define _IF_LOG_LEVEL(level)
+#define _IF_LOG_TAG_LEVEL(tag, level)
+#endif // LOG_TAG_LEVEL == LOG_TAG_LEVEL_ENABLE
+
 // Log level text
 
 #if LOG_LEVEL_TEXT_FORMAT == LOG_LEVEL_TEXT_FORMAT_LETTER
@@ -196,29 +589,70 @@ namespace _logger
 #define _LOG_LEVEL_ERROR_TEXT "[ERROR]"
 #endif // LOG_LEVEL_TEXT_FORMAT == LOG_LEVEL_TEXT_FORMAT_LETTER
 
+// Flash format strings
+
+#if defined(__AVR__) && (LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF || LOG_PRINT_TYPE == LOG_PRINT_TYPE_CUSTOM_FORMAT)
+#define _LOG_FLASH(format) F(format) // Keep the whole format string, level text included, out of SRAM
+#elif defined(__AVR__) && LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
+#define _LOG_FLASH(format) PSTR(format) // Only the address is sent, the decoder reads the string from the ELF
+#else
+#define _LOG_FLASH(format) format
+#endif
+
 // Preamble format
 
-#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_STD_FORMAT || LOG_PRINT_TYPE == LOG_PRINT_TYPE_FMT_FORMAT || LOG_PRINT_TYPE == LOG_PRINT_TYPE_CUSTOM_FORMAT
-#define __LOG_TAG_FORMAT(loglevel, color, tag, format) color loglevel "[{}] " format _LOG_RESET_COLOR LOG_EOL, tag
-#define __LOG_TAG_TIME_FORMAT(loglevel, color, tag, format) color "[{}]" loglevel "[{}] " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime(), tag
-#define __LOG_TAG_FILE_FORMAT(loglevel, color, tag, format) color loglevel "[{}][{}:{}] " format _LOG_RESET_COLOR LOG_EOL, tag, _logger::filePathToName(__FILE__), __LINE__
-#define __LOG_TAG_TIME_FILE_FORMAT(loglevel, color, tag, format) color "[{}]" loglevel "[{}][{}:{}] " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime(), tag, _logger::filePathToName(__FILE__), __LINE__
+// File name and line, both resolved at compile time. The line is folded into the format string and the
+// file name is a view into the __FILE__ literal, so nothing is scanned or written at runtime.
 
-#define __LOG_FORMAT(loglevel, color, format) color loglevel " " format _LOG_RESET_COLOR LOG_EOL
-#define __LOG_TIME_FORMAT(loglevel, color, format) color "[{}]" loglevel " " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime()
-#define __LOG_FILE_FORMAT(loglevel, color, format) color loglevel "[{}:{}] " format _LOG_RESET_COLOR LOG_EOL, _logger::filePathToName(__FILE__), __LINE__
-#define __LOG_TIME_FILE_FORMAT(loglevel, color, format) color "[{}]" loglevel "[{}:{}] " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime(), _logger::filePathToName(__FILE__), __LINE__
+#define _LOG_STRINGIFY(x) #x
+#define _LOG_LINE_STRING(line) _LOG_STRINGIFY(line)
+#define _LOG_FILE_NAME_OFFSET _logger::Constant<_logger::fileNameOffset(__FILE__)>::value
+#define _LOG_FILE_NAME_LENGTH _logger::Constant<_logger::fileNameLength(__FILE__)>::value
+
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_CUSTOM_FORMAT
+#define _LOG_FILE_NAME afmt::string_view(__FILE__ + _LOG_FILE_NAME_OFFSET, _LOG_FILE_NAME_LENGTH)
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_STD_FORMAT
+#define _LOG_FILE_NAME std::string_view(__FILE__ + _LOG_FILE_NAME_OFFSET, _LOG_FILE_NAME_LENGTH)
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_FMT_FORMAT
+#define _LOG_FILE_NAME fmt::string_view(__FILE__ + _LOG_FILE_NAME_OFFSET, _LOG_FILE_NAME_LENGTH)
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
+#define _LOG_FILE_NAME logbin::FileRef{_LOG_FLASH(__FILE__)} // Sent by address, the decoder strips the path
 #else
-#define __LOG_TAG_FORMAT(loglevel, color, tag, format) color loglevel "[%s] " format _LOG_RESET_COLOR LOG_EOL, tag
-#define __LOG_TAG_TIME_FORMAT(loglevel, color, tag, format) color "[%s]" loglevel "[%s] " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime(), tag
-#define __LOG_TAG_FILE_FORMAT(loglevel, color, tag, format) color loglevel "[%s][%s:%d] " format _LOG_RESET_COLOR LOG_EOL, tag, _logger::filePathToName(__FILE__), __LINE__
-#define __LOG_TAG_TIME_FILE_FORMAT(loglevel, color, tag, format) color "[%s]" loglevel "[%s][%s:%d] " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime(), tag, _logger::filePathToName(__FILE__), __LINE__
+#define _LOG_FILE_NAME static_cast<int>(_LOG_FILE_NAME_LENGTH), __FILE__ + _LOG_FILE_NAME_OFFSET // For "%.*s"
+#endif
 
-#define __LOG_FORMAT(loglevel, color, format) color loglevel " " format _LOG_RESET_COLOR LOG_EOL
-#define __LOG_TIME_FORMAT(loglevel, color, format) color "[%s]" loglevel " " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime()
-#define __LOG_FILE_FORMAT(loglevel, color, format) color loglevel "[%s:%d] " format _LOG_RESET_COLOR LOG_EOL, _logger::filePathToName(__FILE__), __LINE__
-#define __LOG_TIME_FILE_FORMAT(loglevel, color, format) color "[%s]" loglevel "[%s:%d] " format _LOG_RESET_COLOR LOG_EOL, _logger::formatTime(), _logger::filePathToName(__FILE__), __LINE__
-#endif // LOG_PRINT_TYPE == LOG_PRINT_TYPE_STD_FORMAT || LOG_PRINT_TYPE == LOG_PRINT_TYPE_FMT_FORMAT
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
+// Every record carries a timestamp the decoder prints
+#define __LOG_TAG_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color loglevel "[{}] " format _LOG_RESET_COLOR LOG_EOL), tag
+#define __LOG_TAG_TIME_FORMAT(loglevel, color, tag, format) __LOG_TAG_FORMAT(loglevel, color, tag, format)
+#define __LOG_TAG_FILE_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color loglevel "[{}][{}:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), tag, _LOG_FILE_NAME
+#define __LOG_TAG_TIME_FILE_FORMAT(loglevel, color, tag, format) __LOG_TAG_FILE_FORMAT(loglevel, color, tag, format)
+
+#define __LOG_FORMAT(loglevel, color, format) _LOG_FLASH(color loglevel " " format _LOG_RESET_COLOR LOG_EOL)
+#define __LOG_TIME_FORMAT(loglevel, color, format) __LOG_FORMAT(loglevel, color, format)
+#define __LOG_FILE_FORMAT(loglevel, color, format) _LOG_FLASH(color loglevel "[{}:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _LOG_FILE_NAME
+#define __LOG_TIME_FILE_FORMAT(loglevel, color, format) __LOG_FILE_FORMAT(loglevel, color, format)
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_STD_FORMAT || LOG_PRINT_TYPE == LOG_PRINT_TYPE_FMT_FORMAT || LOG_PRINT_TYPE == LOG_PRINT_TYPE_CUSTOM_FORMAT
+#define __LOG_TAG_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color loglevel "[{}] " format _LOG_RESET_COLOR LOG_EOL), tag
+#define __LOG_TAG_TIME_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color "[{}]" loglevel "[{}] " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime(), tag
+#define __LOG_TAG_FILE_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color loglevel "[{}][{}:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), tag, _LOG_FILE_NAME
+#define __LOG_TAG_TIME_FILE_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color "[{}]" loglevel "[{}][{}:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime(), tag, _LOG_FILE_NAME
+
+#define __LOG_FORMAT(loglevel, color, format) _LOG_FLASH(color loglevel " " format _LOG_RESET_COLOR LOG_EOL)
+#define __LOG_TIME_FORMAT(loglevel, color, format) _LOG_FLASH(color "[{}]" loglevel " " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime()
+#define __LOG_FILE_FORMAT(loglevel, color, format) _LOG_FLASH(color loglevel "[{}:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _LOG_FILE_NAME
+#define __LOG_TIME_FILE_FORMAT(loglevel, color, format) _LOG_FLASH(color "[{}]" loglevel "[{}:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime(), _LOG_FILE_NAME
+#else
+#define __LOG_TAG_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color loglevel "[%s] " format _LOG_RESET_COLOR LOG_EOL), tag
+#define __LOG_TAG_TIME_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color "[%s]" loglevel "[%s] " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime(), tag
+#define __LOG_TAG_FILE_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color loglevel "[%s][%.*s:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), tag, _LOG_FILE_NAME
+#define __LOG_TAG_TIME_FILE_FORMAT(loglevel, color, tag, format) _LOG_FLASH(color "[%s]" loglevel "[%s][%.*s:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime(), tag, _LOG_FILE_NAME
+
+#define __LOG_FORMAT(loglevel, color, format) _LOG_FLASH(color loglevel " " format _LOG_RESET_COLOR LOG_EOL)
+#define __LOG_TIME_FORMAT(loglevel, color, format) _LOG_FLASH(color "[%s]" loglevel " " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime()
+#define __LOG_FILE_FORMAT(loglevel, color, format) _LOG_FLASH(color loglevel "[%.*s:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _LOG_FILE_NAME
+#define __LOG_TIME_FILE_FORMAT(loglevel, color, format) _LOG_FLASH(color "[%s]" loglevel "[%.*s:" _LOG_LINE_STRING(__LINE__) "] " format _LOG_RESET_COLOR LOG_EOL), _logger::formatTime(), _LOG_FILE_NAME
+#endif // LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
 
 // Format without tag
 
@@ -272,57 +706,82 @@ namespace _logger
  * Logger Print Macros
  *-------------------------------------------------------------------------------------*/
 
+// Every text print type formats into a _logger::RecordWriter in one pass, without heap
+
 // Use std::format (C++20)
 #if LOG_PRINT_TYPE == LOG_PRINT_TYPE_STD_FORMAT
 #include <format>
-#define LOG_PRINTF(msg, ...)                                                                                       \
-    do                                                                                                             \
-    {                                                                                                              \
-        char buffer[LOG_STATIC_BUFFER_SIZE];                                                                       \
-        std::format_to_n_result result = std::format_to_n(buffer, LOG_STATIC_BUFFER_SIZE - 1, msg, ##__VA_ARGS__); \
-        if (result.size < LOG_STATIC_BUFFER_SIZE)                                                                  \
-        {                                                                                                          \
-            buffer[result.size] = '\0';                                                                            \
-            LOG_OUTPUT.print(buffer);                                                                              \
-        }                                                                                                          \
-        else                                                                                                       \
-        {                                                                                                          \
-            char larger_buffer[result.size + 1];                                                                   \
-            std::format_to_n(larger_buffer, result.size, msg, ##__VA_ARGS__);                                      \
-            larger_buffer[result.size] = '\0';                                                                     \
-            LOG_OUTPUT.print(larger_buffer);                                                                       \
-        }                                                                                                          \
+#include <iterator>
+#define _LOG_PRINTF(level, msg, ...)                                         \
+    do                                                                       \
+    {                                                                        \
+        _logger::RecordWriter _log_writer(level);                            \
+        std::format_to(std::back_inserter(_log_writer), msg, ##__VA_ARGS__); \
+        _log_writer.finish();                                                \
     } while (0)
 
 // Use fmtlib fmt::format
 #elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_FMT_FORMAT
 #include <fmt.h>        // lib_deps = https://github.com/RileyCornelius/fmt-arduino.git
 #include <fmt/ranges.h> // Include the ranges support for fmtlib
-#define LOG_PRINTF(msg, ...)                                            \
-    do                                                                  \
-    {                                                                   \
-        fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;  \
-        fmt::format_to(std::back_inserter(buffer), msg, ##__VA_ARGS__); \
-        buffer.push_back('\0');                                         \
-        LOG_OUTPUT.print(buffer.data());                                \
+#define _LOG_PRINTF(level, msg, ...)                                         \
+    do                                                                       \
+    {                                                                        \
+        _logger::RecordWriter _log_writer(level);                            \
+        fmt::format_to(std::back_inserter(_log_writer), msg, ##__VA_ARGS__); \
+        _log_writer.finish();                                                \
     } while (0)
 
 // Use custom format lib afmt::format
 #elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_CUSTOM_FORMAT
 #define AFMT_DEFAULT_INTERNAL_SMALL_BUFFER_SIZE LOG_STATIC_BUFFER_SIZE
 #include "format.h"
-#define LOG_PRINTF(msg, ...)                         \
-    do                                               \
-    {                                                \
-        afmt::buffer buf;                            \
-        afmt::format_to(buf, format, ##__VA_ARGS__); \
-        LOG_OUTPUT.print(buf.c_str());               \
+#define _LOG_PRINTF(level, msg, ...)                      \
+    do                                                    \
+    {                                                     \
+        _logger::RecordWriter _log_writer(level);         \
+        afmt::format_to(_log_writer, msg, ##__VA_ARGS__); \
+        _log_writer.finish();                             \
     } while (0)
 
+// Send a binary record, formatted later by tools/logdecode
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
+#include "LogBinary.h"
+#define _LOG_PRINTF(level, msg, ...)                                                             \
+    do                                                                                           \
+    {                                                                                            \
+        uint8_t record[LOG_BINARY_RECORD_SIZE];                                                  \
+        size_t size = logbin::writeRecord(record, sizeof(record), micros(), msg, ##__VA_ARGS__); \
+        _LOG_WRITE(level, reinterpret_cast<const char *>(record), size);                         \
+    } while (0)
+
+#else
+#define _LOG_PRINTF(level, msg, ...) _logger::printf(level, msg, ##__VA_ARGS__)
+#endif
+
+// One log call, timed and counted against its tag with LOG_STATS_ENABLE
+
+#if LOG_STATS == LOG_STATS_ENABLE
+#define _LOG_RECORD(level, msg, ...)                \
+    do                                              \
+    {                                               \
+        _logger::StatsScope _log_stats(0, nullptr); \
+        _LOG_PRINTF(level, msg, ##__VA_ARGS__);     \
+    } while (0)
+#define _LOG_TAG_RECORD(level, tag, msg, ...)                       \
+    do                                                              \
+    {                                                               \
+        _logger::StatsScope _log_stats(_logger::tagHash(tag), tag); \
+        _LOG_PRINTF(level, msg, ##__VA_ARGS__);                     \
+    } while (0)
 #else
-#define LOG_PRINTF(msg, ...) _logger::printf(msg, ##__VA_ARGS__)
+#define _LOG_RECORD(level, msg, ...) _LOG_PRINTF(level, msg, ##__VA_ARGS__)
+#define _LOG_TAG_RECORD(level, tag, msg, ...) _LOG_PRINTF(level, msg, ##__VA_ARGS__)
 #endif
 
+// Records from LOG_PRINTF have level 0 and reach every sink
+#define LOG_PRINTF(msg, ...) _LOG_RECORD(0, msg, ##__VA_ARGS__)
+
 /**--------------------------------------------------------------------------------------
  * Logger Log Macros
  *-------------------------------------------------------------------------------------*/
@@ -330,31 +789,31 @@ namespace _logger
 // Log without tag
 
 #if LOG_LEVEL >= LOG_LEVEL_VERBOSE
-#define LOG_V(message, ...) LOG_PRINTF(_LOG_FORMAT(_LOG_LEVEL_VERBOSE_TEXT, _LOG_COLOR_V, message), ##__VA_ARGS__)
+#define LOG_V(message, ...) _IF_LOG_LEVEL(LOG_LEVEL_VERBOSE) _LOG_RECORD(LOG_LEVEL_VERBOSE, _LOG_FORMAT(_LOG_LEVEL_VERBOSE_TEXT, _LOG_COLOR_V, message), ##__VA_ARGS__)
 #else
 #define LOG_V(message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG
-#define LOG_D(message, ...) LOG_PRINTF(_LOG_FORMAT(_LOG_LEVEL_DEBUG_TEXT, _LOG_COLOR_D, message), ##__VA_ARGS__)
+#define LOG_D(message, ...) _IF_LOG_LEVEL(LOG_LEVEL_DEBUG) _LOG_RECORD(LOG_LEVEL_DEBUG, _LOG_FORMAT(_LOG_LEVEL_DEBUG_TEXT, _LOG_COLOR_D, message), ##__VA_ARGS__)
 #else
 #define LOG_D(message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_INFO
-#define LOG_I(message, ...) LOG_PRINTF(_LOG_FORMAT(_LOG_LEVEL_INFO_TEXT, _LOG_COLOR_I, message), ##__VA_ARGS__)
+#define LOG_I(message, ...) _IF_LOG_LEVEL(LOG_LEVEL_INFO) _LOG_RECORD(LOG_LEVEL_INFO, _LOG_FORMAT(_LOG_LEVEL_INFO_TEXT, _LOG_COLOR_I, message), ##__VA_ARGS__)
 #else
 #define LOG_I(message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_WARNING
-#define LOG_W(message, ...) LOG_PRINTF(_LOG_FORMAT(_LOG_LEVEL_WARNING_TEXT, _LOG_COLOR_W, message), ##__VA_ARGS__)
+#define LOG_W(message, ...) _IF_LOG_LEVEL(LOG_LEVEL_WARNING) _LOG_RECORD(LOG_LEVEL_WARNING, _LOG_FORMAT(_LOG_LEVEL_WARNING_TEXT, _LOG_COLOR_W, message), ##__VA_ARGS__)
 #else
 #define LOG_W(message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_ERROR
-#define LOG_E(message, ...) LOG_PRINTF(_LOG_FORMAT(_LOG_LEVEL_ERROR_TEXT, _LOG_COLOR_E, message), ##__VA_ARGS__)
+#define LOG_E(message, ...) _IF_LOG_LEVEL(LOG_LEVEL_ERROR) _LOG_RECORD(LOG_LEVEL_ERROR, _LOG_FORMAT(_LOG_LEVEL_ERROR_TEXT, _LOG_COLOR_E, message), ##__VA_ARGS__)
 #else
 #define LOG_E(message, ...)
 #endif
@@ -362,46 +821,157 @@ namespace _logger
 // Log with tag
 
 #if LOG_LEVEL >= LOG_LEVEL_VERBOSE
-#define LOG_VERB(tag, message, ...)                                                                  \
-    _IF_LOG_FILTER_BEGIN(tag)                                                                        \
-    LOG_PRINTF(_LOG_TAG_FORMAT(_LOG_LEVEL_VERBOSE_TEXT, _LOG_COLOR_V, tag, message), ##__VA_ARGS__); \
+#define LOG_VERB(tag, message, ...)                                                                                               \
+    _IF_LOG_FILTER_BEGIN(tag)                                                                                                     \
+    _IF_LOG_TAG_LEVEL(tag, LOG_LEVEL_VERBOSE)                                                                                     \
+    _LOG_TAG_RECORD(LOG_LEVEL_VERBOSE, tag, _LOG_TAG_FORMAT(_LOG_LEVEL_VERBOSE_TEXT, _LOG_COLOR_V, tag, message), ##__VA_ARGS__); \
     _IF_LOG_FILTER_END
 #else
 #define LOG_VERB(tag, message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG
-#define LOG_DEBUG(tag, message, ...)                                                               \
-    _IF_LOG_FILTER_BEGIN(tag)                                                                      \
-    LOG_PRINTF(_LOG_TAG_FORMAT(_LOG_LEVEL_DEBUG_TEXT, _LOG_COLOR_D, tag, message), ##__VA_ARGS__); \
+#define LOG_DEBUG(tag, message, ...)                                                                                          \
+    _IF_LOG_FILTER_BEGIN(tag)                                                                                                 \
+    _IF_LOG_TAG_LEVEL(tag, LOG_LEVEL_DEBUG)                                                                                   \
+    _LOG_TAG_RECORD(LOG_LEVEL_DEBUG, tag, _LOG_TAG_FORMAT(_LOG_LEVEL_DEBUG_TEXT, _LOG_COLOR_D, tag, message), ##__VA_ARGS__); \
     _IF_LOG_FILTER_END
 #else
 #define LOG_DEBUG(tag, message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_INFO
-#define LOG_INFO(tag, message, ...)                                                               \
-    _IF_LOG_FILTER_BEGIN(tag)                                                                     \
-    LOG_PRINTF(_LOG_TAG_FORMAT(_LOG_LEVEL_INFO_TEXT, _LOG_COLOR_I, tag, message), ##__VA_ARGS__); \
+#define LOG_INFO(tag, message, ...)                                                                                         \
+    _IF_LOG_FILTER_BEGIN(tag)                                                                                               \
+    _IF_LOG_TAG_LEVEL(tag, LOG_LEVEL_INFO)                                                                                  \
+    _LOG_TAG_RECORD(LOG_LEVEL_INFO, tag, _LOG_TAG_FORMAT(_LOG_LEVEL_INFO_TEXT, _LOG_COLOR_I, tag, message), ##__VA_ARGS__); \
     _IF_LOG_FILTER_END
 #else
 #define LOG_INFO(tag, message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_WARNING
-#define LOG_WARN(tag, message, ...)                                                                  \
-    _IF_LOG_FILTER_BEGIN(tag)                                                                        \
-    LOG_PRINTF(_LOG_TAG_FORMAT(_LOG_LEVEL_WARNING_TEXT, _LOG_COLOR_W, tag, message), ##__VA_ARGS__); \
+#define LOG_WARN(tag, message, ...)                                                                                               \
+    _IF_LOG_FILTER_BEGIN(tag)                                                                                                     \
+    _IF_LOG_TAG_LEVEL(tag, LOG_LEVEL_WARNING)                                                                                     \
+    _LOG_TAG_RECORD(LOG_LEVEL_WARNING, tag, _LOG_TAG_FORMAT(_LOG_LEVEL_WARNING_TEXT, _LOG_COLOR_W, tag, message), ##__VA_ARGS__); \
     _IF_LOG_FILTER_END
 #else
 #define LOG_WARN(tag, message, ...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_ERROR
-#define LOG_ERROR(tag, message, ...)                                                               \
-    _IF_LOG_FILTER_BEGIN(tag)                                                                      \
-    LOG_PRINTF(_LOG_TAG_FORMAT(_LOG_LEVEL_ERROR_TEXT, _LOG_COLOR_E, tag, message), ##__VA_ARGS__); \
+#define LOG_ERROR(tag, message, ...)                                                                                          \
+    _IF_LOG_FILTER_BEGIN(tag)                                                                                                 \
+    _IF_LOG_TAG_LEVEL(tag, LOG_LEVEL_ERROR)                                                                                   \
+    _LOG_TAG_RECORD(LOG_LEVEL_ERROR, tag, _LOG_TAG_FORMAT(_LOG_LEVEL_ERROR_TEXT, _LOG_COLOR_E, tag, message), ##__VA_ARGS__); \
     _IF_LOG_FILTER_END
 #else
 #define LOG_ERROR(tag, message, ...)
-#endif
\ No newline at end of file
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Logger Limit Macros
+ *
+ * Put in front of a log call, which only runs when the limit lets it through, so its arguments
+ * are not evaluated otherwise. Each call site counts the records it skipped.
+ *
+ *   LOG_EVERY_N(100) LOG_D("adc={}", analogRead(A0));
+ *   LOG_EVERY_MS(1000) LOG_INFO("MOTOR", "rpm={}", rpm);
+ *   LOG_ONCE() LOG_W("sensor missing");
+ *   LOG_RATE_LIMITED("MOTOR", 5) LOG_WARN("MOTOR", "stall {}", current);
+ *-------------------------------------------------------------------------------------*/
+
+#if LOG_LEVEL > LOG_LEVEL_DISABLE
+#define LOG_EVERY_N(n) _IF_LOG_EVERY_N(n)
+#define LOG_EVERY_MS(ms) _IF_LOG_EVERY_MS(ms, millis())
+#define LOG_ONCE() _IF_LOG_ONCE()
+#define LOG_RATE_LIMITED(tag, perSecond) _IF_LOG_RATE_LIMITED(_logger::tagHash(tag), perSecond)
+#else
+#define LOG_EVERY_N(n) if (true) {} else
+#define LOG_EVERY_MS(ms) if (true) {} else
+#define LOG_ONCE() if (true) {} else
+#define LOG_RATE_LIMITED(tag, perSecond) if (true) {} else
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Logger Key-Value Macros
+ *
+ * One record of named fields for log pipelines, written as JSON Lines or CBOR as set by
+ * LOG_KV_FORMAT. Takes a tag, a level, an event and up to 8 key and value pairs, keys are
+ * string literals. Level and tag filters apply as for LOG_INFO.
+ *
+ *   LOG_KV("MOTOR", LOG_LEVEL_WARNING, "stall", "rpm", rpm, "amps", current);
+ *   {"ms":1234,"lvl":"warn","tag":"MOTOR","ev":"stall","rpm":1200,"amps":3.25}
+ *-------------------------------------------------------------------------------------*/
+
+#include "LogKv.h"
+
+#if LOG_KV_FORMAT == LOG_KV_FORMAT_CBOR
+#define _LOG_KV_ENCODING logkv::cbor
+#else
+#define _LOG_KV_ENCODING logkv::json
+#endif
+
+// Time key and value in front of the level, nothing without LOG_TIME
+#if LOG_TIME == LOG_TIME_DISABLE
+#define _LOG_KV_TIME
+#elif LOG_TIME == LOG_TIME_MICROS || LOG_TIME == LOG_TIME_SECONDS_MICROS
+#define _LOG_KV_TIME "us", micros(),
+#else
+#define _LOG_KV_TIME "ms", millis(),
+#endif
+
+// Number of key and value pairs, an odd number of arguments does not compile
+#define _LOG_KV_SELECT(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, count, ...) count
+#define _LOG_KV_COUNT(...) _LOG_KV_SELECT(0, ##__VA_ARGS__, 8, _, 7, _, 6, _, 5, _, 4, _, 3, _, 2, _, 1, _, 0)
+#define _LOG_KV_CONCAT(a, b) _LOG_KV_CONCAT_(a, b)
+#define _LOG_KV_CONCAT_(a, b) a##b
+
+// The key text is built at compile time, a constant in the firmware
+#define _LOG_KV_FIELD(out, key, value)                                                        \
+    {                                                                                         \
+        static constexpr _LOG_KV_ENCODING::Key<_LOG_KV_ENCODING::keySize(key)> _log_key(key); \
+        _LOG_KV_ENCODING::field(out, _log_key, value);                                        \
+    }
+#define _LOG_KV_FIELDS_0(out)
+#define _LOG_KV_FIELDS_1(out, key, value) _LOG_KV_FIELD(out, key, value)
+#define _LOG_KV_FIELDS_2(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_1(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS_3(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_2(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS_4(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_3(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS_5(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_4(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS_6(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_5(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS_7(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_6(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS_8(out, key, value, ...) _LOG_KV_FIELD(out, key, value) _LOG_KV_FIELDS_7(out, __VA_ARGS__)
+#define _LOG_KV_FIELDS(out, ...) _LOG_KV_CONCAT(_LOG_KV_FIELDS_, _LOG_KV_COUNT(__VA_ARGS__))(out, ##__VA_ARGS__)
+
+#if LOG_STATS == LOG_STATS_ENABLE
+#define _LOG_KV_STATS(tag) _logger::StatsScope _log_stats(_logger::tagHash(tag), tag);
+#else
+#define _LOG_KV_STATS(tag)
+#endif
+
+// Encodes straight into a _logger::RecordWriter, like the text print types
+#define _LOG_KV_RECORD(level, tag, event, ...)                                                            \
+    do                                                                                                    \
+    {                                                                                                     \
+        _LOG_KV_STATS(tag)                                                                                \
+        _logger::RecordWriter _log_writer(level);                                                         \
+        _LOG_KV_ENCODING::begin(_log_writer, _LOG_KV_COUNT(__VA_ARGS__), _LOG_KV_TIME level, tag, event); \
+        _LOG_KV_FIELDS(_log_writer, ##__VA_ARGS__)                                                        \
+        _LOG_KV_ENCODING::end(_log_writer);                                                               \
+        _log_writer.finishWhole();                                                                        \
+    } while (0)
+
+#if LOG_LEVEL > LOG_LEVEL_DISABLE && LOG_PRINT_TYPE == LOG_PRINT_TYPE_BINARY
+#define LOG_KV(tag, level, event, ...) static_assert(false, "LOG_KV needs a text LOG_PRINT_TYPE, binary records cannot carry it")
+#elif LOG_LEVEL > LOG_LEVEL_DISABLE
+#define LOG_KV(tag, level, event, ...)                \
+    _IF_LOG_FILTER_BEGIN(tag)                         \
+    if (!((level) <= LOG_LEVEL)) {} else              \
+    _IF_LOG_TAG_LEVEL(tag, level)                     \
+    _LOG_KV_RECORD(level, tag, event, ##__VA_ARGS__); \
+    _IF_LOG_FILTER_END
+#else
+#define LOG_KV(tag, level, event, ...)
+#endif
@@ -2,6 +2,18 @@
 
 #include <Arduino.h>
 
+// EVERY_N_MILLIS and EVERY_N_MICROS
+#define TIMER_EVERY_N_POLL 0  // A Timer per call site, each one reads the clock on every pass
+#define TIMER_EVERY_N_WHEEL 1 // A WheelTimer per call site on timerWheel(), call updateTimers() in loop()
+
+#ifndef TIMER_EVERY_N
+#define TIMER_EVERY_N TIMER_EVERY_N_POLL
+#endif
+
+#if TIMER_EVERY_N == TIMER_EVERY_N_WHEEL
+#include "TimerWheel.h"
+#endif
+
 /**--------------------------------------------------------------------------------------
  * Millis Timer Class
  *-------------------------------------------------------------------------------------*/
@@ -68,18 +80,30 @@ public:
 // do something every 1000 miliseconds
 // }
 #define EVERY_N_MILLIS(n) I_EVERY_N_MILLIS(CONCAT(_timer_, __COUNTER__), n)
+#if TIMER_EVERY_N == TIMER_EVERY_N_WHEEL
+#define I_EVERY_N_MILLIS(name, n)            \
+    static WheelTimer name(timerWheel(), n); \
+    if (name.getPeriod() == 0 || name.fired())
+#else
 #define I_EVERY_N_MILLIS(name, n) \
     static Timer name = Timer(n); \
     if (name.isReady())
+#endif
 
 // EVERY_N_MICROS(1000)
 // {
 // do something every 1000 microseconds
 // }
 #define EVERY_N_MICROS(n) I_EVERY_N_MICROS(CONCAT(_timer_, __COUNTER__), n)
+#if TIMER_EVERY_N == TIMER_EVERY_N_WHEEL
+#define I_EVERY_N_MICROS(name, n)                  \
+    static WheelTimer name(timerWheelMicros(), n); \
+    if (name.getPeriod() == 0 || name.fired())
+#else
 #define I_EVERY_N_MICROS(name, n)             \
     static TimerMicros name = TimerMicros(n); \
     if (name.isReady())
+#endif
 
 // Join two symbols together
 #define CONCAT(x, y) I_CONCAT(x, y)
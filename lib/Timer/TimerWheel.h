@@ -0,0 +1,385 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+/**--------------------------------------------------------------------------------------
+ * Timer Wheel
+ *
+ * Hierarchical timing wheel of 5 levels with 32 slots each, every level 32 times coarser than
+ * the one below. A timer is linked into the level its delay falls in and moves down a level each
+ * time the level below wraps, so schedule, cancel and expiry are O(1) per timer. update() jumps
+ * to the next occupied slot, at most 32 ticks at a time, instead of checking every timer.
+ *
+ * Timers are WheelTimer objects owned by the caller, the wheel never allocates. Delays longer
+ * than 32^5 ticks (9.3 hours in millis) are parked on the top level and placed again on the way
+ * down. Not thread safe, schedule, cancel and update from the same task.
+ *-------------------------------------------------------------------------------------*/
+
+struct TimerWheelMillis
+{
+#if defined(ARDUINO)
+    static uint32_t now() { return millis(); }
+#else
+    static uint32_t now() { return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+#endif
+};
+
+struct TimerWheelMicros
+{
+#if defined(ARDUINO)
+    static uint32_t now() { return micros(); }
+#else
+    static uint32_t now() { return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+#endif
+};
+
+template <typename Clock>
+class TimerWheel;
+
+/**--------------------------------------------------------------------------------------
+ * Wheel Timer Class
+ *-------------------------------------------------------------------------------------*/
+
+class WheelTimer
+{
+public:
+    typedef void (*Callback)(void *context);
+
+private:
+    template <typename Clock>
+    friend class TimerWheel;
+
+    static const uint8_t idle = 0xFF;
+    static const uint8_t expiring = 0xFE;
+
+    WheelTimer *next;
+    WheelTimer *prev;
+    uint32_t deadline;
+    uint32_t period; // 0 for a one shot
+    Callback callback;
+    void *context;
+    uint8_t slot;     // Level * 32 + slot in the wheel, expiring or idle
+    uint8_t expiries; // Without a callback, expiries not taken by fired() yet
+
+public:
+    // Calls callback on expiry. Without one, fired() tells when it expired.
+    explicit WheelTimer(Callback callback = nullptr, void *context = nullptr)
+        : next(nullptr), prev(nullptr), deadline(0), period(0), callback(callback), context(context), slot(idle), expiries(0) {}
+
+    // Scheduled on wheel every period ticks, the first time period ticks from now. A period of 0 is
+    // not scheduled, EVERY_N_MILLIS(0) then passes on every call as it does with a Timer.
+    template <typename Clock>
+    WheelTimer(TimerWheel<Clock> &wheel, uint32_t period) : WheelTimer()
+    {
+        if (period != 0)
+        {
+            wheel.schedule(*this, period, period);
+        }
+    }
+
+    // Linked into a wheel by address, cancel it before it goes out of scope
+    WheelTimer(const WheelTimer &) = delete;
+    WheelTimer &operator=(const WheelTimer &) = delete;
+
+    void setCallback(Callback callback, void *context = nullptr)
+    {
+        this->callback = callback;
+        this->context = context;
+    }
+
+    bool isScheduled() const { return slot != idle; }
+    uint32_t getDeadline() const { return deadline; }
+    uint32_t getPeriod() const { return period; }
+
+    // True once after the timer expired, for timers without a callback
+    bool fired()
+    {
+        bool expired = expiries > 0;
+        expiries = 0;
+        return expired;
+    }
+};
+
+/**--------------------------------------------------------------------------------------
+ * Timer Wheel Class
+ *-------------------------------------------------------------------------------------*/
+
+template <typename Clock = TimerWheelMillis>
+class TimerWheel
+{
+private:
+    static const uint8_t slotBits = 5;
+    static const uint8_t slotCount = 1 << slotBits;
+    static const uint8_t levels = 5;
+    static const uint32_t maxDelay = (1ul << (slotBits * levels)) - 1;
+
+    WheelTimer *slots[levels * slotCount];
+    uint32_t occupied[levels]; // Bit per slot with timers
+    WheelTimer *due;           // Timers expiring in the running update()
+    uint32_t current;          // Last tick processed
+    size_t count;
+
+    static uint8_t levelIndex(uint32_t tick, uint8_t level) { return (tick >> (slotBits * level)) & (slotCount - 1); }
+
+    // Bits of slots starting after index, wrapping around to index itself
+    static uint32_t after(uint32_t bits, uint8_t index)
+    {
+        uint8_t shift = (index + 1) & (slotCount - 1);
+        return shift == 0 ? bits : (bits >> shift) | (bits << (slotCount - shift));
+    }
+
+    WheelTimer *&head(uint8_t slot) { return slot == WheelTimer::expiring ? due : slots[slot]; }
+
+    void link(WheelTimer &timer, uint8_t slot)
+    {
+        WheelTimer *&first = head(slot);
+        timer.prev = nullptr;
+        timer.next = first;
+        if (first != nullptr)
+        {
+            first->prev = &timer;
+        }
+        first = &timer;
+        timer.slot = slot;
+        if (slot != WheelTimer::expiring)
+        {
+            occupied[slot >> slotBits] |= 1ul << (slot & (slotCount - 1));
+        }
+    }
+
+    void unlink(WheelTimer &timer)
+    {
+        WheelTimer *&first = head(timer.slot);
+        if (timer.prev != nullptr)
+        {
+            timer.prev->next = timer.next;
+        }
+        else
+        {
+            first = timer.next;
+        }
+        if (timer.next != nullptr)
+        {
+            timer.next->prev = timer.prev;
+        }
+        if (first == nullptr && timer.slot != WheelTimer::expiring)
+        {
+            occupied[timer.slot >> slotBits] &= ~(1ul << (timer.slot & (slotCount - 1)));
+        }
+        timer.slot = WheelTimer::idle;
+    }
+
+    // Links a timer into the slot delay ticks from the current tick, 0 is the slot being expired
+    void place(WheelTimer &timer, uint32_t delay)
+    {
+        delay = delay < maxDelay ? delay : maxDelay;
+        uint8_t level = 0;
+        while (level < levels - 1 && delay >> (slotBits * (level + 1)) != 0)
+        {
+            level++;
+        }
+        link(timer, level * slotCount + levelIndex(current + delay, level));
+    }
+
+    // Moves the timers of the next slot on each level that wrapped down to the levels below
+    void cascade()
+    {
+        for (uint8_t level = 1; level < levels; level++)
+        {
+            uint8_t index = levelIndex(current, level);
+            uint8_t slot = level * slotCount + index;
+            WheelTimer *timer = slots[slot];
+            slots[slot] = nullptr;
+            occupied[level] &= ~(1ul << index);
+            while (timer != nullptr)
+            {
+                WheelTimer *next = timer->next;
+                place(*timer, timer->deadline - current);
+                timer = next;
+            }
+            if (index != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    size_t expire()
+    {
+        uint8_t index = levelIndex(current, 0);
+        if (slots[index] == nullptr)
+        {
+            return 0;
+        }
+        due = slots[index];
+        slots[index] = nullptr;
+        occupied[0] &= ~(1ul << index);
+        for (WheelTimer *timer = due; timer != nullptr; timer = timer->next)
+        {
+            timer->slot = WheelTimer::expiring;
+        }
+
+        size_t expired = 0;
+        while (due != nullptr)
+        {
+            // A callback may cancel or schedule any timer, this one included
+            WheelTimer &timer = *due;
+            unlink(timer);
+            count--;
+            if (timer.period != 0)
+            {
+                uint32_t deadline = timer.deadline + timer.period;
+                scheduleAt(timer, static_cast<int32_t>(deadline - current) > 0 ? deadline : current + timer.period, timer.period);
+            }
+            if (timer.callback != nullptr)
+            {
+                timer.callback(timer.context);
+            }
+            else if (timer.expiries < 0xFF)
+            {
+                timer.expiries++;
+            }
+            expired++;
+        }
+        return expired;
+    }
+
+    // Ticks to the next occupied slot on level 0 or the next cascade, 1 to 32
+    uint32_t nextStep() const
+    {
+        uint32_t toCascade = slotCount - (current & (slotCount - 1));
+        uint32_t bits = after(occupied[0], levelIndex(current, 0));
+        if (bits == 0)
+        {
+            return toCascade;
+        }
+        uint32_t toSlot = static_cast<uint32_t>(__builtin_ctzl(bits)) + 1;
+        return toSlot < toCascade ? toSlot : toCascade;
+    }
+
+public:
+    explicit TimerWheel(uint32_t now = Clock::now()) : slots(), occupied(), due(nullptr), current(now), count(0) {}
+
+    // Expires once delay ticks from now, then every period ticks when period is not 0. Scheduling
+    // a scheduled timer moves it.
+    void schedule(WheelTimer &timer, uint32_t delay, uint32_t period = 0)
+    {
+        scheduleAt(timer, Clock::now() + delay, period);
+    }
+
+    // Expires at the deadline tick, on the next update() when it has passed
+    void scheduleAt(WheelTimer &timer, uint32_t deadline, uint32_t period = 0)
+    {
+        cancel(timer);
+        timer.deadline = deadline;
+        timer.period = period;
+        int32_t delay = static_cast<int32_t>(deadline - current);
+        place(timer, delay > 0 ? static_cast<uint32_t>(delay) : 1);
+        count++;
+    }
+
+    void cancel(WheelTimer &timer)
+    {
+        if (timer.isScheduled())
+        {
+            unlink(timer);
+            count--;
+        }
+    }
+
+    // Expires every timer due by now and calls their callbacks, returns how many expired. Call it
+    // from loop().
+    size_t update(uint32_t now = Clock::now())
+    {
+        size_t expired = 0;
+        while (count > 0 && static_cast<int32_t>(now - current) > 0)
+        {
+            uint32_t step = nextStep();
+            if (step > now - current)
+            {
+                break;
+            }
+            current += step;
+            if ((current & (slotCount - 1)) == 0)
+            {
+                cascade();
+            }
+            expired += expire();
+        }
+        if (static_cast<int32_t>(now - current) > 0)
+        {
+            current = now;
+        }
+        return expired;
+    }
+
+    // Deadline of the timer due first, false without timers. Looks at one slot on each level.
+    bool nextDeadline(uint32_t &deadline) const
+    {
+        bool found = false;
+        for (uint8_t level = 0; level < levels; level++)
+        {
+            uint32_t bits = after(occupied[level], levelIndex(current, level));
+            if (bits == 0)
+            {
+                continue;
+            }
+            uint8_t index = (levelIndex(current, level) + 1 + __builtin_ctzl(bits)) & (slotCount - 1);
+            for (const WheelTimer *timer = slots[level * slotCount + index]; timer != nullptr; timer = timer->next)
+            {
+                if (!found || static_cast<int32_t>(timer->deadline - deadline) < 0)
+                {
+                    deadline = timer->deadline;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+
+    // Ticks until the next timer is due, 0 when one is overdue and UINT32_MAX without timers. Sleep
+    // this long between updates when nothing else runs.
+    uint32_t timeToNext(uint32_t now = Clock::now()) const
+    {
+        uint32_t deadline = 0;
+        if (!nextDeadline(deadline))
+        {
+            return UINT32_MAX;
+        }
+        int32_t remaining = static_cast<int32_t>(deadline - now);
+        return remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+    }
+
+    size_t size() const { return count; }
+    uint32_t now() const { return current; } // Last tick updated to
+};
+
+/**--------------------------------------------------------------------------------------
+ * Shared Wheels
+ *-------------------------------------------------------------------------------------*/
+
+// Wheels behind EVERY_N_MILLIS and EVERY_N_MICROS with TIMER_EVERY_N_WHEEL
+inline TimerWheel<TimerWheelMillis> &timerWheel()
+{
+    static TimerWheel<TimerWheelMillis> wheel;
+    return wheel;
+}
+
+inline TimerWheel<TimerWheelMicros> &timerWheelMicros()
+{
+    static TimerWheel<TimerWheelMicros> wheel;
+    return wheel;
+}
+
+// Call once at the top of loop()
+inline void updateTimers()
+{
+    timerWheel().update();
+    timerWheelMicros().update();
+}
@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include <Async.h>
+#include <AsyncButton.h>
+
+static AsyncButton button;
+static bool blinking = true;
+
+static AsyncTask blink()
+{
+    pinMode(LED_BUILTIN, OUTPUT);
+    while (true)
+    {
+        co_await until([]
+                       { return blinking; });
+        digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+        co_await sleep_ms(250);
+    }
+}
+
+static AsyncTask countdown(int seconds)
+{
+    for (int i = seconds; i > 0; i--)
+    {
+        Serial.println(i);
+        co_await sleep_ms(1000);
+    }
+}
+
+static AsyncTask menu()
+{
+    while (true)
+    {
+        co_await button.clicked();
+        Serial.println("Button clicked, double click within 2 s to count down");
+        if (co_await button.doubleClicked(2000))
+        {
+            blinking = false;
+            co_await countdown(3);
+            blinking = true;
+        }
+        else
+        {
+            Serial.println("No double click");
+        }
+    }
+}
+
+void asyncSetup()
+{
+    button.init(2);
+    asyncExecutor().start(blink());
+    asyncExecutor().start(menu());
+}
+
+void asyncLoop()
+{
+    asyncExecutor().run();
+}
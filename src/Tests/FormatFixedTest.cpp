@@ -0,0 +1,48 @@
+// Compares the double and fixed-point float paths on an FPU-less board.
+// Run on uno_sim twice, with and without -D AFMT_FLOAT_MODE=AFMT_FLOAT_MODE_FIXED in build_flags,
+// and compare the printed times and the flash size reported by the build.
+#include <Arduino.h>
+#include <format.h>
+
+static const int iterations = 100;
+
+static void benchmarkFloats()
+{
+    char text[32];
+    volatile double value = 23.4567;
+
+    unsigned long start = micros();
+    for (int i = 0; i < iterations; i++)
+    {
+        afmt::format_to(text, "{:.2f}", static_cast<double>(value));
+    }
+    unsigned long doubleTime = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < iterations; i++)
+    {
+        afmt::format_to(text, "{:.2f}", afmt::scaled(2346, 2));
+    }
+    unsigned long scaledTime = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < iterations; i++)
+    {
+        afmt::format_to(text, "{:.2f}", afmt::q<16>(1537258)); // 23.4567 in Q15.16
+    }
+    unsigned long qTime = micros() - start;
+
+    afmt::println("AFMT_FLOAT_MODE: {}", AFMT_FLOAT_MODE == AFMT_FLOAT_MODE_FIXED ? "fixed" : "double");
+    afmt::println("double {:>6} us/op, {:>8} cycles/op", doubleTime / iterations, doubleTime * (F_CPU / 1000000UL) / iterations);
+    afmt::println("scaled {:>6} us/op, {:>8} cycles/op", scaledTime / iterations, scaledTime * (F_CPU / 1000000UL) / iterations);
+    afmt::println("q16    {:>6} us/op, {:>8} cycles/op", qTime / iterations, qTime * (F_CPU / 1000000UL) / iterations);
+}
+
+void formatFixedSetup()
+{
+    benchmarkFloats();
+}
+
+void formatFixedLoop()
+{
+}
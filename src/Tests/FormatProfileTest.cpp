@@ -0,0 +1,31 @@
+// Size and speed of an afmt feature profile. Build once per profile with
+// -D AFMT_PROFILE=AFMT_PROFILE_MINIMAL / AFMT_PROFILE_STANDARD / AFMT_PROFILE_FULL in build_flags
+// for uno, esp32-c3-devkitm-1 and pico, and compare the flash size from the build with the times printed here.
+#include <Arduino.h>
+#include <format.h>
+
+static const int iterations = 200;
+
+void formatProfileSetup()
+{
+    char text[96];
+    volatile int value = 1234;
+    volatile double reading = 23.456;
+
+    unsigned long start = micros();
+    for (int i = 0; i < iterations; i++)
+    {
+        afmt::format_to(text, "{:<8}|{:>6}|{:x}|{:08.2f}|{}", "sensor", static_cast<int>(value), static_cast<int>(value),
+                        static_cast<double>(reading), static_cast<double>(reading));
+    }
+    unsigned long elapsed = micros() - start;
+
+    afmt::println("AFMT_PROFILE: {}", AFMT_PROFILE == AFMT_PROFILE_MINIMAL ? "minimal" : AFMT_PROFILE == AFMT_PROFILE_STANDARD ? "standard"
+                                                                                                                                : "full");
+    afmt::println("{}", text);
+    afmt::println("{} us/op", elapsed / iterations);
+}
+
+void formatProfileLoop()
+{
+}
@@ -0,0 +1,53 @@
+#include <Arduino.h>
+#include "Benchmark.h"
+#include "log.h"
+
+// Time per log call on the board. Build with LOG_STATS_ENABLE in log.h to see how the time splits
+// between formatting and LOG_OUTPUT, tools/logbench compares the print types on the host.
+
+static const char *TAG = "BENCH";
+static const int records = 100;
+
+void loggerBenchmarkSetup()
+{
+    LOG_BEGIN(115200);
+}
+
+void loggerBenchmarkLoop()
+{
+    int value = rand();
+    float f = value / 10440.3f;
+
+#if LOG_STATS == LOG_STATS_ENABLE
+    logResetStats();
+#endif
+
+    BENCHMARK_MICROS_BEGIN(log_i);
+    for (int i = 0; i < records; i++)
+    {
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
+        LOG_I("value %d float %.3f", value, f);
+#else
+        LOG_I("value {} float {:.3f}", value, f);
+#endif
+    }
+    BENCHMARK_MICROS_END(log_i);
+
+    BENCHMARK_MICROS_BEGIN(log_info_tag);
+    for (int i = 0; i < records; i++)
+    {
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
+        LOG_INFO(TAG, "value %d float %.3f", value, f);
+#else
+        LOG_INFO(TAG, "value {} float {:.3f}", value, f);
+#endif
+    }
+    BENCHMARK_MICROS_END(log_info_tag);
+
+    logFlush();
+#if LOG_STATS == LOG_STATS_ENABLE
+    logReportStats();
+#endif
+
+    delay(10000);
+}
@@ -1,15 +1,26 @@
 #include <SimpleTimer.h>
+#include <TimerWheel.h>
 
 static Timer timer = Timer(1000);
 
+static void printExpired(void *)
+{
+    Serial.println("WheelTimer expired");
+}
+
+static WheelTimer wheelTimer(printExpired);
+
 void timerSetup()
 {
+    timerWheel().schedule(wheelTimer, 500, 2000); // In 500 ms, then every 2 s
 }
 
 void timerLoop()
 {
+    updateTimers();
+
     if (timer)
     {
         Serial.println("Timer isReady");
     }
-}
\ No newline at end of file
+}
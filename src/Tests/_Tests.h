@@ -4,6 +4,11 @@
 void arraySetup();
 void arrayLoop();
 
+// AsyncTest.cpp
+
+void asyncSetup();
+void asyncLoop();
+
 // Benchmark.cpp
 
 void benchmarkSetup();
@@ -24,6 +29,16 @@ void csvLoop();
 void digitalOutputSetup();
 void digitalOutputLoop();
 
+// FormatFixedTest.cpp
+
+void formatFixedSetup();
+void formatFixedLoop();
+
+// FormatProfileTest.cpp
+
+void formatProfileSetup();
+void formatProfileLoop();
+
 // FsmSimpleTest.cpp
 
 void fsmSimpleSetup();
@@ -44,6 +59,11 @@ void linkedListLoop();
 void loggerSetup();
 void loggerLoop();
 
+// LoggerBenchmarkTest.cpp
+
+void loggerBenchmarkSetup();
+void loggerBenchmarkLoop();
+
 // OptionalTest.cpp
 
 void optionalSetup();
@@ -0,0 +1,29 @@
+// Stand-in for the parts of Arduino.h that lib/Button uses, for the native test env. The tests
+// set the time and the pin levels by hand. ARDUINO stays undefined so the other libraries keep
+// their host paths.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+inline uint32_t nativeMillis = 0;
+inline uint8_t nativePins[64] = {};
+
+inline unsigned long millis() { return nativeMillis; }
+inline unsigned long micros() { return nativeMillis * 1000; }
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+	nativePins[pin % 64] = mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+inline int digitalRead(uint8_t pin) { return nativePins[pin % 64]; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { nativePins[pin % 64] = value; }
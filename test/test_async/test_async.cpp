@@ -0,0 +1,396 @@
+// Coroutine tasks on AsyncExecutor, run at times the tests pass in by hand
+//
+// pio test -e native -f test_async
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <Async.h>
+#ifndef ARDUINO
+#include <AsyncButton.h>
+#endif
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Records the tick each step of a task ran at
+struct Trace
+{
+	TimerWheel<TimerWheelMillis> *wheel;
+	uint32_t ticks[16];
+	int count;
+
+	void mark()
+	{
+		if (count < 16)
+		{
+			ticks[count] = wheel->now();
+		}
+		count++;
+	}
+};
+
+// Runs the executor at every tick from, up to and including to
+static void runUntil(AsyncExecutor &executor, uint32_t from, uint32_t to)
+{
+	for (uint32_t now = from; now <= to; now++)
+	{
+		executor.run(now);
+	}
+}
+
+AsyncTask sleeper(Trace &trace, uint32_t ms, int times)
+{
+	for (int i = 0; i < times; i++)
+	{
+		trace.mark();
+		co_await sleep_ms(ms);
+	}
+	trace.mark();
+}
+
+AsyncTask waiter(Trace &trace, const bool &flag, uint32_t timeoutMs, bool &result)
+{
+	trace.mark();
+	result = co_await until([&flag]
+							{ return flag; },
+							timeoutMs);
+	trace.mark();
+}
+
+AsyncTask child(Trace &trace)
+{
+	trace.mark();
+	co_await sleep_ms(10);
+	trace.mark();
+}
+
+AsyncTask parent(Trace &trace)
+{
+	co_await child(trace);
+	co_await child(trace);
+	trace.mark();
+}
+
+AsyncTask checkedParent(Trace &trace, bool &ran)
+{
+	ran = co_await child(trace);
+	trace.mark();
+}
+
+AsyncTask yielder(int &counter)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		counter++;
+		co_await sleep_ms(0);
+	}
+}
+
+#ifndef ARDUINO
+AsyncTask clickCounter(AsyncButton &button, int &clicks)
+{
+	while (clicks < 10)
+	{
+		co_await button.clicked();
+		clicks++;
+	}
+}
+
+// Runs the executor every tick from, up to and including to, with the pin held at level
+static void runButton(AsyncExecutor &executor, uint8_t pin, uint8_t level, uint32_t from, uint32_t to)
+{
+	nativePins[pin] = level;
+	for (uint32_t now = from; now <= to; now++)
+	{
+		nativeMillis = now;
+		executor.run(now);
+	}
+}
+#endif
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_sleep()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	TEST_ASSERT_TRUE(executor.start(sleeper(trace, 100, 3)));
+	TEST_ASSERT_EQUAL(1, executor.size());
+	TEST_ASSERT_EQUAL(0, trace.count); // Runs from the next run()
+
+	runUntil(executor, 1, 500);
+	TEST_ASSERT_EQUAL(4, trace.count);
+	TEST_ASSERT_EQUAL(1, trace.ticks[0]);
+	TEST_ASSERT_EQUAL(101, trace.ticks[1]);
+	TEST_ASSERT_EQUAL(201, trace.ticks[2]);
+	TEST_ASSERT_EQUAL(301, trace.ticks[3]);
+	TEST_ASSERT_EQUAL(0, executor.size());
+	TEST_ASSERT_EQUAL(0, asyncFramePool().size());
+}
+
+// A run() late by many ticks resumes the task once, at that run()
+void test_sleep_late_run()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	executor.start(sleeper(trace, 50, 1));
+	executor.run(0);
+	TEST_ASSERT_EQUAL(50, executor.timeToNext(0));
+	executor.run(49);
+	TEST_ASSERT_EQUAL(1, trace.count);
+	executor.run(400);
+	TEST_ASSERT_EQUAL(2, trace.count);
+	TEST_ASSERT_EQUAL(400, trace.ticks[1]);
+}
+
+void test_until()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	bool flag = false;
+	bool result = false;
+	executor.start(waiter(trace, flag, 0, result));
+	runUntil(executor, 1, 100);
+	TEST_ASSERT_EQUAL(1, trace.count);
+	TEST_ASSERT_EQUAL(0, executor.timeToNext(100)); // Polling
+
+	flag = true;
+	executor.run(101);
+	TEST_ASSERT_EQUAL(2, trace.count);
+	TEST_ASSERT_TRUE(result);
+	TEST_ASSERT_EQUAL(0, executor.size());
+}
+
+// A predicate already true does not suspend
+void test_until_ready()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	bool flag = true;
+	bool result = false;
+	executor.start(waiter(trace, flag, 0, result));
+	executor.run(1);
+	TEST_ASSERT_EQUAL(2, trace.count);
+	TEST_ASSERT_TRUE(result);
+}
+
+void test_until_timeout()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	bool flag = false;
+	bool result = true;
+	executor.start(waiter(trace, flag, 30, result));
+	runUntil(executor, 1, 30);
+	TEST_ASSERT_EQUAL(1, trace.count);
+	executor.run(31);
+	TEST_ASSERT_EQUAL(2, trace.count);
+	TEST_ASSERT_FALSE(result);
+	TEST_ASSERT_EQUAL(0, wheel.size());
+
+	// Met before the timeout, the timeout timer is cancelled
+	trace.count = 0;
+	result = false;
+	executor.start(waiter(trace, flag, 30, result));
+	executor.run(40);
+	flag = true;
+	executor.run(45);
+	TEST_ASSERT_EQUAL(2, trace.count);
+	TEST_ASSERT_TRUE(result);
+	TEST_ASSERT_EQUAL(0, wheel.size());
+}
+
+// An awaited task runs straight away and resumes its caller when it ends
+void test_await_task()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	executor.start(parent(trace));
+	executor.run(1);
+	TEST_ASSERT_EQUAL(1, trace.count);
+	TEST_ASSERT_EQUAL(2, asyncFramePool().size());
+
+	runUntil(executor, 2, 100);
+	TEST_ASSERT_EQUAL(5, trace.count);
+	TEST_ASSERT_EQUAL(11, trace.ticks[1]);
+	TEST_ASSERT_EQUAL(11, trace.ticks[2]);
+	TEST_ASSERT_EQUAL(21, trace.ticks[3]);
+	TEST_ASSERT_EQUAL(21, trace.ticks[4]);
+	TEST_ASSERT_EQUAL(0, executor.size());
+	TEST_ASSERT_EQUAL(0, asyncFramePool().size());
+}
+
+// sleep_ms(0) lets every other ready task run before it goes on, in the next run()
+void test_yield()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	int first = 0;
+	int second = 0;
+	executor.start(yielder(first));
+	executor.start(yielder(second));
+	executor.run(1);
+	TEST_ASSERT_EQUAL(1, first);
+	TEST_ASSERT_EQUAL(1, second);
+	executor.run(1);
+	TEST_ASSERT_EQUAL(2, first);
+	TEST_ASSERT_EQUAL(2, second);
+	executor.run(1);
+	executor.run(1);
+	TEST_ASSERT_EQUAL(3, first);
+	TEST_ASSERT_EQUAL(0, executor.size());
+}
+
+// A full pool gives invalid tasks instead of using the heap
+void test_frame_pool()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	uint32_t failed = asyncFramePool().failed();
+	for (size_t i = 0; i < asyncFramePool().capacity(); i++)
+	{
+		TEST_ASSERT_TRUE(executor.start(sleeper(trace, 10, 1)));
+	}
+	TEST_ASSERT_EQUAL(asyncFramePool().capacity(), asyncFramePool().size());
+
+	AsyncTask extra = sleeper(trace, 10, 1);
+	TEST_ASSERT_FALSE(extra.isValid());
+	TEST_ASSERT_FALSE(executor.start(std::move(extra)));
+	TEST_ASSERT_EQUAL(failed + 1, asyncFramePool().failed());
+	TEST_ASSERT_TRUE(asyncFramePool().largestFrame() <= asyncFramePool().frameSize());
+
+	// Frames go back to the pool as the tasks end
+	runUntil(executor, 1, 20);
+	TEST_ASSERT_EQUAL(0, executor.size());
+	TEST_ASSERT_EQUAL(0, asyncFramePool().size());
+	TEST_ASSERT_TRUE(executor.start(sleeper(trace, 10, 1)));
+	runUntil(executor, 21, 40);
+}
+
+// Awaiting a task that got no frame gives false instead of skipping it silently
+void test_await_invalid_task()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	Trace trace = {&wheel, {}, 0};
+	bool ran = false;
+	executor.start(checkedParent(trace, ran));
+	executor.run(1);
+	runUntil(executor, 2, 20);
+	TEST_ASSERT_TRUE(ran);
+	TEST_ASSERT_EQUAL(3, trace.count);
+
+	// The parent takes the last free frame, the child gets none
+	Trace sleeping = {&wheel, {}, 0};
+	while (asyncFramePool().size() < asyncFramePool().capacity() - 1)
+	{
+		executor.start(sleeper(sleeping, 100, 1));
+	}
+	trace.count = 0;
+	executor.start(checkedParent(trace, ran));
+	executor.run(21);
+	TEST_ASSERT_FALSE(ran);
+	TEST_ASSERT_EQUAL(1, trace.count); // The parent went on without the child
+
+	runUntil(executor, 22, 200);
+	TEST_ASSERT_EQUAL(0, asyncFramePool().size());
+}
+
+#ifndef ARDUINO
+// Each click resumes a task awaiting clicked() in a loop once
+void test_button_clicked_loop()
+{
+	TimerWheel<TimerWheelMillis> wheel(0);
+	AsyncExecutor executor(wheel);
+	AsyncButton button(5);
+	int clicks = 0;
+	executor.start(clickCounter(button, clicks));
+	runButton(executor, 5, HIGH, 1, 100);
+	TEST_ASSERT_EQUAL(0, clicks);
+
+	runButton(executor, 5, LOW, 101, 150); // Pressed past the debounce delay
+	runButton(executor, 5, HIGH, 151, 300);
+	TEST_ASSERT_EQUAL(1, clicks);
+
+	runButton(executor, 5, LOW, 901, 950); // After the click delay, a single click again
+	runButton(executor, 5, HIGH, 951, 1100);
+	TEST_ASSERT_EQUAL(2, clicks);
+	TEST_ASSERT_EQUAL(1, executor.size());
+}
+#endif
+
+// A task not started gives its frame back when it goes out of scope
+void test_task_not_started()
+{
+	Trace trace = {nullptr, {}, 0};
+	{
+		AsyncTask task = sleeper(trace, 10, 1);
+		TEST_ASSERT_TRUE(task.isValid());
+		TEST_ASSERT_EQUAL(1, asyncFramePool().size());
+	}
+	TEST_ASSERT_EQUAL(0, asyncFramePool().size());
+	TEST_ASSERT_EQUAL(0, trace.count);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_sleep);
+	RUN_TEST(test_sleep_late_run);
+	RUN_TEST(test_until);
+	RUN_TEST(test_until_ready);
+	RUN_TEST(test_until_timeout);
+	RUN_TEST(test_await_task);
+	RUN_TEST(test_yield);
+	RUN_TEST(test_frame_pool);
+	RUN_TEST(test_await_invalid_task);
+	RUN_TEST(test_task_not_started);
+#ifndef ARDUINO
+	RUN_TEST(test_button_clicked_loop);
+#endif
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
@@ -0,0 +1,347 @@
+// Formatting backend benchmark: afmt::format_to, vsnprintf, std::format_to_n and fmt::format_to
+//
+// pio test -e native -f test_benchmark
+// pio test -e esp32dev -f test_benchmark
+//
+// Prints ns/op, peak stack and heap allocations (operator new) per backend and workload, and checks
+// every backend produces the same text. For flash size build with a single backend, e.g.
+// -D BENCHMARK_BACKENDS=BENCHMARK_AFMT, and compare the program size the build reports.
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <format.h>
+
+#define BENCHMARK_AFMT (1 << 0)
+#define BENCHMARK_PRINTF (1 << 1)
+#define BENCHMARK_STD_FORMAT (1 << 2)
+#define BENCHMARK_FMT (1 << 3)
+
+#ifndef BENCHMARK_BACKENDS
+#define BENCHMARK_BACKENDS (BENCHMARK_AFMT | BENCHMARK_PRINTF | BENCHMARK_STD_FORMAT | BENCHMARK_FMT)
+#endif
+
+#ifndef BENCHMARK_ITERATIONS
+#ifdef ARDUINO
+#define BENCHMARK_ITERATIONS 2000
+#else
+#define BENCHMARK_ITERATIONS 100000
+#endif
+#endif
+
+#if (BENCHMARK_BACKENDS & BENCHMARK_STD_FORMAT) && __has_include(<format>)
+#include <format>
+#endif
+#if (BENCHMARK_BACKENDS & BENCHMARK_STD_FORMAT) && defined(__cpp_lib_format)
+#define HAS_STD_FORMAT 1
+#else
+#define HAS_STD_FORMAT 0
+#endif
+
+#if (BENCHMARK_BACKENDS & BENCHMARK_FMT) && __has_include(<fmt.h>)
+#include <fmt.h> // lib_deps = https://github.com/RileyCornelius/fmt-arduino.git
+#define HAS_FMT 1
+#else
+#define HAS_FMT 0
+#endif
+
+/*------------------------------------------------------------------------------
+ * MEASUREMENT
+ *----------------------------------------------------------------------------*/
+
+// Counts every operator new, a backend that allocates per call shows up here
+static volatile uint32_t allocations = 0;
+
+void *operator new(size_t size)
+{
+	allocations = allocations + 1;
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == nullptr)
+		abort();
+	return ptr;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+static uint64_t nowNanos()
+{
+#ifdef ARDUINO
+	return static_cast<uint64_t>(micros()) * 1000;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Stack high-water: paint an area below the caller with a pattern, run once from the same depth
+// and count how much of the pattern got overwritten
+static const size_t stackProbeSize = 4096;
+static const uint8_t stackPattern = 0xA5;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+
+__attribute__((noinline)) static void paintStack()
+{
+	volatile uint8_t area[stackProbeSize];
+	for (size_t i = 0; i < stackProbeSize; i++)
+		area[i] = stackPattern;
+}
+
+__attribute__((noinline)) static size_t measureStack()
+{
+	volatile uint8_t area[stackProbeSize];
+	size_t untouched = 0;
+	while (untouched < stackProbeSize && area[untouched] == stackPattern)
+		untouched++;
+	return stackProbeSize - untouched;
+}
+
+#pragma GCC diagnostic pop
+
+/*------------------------------------------------------------------------------
+ * BACKENDS
+ *----------------------------------------------------------------------------*/
+
+static char output[512];
+static char expected[512];
+
+typedef size_t (*BenchmarkFn)(char *out, size_t size);
+
+struct Backend
+{
+	const char *name;
+	BenchmarkFn fn;
+};
+
+static size_t printfTo(char *out, size_t size, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int written = vsnprintf(out, size, fmt, args);
+	va_end(args);
+	return written < 0 ? 0 : static_cast<size_t>(written);
+}
+
+template <typename... Args>
+static size_t afmtTo(char *out, size_t size, afmt::string_view fmt, const Args &...args)
+{
+	afmt::format_to_result result = afmt::format_to_n(out, size, fmt, args...);
+	return result.size;
+}
+
+#if HAS_STD_FORMAT
+template <typename... Args>
+static size_t stdTo(char *out, size_t size, std::format_string<Args...> fmt, Args &&...args)
+{
+	std::format_to_n_result<char *> result = std::format_to_n(out, size - 1, fmt, std::forward<Args>(args)...);
+	*result.out = '\0';
+	return static_cast<size_t>(result.size);
+}
+#endif
+
+#if HAS_FMT
+template <typename... Args>
+static size_t fmtTo(char *out, size_t size, fmt::format_string<Args...> fmt, Args &&...args)
+{
+	fmt::format_to_n_result<char *> result = fmt::format_to_n(out, size - 1, fmt, std::forward<Args>(args)...);
+	*result.out = '\0';
+	return result.size;
+}
+#endif
+
+// Declares one workload per backend from a brace format and the equivalent printf format
+#define BENCHMARK_BRACE(name, fmt, ...)                                                              \
+	static size_t name##Afmt(char *out, size_t size) { return afmtTo(out, size, fmt, __VA_ARGS__); }   \
+	static size_t name##Std(char *out, size_t size) { return STD_CALL(out, size, fmt, __VA_ARGS__); } \
+	static size_t name##Fmt(char *out, size_t size) { return FMT_CALL(out, size, fmt, __VA_ARGS__); }
+
+#if HAS_STD_FORMAT
+#define STD_CALL stdTo
+#else
+#define STD_CALL(out, size, ...) ((void)(out), (void)(size), 0)
+#endif
+
+#if HAS_FMT
+#define FMT_CALL fmtTo
+#else
+#define FMT_CALL(out, size, ...) ((void)(out), (void)(size), 0)
+#endif
+
+#define BENCHMARK_PRINTF_FN(name, fmt, ...) \
+	static size_t name##Printf(char *out, size_t size) { return printfTo(out, size, fmt, __VA_ARGS__); }
+
+static const char longText[] = "The quick brown fox jumps over the lazy dog while the sensor keeps sampling";
+
+BENCHMARK_BRACE(ints, "{} {} {} {:x} {:08}", 42, -12345, 4000000000u, 0xBEEF, 7)
+BENCHMARK_PRINTF_FN(ints, "%d %d %u %x %08d", 42, -12345, 4000000000u, 0xBEEF, 7)
+
+BENCHMARK_BRACE(floats, "{:.2f} {:.3f} {:.1f} {:.4f}", 3.14159, -2.5, 1234.56, 0.001)
+BENCHMARK_PRINTF_FN(floats, "%.2f %.3f %.1f %.4f", 3.14159, -2.5, 1234.56, 0.001)
+
+BENCHMARK_BRACE(table, "|{:<10}|{:>8}|{:>6}|{:08.3f}|", "sensor", 1234, "ok", 3.14159)
+BENCHMARK_PRINTF_FN(table, "|%-10s|%8d|%6s|%08.3f|", "sensor", 1234, "ok", 3.14159)
+
+BENCHMARK_BRACE(strings, "{} {} {} {}", "temperature", "humidity", "pressure", "altitude")
+BENCHMARK_PRINTF_FN(strings, "%s %s %s %s", "temperature", "humidity", "pressure", "altitude")
+
+BENCHMARK_BRACE(longLine, "[{:>8}] {:<12} {} | {} | {} {} {} {} | {:.2f} {:.2f} {:.2f} | {}", 123456, "main.cpp", longText, longText, 1, 22, 333, 4444, 1.5, 2.25, 3.75, "end")
+BENCHMARK_PRINTF_FN(longLine, "[%8d] %-12s %s | %s | %d %d %d %d | %.2f %.2f %.2f | %s", 123456, "main.cpp", longText, longText, 1, 22, 333, 4444, 1.5, 2.25, 3.75, "end")
+
+/*------------------------------------------------------------------------------
+ * RUNNER
+ *----------------------------------------------------------------------------*/
+
+static void report(const char *workload, const char *backend, uint64_t nanos, size_t stack, uint32_t heap)
+{
+	char line[128];
+	afmt::format_to(line, "{:<9} {:<18} {:>9.1f} ns/op {:>6} B stack {:>6.2f} allocs/op", workload, backend,
+					static_cast<double>(nanos) / BENCHMARK_ITERATIONS, stack, static_cast<double>(heap) / BENCHMARK_ITERATIONS);
+	TEST_MESSAGE(line);
+}
+
+static void runBenchmark(const char *workload, const Backend &backend)
+{
+	// Correctness against the first backend
+	memset(output, 0, sizeof(output));
+	backend.fn(output, sizeof(output));
+	if (expected[0] == '\0')
+		strcpy(expected, output);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, output, backend.name);
+
+	paintStack();
+	backend.fn(output, sizeof(output));
+	size_t stack = measureStack();
+
+	uint32_t allocationsBefore = allocations;
+	uint64_t start = nowNanos();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		backend.fn(output, sizeof(output));
+	}
+	uint64_t elapsed = nowNanos() - start;
+
+	report(workload, backend.name, elapsed, stack, allocations - allocationsBefore);
+}
+
+static void runWorkload(const char *workload, [[maybe_unused]] BenchmarkFn afmtFn, [[maybe_unused]] BenchmarkFn printfFn, [[maybe_unused]] BenchmarkFn stdFn, [[maybe_unused]] BenchmarkFn fmtFn)
+{
+	expected[0] = '\0';
+#if BENCHMARK_BACKENDS & BENCHMARK_AFMT
+	runBenchmark(workload, {"afmt::format_to", afmtFn});
+#endif
+#if BENCHMARK_BACKENDS & BENCHMARK_PRINTF
+	runBenchmark(workload, {"vsnprintf", printfFn});
+#endif
+#if HAS_STD_FORMAT
+	runBenchmark(workload, {"std::format_to_n", stdFn});
+#endif
+#if HAS_FMT
+	runBenchmark(workload, {"fmt::format_to", fmtFn});
+#endif
+}
+
+#define RUN_WORKLOAD(name) runWorkload(#name, name##Afmt, name##Printf, name##Std, name##Fmt)
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_benchmark_ints()
+{
+	RUN_WORKLOAD(ints);
+}
+
+void test_benchmark_floats()
+{
+	RUN_WORKLOAD(floats);
+}
+
+void test_benchmark_table()
+{
+	RUN_WORKLOAD(table);
+}
+
+void test_benchmark_strings()
+{
+	RUN_WORKLOAD(strings);
+}
+
+void test_benchmark_long_line()
+{
+	RUN_WORKLOAD(longLine);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_benchmark_ints);
+	RUN_TEST(test_benchmark_floats);
+	RUN_TEST(test_benchmark_table);
+	RUN_TEST(test_benchmark_strings);
+	RUN_TEST(test_benchmark_long_line);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
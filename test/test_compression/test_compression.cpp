@@ -0,0 +1,259 @@
+// Streaming LZ encoder and decoder round trips
+//
+// pio test -e native -f test_compression
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <stdio.h>
+#include <string>
+#include <Compression.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Pushes text through the encoder in chunks of pushSize, pulling pullSize at a time
+template <typename Encoder>
+static std::string compress(Encoder &encoder, const std::string &text, size_t pushSize = 64, size_t pullSize = 64, bool flush = true)
+{
+	std::string out;
+	uint8_t chunk[256];
+	size_t done = 0;
+	while (done < text.size())
+	{
+		size_t size = text.size() - done < pushSize ? text.size() - done : pushSize;
+		done += encoder.push(reinterpret_cast<const uint8_t *>(text.data()) + done, size);
+		size_t n;
+		while ((n = encoder.pull(chunk, pullSize)) > 0)
+		{
+			out.append(reinterpret_cast<char *>(chunk), n);
+		}
+	}
+	if (flush)
+	{
+		encoder.flush();
+		size_t n;
+		while ((n = encoder.pull(chunk, pullSize)) > 0)
+		{
+			out.append(reinterpret_cast<char *>(chunk), n);
+		}
+	}
+	return out;
+}
+
+template <typename Decoder>
+static std::string decompress(Decoder &decoder, const std::string &data, size_t pushSize = 64, size_t pullSize = 64)
+{
+	std::string out;
+	uint8_t chunk[256];
+	size_t done = 0;
+	do
+	{
+		size_t size = data.size() - done < pushSize ? data.size() - done : pushSize;
+		done += decoder.push(reinterpret_cast<const uint8_t *>(data.data()) + done, size);
+		size_t n;
+		while ((n = decoder.pull(chunk, pullSize)) > 0)
+		{
+			out.append(reinterpret_cast<char *>(chunk), n);
+		}
+	} while (done < data.size());
+	return out;
+}
+
+template <uint8_t WindowBits, uint8_t LookaheadBits>
+static std::string roundTrip(const std::string &text, size_t pushSize = 64, size_t pullSize = 64)
+{
+	static LzEncoder<WindowBits, LookaheadBits> encoder;
+	static LzDecoder<WindowBits, LookaheadBits> decoder;
+	encoder.reset();
+	decoder.reset();
+	return decompress(decoder, compress(encoder, text, pushSize, pullSize), pushSize, pullSize);
+}
+
+// Log lines with a counter and a value, alike but not equal
+static std::string logText(int lines)
+{
+	std::string text;
+	char line[96];
+	for (int i = 0; i < lines; i++)
+	{
+		snprintf(line, sizeof(line), "[%8d][I][MOTOR] rpm %d current %d.%03d state %s\n", i * 10, 1200 + i % 37, i % 4, (i * 7) % 1000,
+				 i % 5 == 0 ? "ramp" : "run");
+		text += line;
+	}
+	return text;
+}
+
+// Incompressible bytes from a fixed seed
+static std::string noise(size_t size)
+{
+	std::string text;
+	uint32_t state = 12345;
+	for (size_t i = 0; i < size; i++)
+	{
+		state = state * 1103515245u + 12345u;
+		text += static_cast<char>(state >> 24);
+	}
+	return text;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_empty()
+{
+	LzEncoder<8, 4> encoder;
+	TEST_ASSERT_EQUAL(0, compress(encoder, "").size());
+}
+
+void test_literals()
+{
+	LzEncoder<8, 4> encoder;
+	std::string data = compress(encoder, "ab");
+	// 1 'a', 1 'b', sync of 9 zero bits, padding: 18 + 9 bits in 4 bytes
+	TEST_ASSERT_EQUAL(4, data.size());
+	TEST_ASSERT_EQUAL_HEX8(0xB0, static_cast<uint8_t>(data[0]));
+	TEST_ASSERT_EQUAL_HEX8(0xD8, static_cast<uint8_t>(data[1]));
+	std::string back = roundTrip<8, 4>("ab");
+	TEST_ASSERT_EQUAL_STRING("ab", back.c_str());
+}
+
+void test_log_text()
+{
+	std::string text = logText(200);
+	LzEncoder<8, 4> encoder;
+	size_t size = compress(encoder, text).size();
+	TEST_ASSERT_TRUE(size < text.size() / 2);
+	TEST_ASSERT_TRUE((roundTrip<8, 4>(text) == text));
+}
+
+// A run copies from the bytes it is writing
+void test_runs()
+{
+	std::string text = std::string(1000, 'a') + "b" + std::string(300, '-') + "\n";
+	LzEncoder<8, 4> encoder;
+	TEST_ASSERT_TRUE(compress(encoder, text).size() < 200);
+	TEST_ASSERT_TRUE((roundTrip<8, 4>(text) == text));
+}
+
+// Noise grows by at most one bit per byte
+void test_noise()
+{
+	std::string text = noise(3000);
+	LzEncoder<8, 4> encoder;
+	TEST_ASSERT_TRUE(compress(encoder, text).size() <= text.size() * 9 / 8 + 4);
+	TEST_ASSERT_TRUE((roundTrip<8, 4>(text) == text));
+}
+
+// Push and pull sizes do not change the output
+void test_chunk_sizes()
+{
+	std::string text = logText(60) + noise(200) + logText(20);
+	LzEncoder<8, 4> encoder;
+	std::string whole = compress(encoder, text, 256, 256);
+	encoder.reset();
+	TEST_ASSERT_TRUE(compress(encoder, text, 1, 1) == whole);
+	encoder.reset();
+	TEST_ASSERT_TRUE(compress(encoder, text, 7, 3) == whole);
+
+	LzDecoder<8, 4> decoder;
+	TEST_ASSERT_TRUE(decompress(decoder, whole, 1, 1) == text);
+	decoder.reset();
+	TEST_ASSERT_TRUE(decompress(decoder, whole, 5, 200) == text);
+}
+
+// Everything pushed before a flush decodes, the window carries on after it
+void test_flush_syncs()
+{
+	LzEncoder<8, 4> encoder;
+	LzDecoder<8, 4> decoder;
+	std::string first = "first record\n";
+	std::string second = "second record, first record\n";
+
+	std::string data = compress(encoder, first);
+	TEST_ASSERT_TRUE(decompress(decoder, data) == first);
+
+	std::string more = compress(encoder, second);
+	TEST_ASSERT_TRUE(more.size() < second.size());
+	TEST_ASSERT_TRUE(decompress(decoder, more) == second);
+
+	// A second flush with nothing new adds nothing
+	encoder.flush();
+	uint8_t chunk[8];
+	TEST_ASSERT_EQUAL(0, encoder.pull(chunk, sizeof(chunk)));
+}
+
+// Without a flush the encoder keeps the lookahead, nothing is lost
+void test_holds_lookahead()
+{
+	LzEncoder<8, 4> encoder;
+	std::string data = compress(encoder, "0123456789", 64, 64, false);
+	TEST_ASSERT_EQUAL(0, data.size());
+	encoder.flush();
+	uint8_t chunk[32];
+	data.append(reinterpret_cast<char *>(chunk), encoder.pull(chunk, sizeof(chunk)));
+	LzDecoder<8, 4> decoder;
+	TEST_ASSERT_EQUAL_STRING("0123456789", decompress(decoder, data).c_str());
+}
+
+// Smallest and largest windows, across many buffer slides
+void test_window_sizes()
+{
+	std::string text = logText(100) + noise(500) + logText(100);
+	TEST_ASSERT_TRUE((roundTrip<4, 3>(text) == text));
+	TEST_ASSERT_TRUE((roundTrip<6, 3>(text) == text));
+#if !defined(__AVR__)
+	TEST_ASSERT_TRUE((roundTrip<10, 6>(text) == text));
+	TEST_ASSERT_TRUE((roundTrip<12, 8>(text) == text));
+#endif
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_empty);
+	RUN_TEST(test_literals);
+	RUN_TEST(test_log_text);
+	RUN_TEST(test_runs);
+	RUN_TEST(test_noise);
+	RUN_TEST(test_chunk_sizes);
+	RUN_TEST(test_flush_syncs);
+	RUN_TEST(test_holds_lookahead);
+	RUN_TEST(test_window_sizes);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
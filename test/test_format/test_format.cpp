@@ -4,6 +4,9 @@
 #include <unity.h>
 #include <Arduino.h>
 #include <format.h>
+#include <format_container.h>
+#include <format_hex.h>
+#include <Vector.h>
 
 #define HAS_CPP20 __cplusplus >= 202002L
 // cpp20
@@ -339,6 +342,254 @@ void test_format_complex()
 									 result.c_str(), "format complex");
 }
 
+/*------------------------------------------------------------------------------
+ * TESTS FOR format_to (sinks)
+ *----------------------------------------------------------------------------*/
+
+void test_format_to_string_sink()
+{
+	std::string out;
+	size_t written = afmt::format_to(out, "Temp: {:.1f}, Count: {}", 21.55, 7);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Temp: 21.6, Count: 7", out.c_str(), "std::string sink");
+	TEST_ASSERT_EQUAL_MESSAGE(out.size(), written, "std::string sink count");
+
+	// Appends to existing content
+	afmt::format_to(out, "!");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Temp: 21.6, Count: 7!", out.c_str(), "std::string sink append");
+}
+
+void test_format_to_sink_long_output()
+{
+	// Longer than the stream chunk so it is flushed several times
+	std::string expected;
+	for (int i = 0; i < 40; ++i)
+	{
+		expected += "0123456789";
+	}
+
+	std::string out;
+	size_t written = afmt::format_to(out, "[{}]", expected.c_str());
+	TEST_ASSERT_EQUAL_STRING_MESSAGE(("[" + expected + "]").c_str(), out.c_str(), "Long sink output");
+	TEST_ASSERT_EQUAL_MESSAGE(expected.size() + 2, written, "Long sink output count");
+
+	// Padded field wider than the chunk
+	out.clear();
+	afmt::format_to(out, "{:>300}", 1);
+	TEST_ASSERT_EQUAL_MESSAGE(300, out.size(), "Padded sink output size");
+	TEST_ASSERT_EQUAL_MESSAGE('1', out[299], "Padded sink output content");
+}
+
+static void append_to_string(void *context, const char *data, size_t size)
+{
+	static_cast<std::string *>(context)->append(data, size);
+}
+
+void test_format_to_callback_sink()
+{
+	std::string out;
+	afmt::callback_sink sink = {append_to_string, &out};
+	afmt::format_to(sink, "{}-{:#x}", "id", 255);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("id-0xff", out.c_str(), "Callback sink");
+}
+
+#if AFMT_HAS_ARDUINO
+class StringPrint : public Print
+{
+public:
+	std::string text;
+
+	size_t write(uint8_t c) override
+	{
+		text.push_back(static_cast<char>(c));
+		return 1;
+	}
+};
+
+void test_format_to_print_sink()
+{
+	StringPrint printer;
+	afmt::format_to(printer, "Pin {} = {:.2f}V", 13, 3.3);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Pin 13 = 3.30V", printer.text.c_str(), "Print sink");
+}
+#endif
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR formatter<T> and ranges
+ *----------------------------------------------------------------------------*/
+
+struct Point
+{
+	int x;
+	int y;
+};
+
+template <>
+struct afmt::formatter<Point>
+{
+	const char *parse(const char *begin, const char *)
+	{
+		return begin;
+	}
+
+	void format(const Point &p, afmt::buffer &out) const
+	{
+		afmt::format_to(out, "({}, {})", p.x, p.y);
+	}
+};
+
+// Reuses the built-in double spec
+struct Celsius
+{
+	double value;
+};
+
+template <>
+struct afmt::formatter<Celsius> : afmt::formatter<double>
+{
+	void format(const Celsius &c, afmt::buffer &out) const
+	{
+		afmt::formatter<double>::format(c.value, out);
+		out.push_back('C');
+	}
+};
+
+enum class ErrorCode
+{
+	none,
+	timeout,
+	overflow
+};
+
+void test_custom_formatter()
+{
+	char buffer[50];
+	afmt::format_to(buffer, "Point: {}", Point{3, -4});
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Point: (3, -4)", buffer, "Custom formatter");
+
+	afmt::format_to(buffer, "Temp: {:.1f} {1}", Celsius{21.55}, Celsius{-3});
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Temp: 21.6C -3C", buffer, "Custom formatter with spec");
+
+	std::string text = "hello";
+	afmt::format_to(buffer, "{:>7}|", text);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("  hello|", buffer, "std::string formatter");
+}
+
+void test_range_formatting()
+{
+	Vector<int> values;
+	values.push_back(1);
+	values.push_back(-2);
+	values.push_back(30);
+
+	std::string result = afmt::format("{}", values);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[1, -2, 30]", result.c_str(), "Vector default");
+
+	result = afmt::format("{::03}", values);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[001, -02, 030]", result.c_str(), "Vector element spec");
+
+	result = afmt::format("{:n:x}", values);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1, -2, 1e", result.c_str(), "Vector without brackets");
+
+	Vector<int> empty;
+	result = afmt::format("{}", empty);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[]", result.c_str(), "Empty vector");
+
+	Vector<Point> points;
+	points.push_back(Point{1, 2});
+	points.push_back(Point{3, 4});
+	result = afmt::format("{}", points);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[(1, 2), (3, 4)]", result.c_str(), "Vector of custom type");
+}
+
+void test_join_formatting()
+{
+	uint8_t mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x01};
+	std::string result = afmt::format("{:02X}", afmt::join(mac, ":"));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("DE:AD:BE:EF:00:01", result.c_str(), "Join array with spec");
+
+	double readings[] = {1.5, 2.24, 3.0};
+	result = afmt::format("{:.1f}", afmt::join(readings, readings + 2, " | "));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1.5 | 2.2", result.c_str(), "Join iterators");
+}
+
+void test_container_formatting()
+{
+	Optional<int> some(42);
+	Optional<int> none;
+	std::string result = afmt::format("{} {}", some, none);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("optional(42) none", result.c_str(), "Optional");
+
+	result = afmt::format("{:#x}", some);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("optional(0x2a)", result.c_str(), "Optional with spec");
+
+	Result<float, ErrorCode> ok(2.5f);
+	Result<float, ErrorCode> failed(ErrorCode::overflow);
+	result = afmt::format("{:.2f} {}", ok, failed);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("ok(2.50) error(2)", result.c_str(), "Result");
+}
+
+void test_fixed_point_formatting()
+{
+	// Q15.16: 1.5 and -2.25
+	std::string result = afmt::format("{} {} {:.2f}", afmt::q<16>(0x18000), afmt::q<16>(-0x24000), afmt::q<16>(205887));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1.5 -2.25 3.14", result.c_str(), "Q-format");
+
+	result = afmt::format("{:.3} {:+}", afmt::q<8>(1), afmt::q<0>(7));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("0.004 +7", result.c_str(), "Q-format precision");
+
+	// Scaled integers keep their decimals unless a precision is given
+	result = afmt::format("{} {} {:.1f} {:.4}", afmt::scaled(2340, 2), afmt::scaled(-5, 3), afmt::scaled(2399, 2), afmt::scaled(15, 1));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("23.40 -0.005 24.0 1.5000", result.c_str(), "scaled integer");
+
+	result = afmt::format("[{:>8}] [{:08}] [{:<7}]", afmt::scaled(-1234, 2), afmt::scaled(-1234, 2), afmt::q<16>(0x10000));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[  -12.34] [-0012.34] [1      ]", result.c_str(), "fixed-point padding");
+}
+
+void test_hex_formatting()
+{
+	const uint8_t packet[] = {0xDE, 0xAD, 0xBE, 0xEF, 0x01};
+	std::string result = afmt::format("{} {:X}", afmt::bytes(packet), afmt::bytes(packet, 2));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("deadbeef01 DEAD", result.c_str(), "byte span hex");
+
+	// Longer than one conversion chunk
+	uint8_t large[100];
+	for (int i = 0; i < 100; ++i)
+		large[i] = i;
+	result = afmt::format("{:x}", afmt::bytes(large));
+	TEST_ASSERT_EQUAL_MESSAGE(200, result.size(), "byte span hex length");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("616263", result.c_str() + 194, "byte span hex tail");
+}
+
+void test_hexdump()
+{
+	const char text[] = "Hello, world!\n";
+	std::string result = afmt::format("{:#x}", afmt::bytes(text, 14));
+	TEST_ASSERT_EQUAL_STRING_MESSAGE(
+		"00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a        |Hello, world!.|",
+		result.c_str(), "hexdump single line");
+
+	uint8_t data[20];
+	for (int i = 0; i < 20; ++i)
+		data[i] = 0x41 + i;
+	afmt::hexdump_options options;
+	options.bytes_per_line = 8;
+	options.group = 4;
+	options.ascii = false;
+	options.upper = true;
+	options.base_offset = 0x1000;
+	result.clear();
+	afmt::hexdump(result, afmt::bytes(data), options);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("00001000  41 42 43 44  45 46 47 48\n"
+									 "00001008  49 4A 4B 4C  4D 4E 4F 50\n"
+									 "00001010  51 52 53 54",
+									 result.c_str(), "hexdump options");
+
+	// 4 KB page in one call, 256 full lines of 78 chars
+	static uint8_t page[4096];
+	size_t size = afmt::formatted_size("{:#x}", afmt::bytes(page));
+	TEST_ASSERT_EQUAL_MESSAGE(256 * 79 - 1, size, "hexdump 4 KB size");
+}
+
 /*------------------------------------------------------------------------------
  * TESTS FOR formatted_size
  *----------------------------------------------------------------------------*/
@@ -356,6 +607,68 @@ void test_formatted_size_complex()
 	TEST_ASSERT_EQUAL_MESSAGE(actual.length(), size, "formatted_size complex");
 }
 
+void test_formatted_size_long_output()
+{
+	// Longer than the SBO storage, counted without allocating
+	size_t size = afmt::formatted_size("{:>500}|{}", "x", 12345);
+	TEST_ASSERT_EQUAL_MESSAGE(506, size, "formatted_size long output");
+}
+
+void test_format_to_n_reports_full_size()
+{
+	char buffer[8];
+	afmt::format_to_result result = afmt::format_to_n(buffer, sizeof(buffer), "Value: {}", 123456);
+	TEST_ASSERT_TRUE_MESSAGE(result.truncated, "format_to_n truncated");
+	TEST_ASSERT_EQUAL_MESSAGE(13, result.size, "format_to_n full size when truncated");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Value: ", buffer, "format_to_n truncated content");
+
+	result = afmt::format_to_n(buffer, sizeof(buffer), "{}", 42);
+	TEST_ASSERT_FALSE_MESSAGE(result.truncated, "format_to_n fits");
+	TEST_ASSERT_EQUAL_MESSAGE(2, result.size, "format_to_n size when not truncated");
+
+	result = afmt::format_to_n(buffer, 0, "{}", 42);
+	TEST_ASSERT_EQUAL_MESSAGE(2, result.size, "format_to_n size with zero capacity");
+}
+
+void test_buffer_pool()
+{
+	afmt::buffer_pool pool(256);
+
+	// First long line grows on the heap, the next ones reuse the warm storage
+	for (int i = 0; i < 3; ++i)
+	{
+		afmt::pooled_buffer pooled(pool);
+		afmt::format_to(pooled.get(), "{:>100}", i);
+		TEST_ASSERT_EQUAL_MESSAGE(100, pooled.get().size(), "pooled output");
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(3, pool.stats().acquired, "pool acquired");
+	TEST_ASSERT_EQUAL_MESSAGE(2, pool.stats().reused, "pool reused");
+	TEST_ASSERT_EQUAL_MESSAGE(1, pool.stats().allocations, "pool allocations");
+	TEST_ASSERT_EQUAL_MESSAGE(100, pool.stats().peak_size, "pool peak size");
+	TEST_ASSERT_TRUE_MESSAGE(pool.retained() >= 100, "pool retains storage");
+
+	// A buffer that is not empty turns the slot storage down, the slot keeps it
+	size_t retained = pool.retained();
+	{
+		afmt::buffer used;
+		afmt::format_to(used, "{}", 7);
+		int index = pool.acquire(used);
+		pool.release(used, index);
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(retained, pool.retained(), "pool keeps refused storage");
+
+	// Nested buffers take separate slots, storage over the limit is freed on release
+	{
+		afmt::pooled_buffer outer(pool);
+		afmt::pooled_buffer inner(pool);
+		afmt::format_to(inner.get(), "{:>300}", 1);
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(1, pool.stats().discarded, "pool discards large storage");
+
+	pool.shrink_to_fit();
+	TEST_ASSERT_EQUAL_MESSAGE(0, pool.retained(), "pool shrink_to_fit");
+}
+
 /*------------------------------------------------------------------------------
  * EDGE CASES AND ERROR HANDLING
  *----------------------------------------------------------------------------*/
@@ -383,6 +696,29 @@ void test_unmatched_braces()
 	TEST_ASSERT_EQUAL_STRING_MESSAGE("Unmatched }", buffer, "Unmatched closing brace");
 }
 
+void test_packed_argument_store()
+{
+	char buffer[128];
+	short s = -7;
+	uint8_t u8 = 200;
+	long l = -100000L;
+	std::string str = "str";
+
+	// Mixed widths, positional access reads past values of every size
+	afmt::format_to(buffer, "{7} {6} {5} {4} {3} {2} {1} {0}", 'c', true, 2.5, 1.5f, l, u8, s, str);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("str -7 200 -100000 1.5 2.5 true c", buffer, "packed mixed arguments");
+
+	afmt::format_to(buffer, "{} {} {} {} {} {} {} {}", 1, 2u, 3LL, "four", afmt::string_view("five"), 6, 7, 8);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1 2 3 four five 6 7 8", buffer, "packed eight arguments");
+
+	// Values take only the bytes their type needs
+	auto store = afmt::make_format_args(1, 'a', true);
+	TEST_ASSERT_EQUAL_MESSAGE(sizeof(int) + 2, decltype(store)::data_size, "packed data size");
+	TEST_ASSERT_TRUE_MESSAGE(sizeof(store) < 3 * sizeof(afmt::format_arg_value), "packed store smaller than array");
+	TEST_ASSERT_EQUAL_MESSAGE(afmt::format_arg_value::type::none_type, store.get_args().get(3).get_type(),
+							  "out of range argument");
+}
+
 /*------------------------------------------------------------------------------
 * TESTS FOR Arduino String functions
 *----------------------------------------------------------------------------*/
@@ -400,6 +736,29 @@ void test_aformat_complex()
 	TEST_ASSERT_EQUAL_STRING_MESSAGE("Pin: 13, Value: 1023, Voltage: 3.30V", result.c_str(),
 									 "aformat complex");
 }
+
+static const char flashFormat[] PROGMEM = "Pin {:>3} reads {:.1f}V {{{}}}";
+
+void test_flash_format_strings()
+{
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Hello, Arduino!", afmt::format(F("Hello, {}!"), "Arduino").c_str(), "F() format");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("Pin  13 reads 3.3V {ok}",
+									 afmt::format(reinterpret_cast<const __FlashStringHelper *>(flashFormat), 13, 3.3, "ok").c_str(),
+									 "PROGMEM format");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("a}b{c} 2 1", afmt::aformat(F("a}}b{{c}} {1} {0}"), 1, 2).c_str(), "Escapes and indexed fields");
+	int values[] = {1, 2, 3};
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1.2.3", afmt::format(F("{}"), afmt::join(values, ".")).c_str(), "Custom formatter field");
+
+	char out[8];
+	afmt::format_to_result result = afmt::format_to(out, F("{:08}"), 42);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("0000004", out, "Truncated to array");
+	TEST_ASSERT_EQUAL_MESSAGE(8, result.size, "Full size reported");
+	TEST_ASSERT_EQUAL_MESSAGE(6, afmt::formatted_size(F("{} + {}"), 1, 22), "formatted_size");
+
+	std::string sink;
+	afmt::format_to(sink, F("{:x}"), 255);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("ff", sink.c_str(), "Sink");
+}
 #endif
 
 /*------------------------------------------------------------------------------
@@ -683,19 +1042,43 @@ void tests()
 	RUN_TEST(test_format_floats);
 	RUN_TEST(test_format_complex);
 
+	// sink tests
+	RUN_TEST(test_format_to_string_sink);
+	RUN_TEST(test_format_to_sink_long_output);
+	RUN_TEST(test_format_to_callback_sink);
+#if AFMT_HAS_ARDUINO
+	RUN_TEST(test_format_to_print_sink);
+#endif
+
+	// formatter<T> and range tests
+	RUN_TEST(test_custom_formatter);
+	RUN_TEST(test_range_formatting);
+	RUN_TEST(test_join_formatting);
+	RUN_TEST(test_container_formatting);
+	RUN_TEST(test_fixed_point_formatting);
+	RUN_TEST(test_hex_formatting);
+	RUN_TEST(test_hexdump);
+
 	// formatted_size tests
 	RUN_TEST(test_formatted_size);
 	RUN_TEST(test_formatted_size_complex);
+	RUN_TEST(test_formatted_size_long_output);
+	RUN_TEST(test_format_to_n_reports_full_size);
+
+	// Buffer pool tests
+	RUN_TEST(test_buffer_pool);
 
 	// Edge cases
 	RUN_TEST(test_empty_format_string);
 	RUN_TEST(test_no_arguments);
 	RUN_TEST(test_unmatched_braces);
+	RUN_TEST(test_packed_argument_store);
 
 #if AFMT_HAS_ARDUINO
 	// Arduino-specific tests
 	RUN_TEST(test_aformat);
 	RUN_TEST(test_aformat_complex);
+	RUN_TEST(test_flash_format_strings);
 #endif
 
 	// Performance
@@ -0,0 +1,88 @@
+// Float formatting with AFMT_FLOAT_MODE_FIXED, the integer digit path used on targets without an FPU
+
+#include <unity.h>
+#include <Arduino.h>
+
+#define AFMT_FLOAT_MODE AFMT_FLOAT_MODE_FIXED
+#include <format.h>
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR FIXED FLOAT MODE
+ *----------------------------------------------------------------------------*/
+
+void test_fixed_mode_fixed_notation()
+{
+	std::string result = afmt::format("{:.2f} {:.3f} {:f} {:.0f}", 3.14159, -2.5, 10.0, 0.5);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("3.14 -2.500 10.00 1", result.c_str(), "fixed notation");
+
+	result = afmt::format("{:.2f} {:.1f}", 2.999, 1234567.25f);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("3.00 1234567.3", result.c_str(), "fixed notation rounding");
+}
+
+void test_fixed_mode_default_format()
+{
+	std::string result = afmt::format("{} {} {} {}", 3.14159265, 0.001234, 42.0, -0.5f);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("3.14159 0.001234 42 -0.5", result.c_str(), "default format");
+
+	result = afmt::format("{:g} {:.3g}", 123.456, 9.9999);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("123.456 10", result.c_str(), "general format");
+}
+
+void test_fixed_mode_precision_bound()
+{
+	// Digits past AFMT_FIXED_MAX_PRECISION are zeros
+	std::string result = afmt::format("{:.8f}", 1.123456789);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1.12345700", result.c_str(), "precision bound");
+}
+
+void test_fixed_mode_padding()
+{
+	std::string result = afmt::format("[{:8.2f}] [{:08.2f}] [{:<+7.1f}]", 3.14159, -3.14159, 2.0);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[    3.14] [-0003.14] [+2.0   ]", result.c_str(), "padding");
+}
+
+void test_fixed_mode_fallback()
+{
+	// Exponent notation and large values take the double path
+	std::string result = afmt::format("{:.2e} {} {:.1f}", 12345.0, 1e10, 5e9);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("1.23e+04 10000000000 5000000000.0", result.c_str(), "double fallback");
+
+	result = afmt::format("{} {:.2f}", 0.0, 0.0);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("0 0.00", result.c_str(), "zero");
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+	RUN_TEST(test_fixed_mode_fixed_notation);
+	RUN_TEST(test_fixed_mode_default_format);
+	RUN_TEST(test_fixed_mode_precision_bound);
+	RUN_TEST(test_fixed_mode_padding);
+	RUN_TEST(test_fixed_mode_fallback);
+}
+
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	UNITY_BEGIN();
+	tests();
+	UNITY_END();
+}
+
+void loop()
+{
+}
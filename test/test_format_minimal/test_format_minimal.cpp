@@ -0,0 +1,65 @@
+// Formatting with AFMT_PROFILE_MINIMAL, stripped features fall back instead of failing
+
+#include <unity.h>
+#include <Arduino.h>
+
+#define AFMT_PROFILE AFMT_PROFILE_MINIMAL
+#include <format.h>
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR MINIMAL PROFILE
+ *----------------------------------------------------------------------------*/
+
+void test_minimal_supported()
+{
+	std::string result = afmt::format("{} {:x} {:X} {:05} {:<4}| {:>4} {:.2f} {}", -42, 255, 255, 42, "ab", 'c', 3.14159, true);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("-42 ff FF 00042 ab  |    c 3.14 true", result.c_str(), "supported features");
+}
+
+void test_minimal_fallbacks()
+{
+	// Center aligns right, sign and '#' are ignored, binary and octal print decimal
+	std::string result = afmt::format("[{:^6}] {:+} {:#x} {:b} {:o}", "ab", 5, 255, 5, 8);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("[    ab] 5 ff 5 8", result.c_str(), "stripped features");
+}
+
+void test_minimal_floats()
+{
+	// Every float is fixed, {} and unknown types keep up to 6 decimals without trailing zeros
+	std::string result = afmt::format("{} {} {:e} {:g} {:.3f}", 3.14159265, 2.5, 1234.5, 0.001, -1.0);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("3.141593 2.5 1234.5 0.001 -1.000", result.c_str(), "fixed floats");
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+	RUN_TEST(test_minimal_supported);
+	RUN_TEST(test_minimal_fallbacks);
+	RUN_TEST(test_minimal_floats);
+}
+
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	UNITY_BEGIN();
+	tests();
+	UNITY_END();
+}
+
+void loop()
+{
+}
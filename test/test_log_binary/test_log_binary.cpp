@@ -0,0 +1,146 @@
+// Binary log records and the host decoder used by tools/logdecode. Records are encoded in this
+// process and decoded with the string table of its own executable.
+//
+// pio test -e native -f test_log_binary
+
+#include <unity.h>
+#include <string>
+#include <LogDecoder.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+static LogStringTable table;
+static bool tableLoaded = false;
+static uint8_t record[logbin::maxRecordSize];
+
+template <typename... Args>
+static std::string roundTrip(LogDecoder::Time time, const char *format, const Args &...args)
+{
+	size_t size = logbin::writeRecord(record, sizeof(record), 1234567, format, args...);
+	LogDecoder decoder(table, time);
+	std::string out;
+	TEST_ASSERT_TRUE(decoder.decodeRecord(record, size, out));
+	return out;
+}
+
+template <typename... Args>
+static std::string roundTrip(const char *format, const Args &...args)
+{
+	return roundTrip(LogDecoder::Time::None, format, args...);
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_string_table_loaded()
+{
+	TEST_ASSERT_TRUE_MESSAGE(tableLoaded, "Test executable has a string table");
+	TEST_ASSERT_EQUAL_STRING("[INFO] ready\r\n", table.string(logbin::relativeAddress("[INFO] ready\r\n")));
+	TEST_ASSERT_NULL(table.string(0x7FFFFFF0));
+}
+
+void test_numbers()
+{
+	TEST_ASSERT_EQUAL_STRING("-5 7 -1099511627776 18446744073709551615",
+							 roundTrip("{} {} {} {}", -5, 7u, -(1LL << 40), 18446744073709551615ULL).c_str());
+	TEST_ASSERT_EQUAL_STRING("3.14 2.5 0x1f", roundTrip("{:.2f} {} {:#x}", 3.14159, 2.5f, (uint8_t)31).c_str());
+	TEST_ASSERT_EQUAL_STRING("true x  -3", roundTrip("{} {} {:>3}", true, 'x', (int16_t)-3).c_str());
+}
+
+void test_strings()
+{
+	char runtime[16];
+	strcpy(runtime, "runtime");
+	std::string owned = "owned";
+	TEST_ASSERT_EQUAL_STRING("[runtime][owned][WIFI]", roundTrip("[{}][{}][{}]", runtime, owned, logbin::StringRef{"WIFI"}).c_str());
+	TEST_ASSERT_EQUAL_STRING("[LoggerTest:42]", roundTrip("[{}:42]", logbin::FileRef{"src/Tests/LoggerTest.cpp"}).c_str());
+}
+
+void test_timestamp()
+{
+	TEST_ASSERT_EQUAL_STRING("[    1234.567]hi", roundTrip(LogDecoder::Time::Millis, "hi").c_str());
+	TEST_ASSERT_EQUAL_STRING("[    1234567]hi", roundTrip(LogDecoder::Time::Micros, "hi").c_str());
+}
+
+// Arguments past the record capacity are sent as missing, a long string is cut to fit
+void test_truncated_arguments()
+{
+	char longText[64];
+	memset(longText, 'a', sizeof(longText) - 1);
+	longText[sizeof(longText) - 1] = '\0';
+
+	size_t size = logbin::writeRecord(record, 32, 0, "{}|{}", longText, 99);
+	TEST_ASSERT_EQUAL(32, size);
+	LogDecoder decoder(table, LogDecoder::Time::None);
+	std::string out;
+	TEST_ASSERT_TRUE(decoder.decodeRecord(record, size, out));
+	TEST_ASSERT_EQUAL_STRING((std::string(32 - 13, 'a') + "|?").c_str(), out.c_str());
+}
+
+// Text around records, such as boot messages, passes through while records arrive a byte at a time
+void test_stream_with_text()
+{
+	std::string stream = "boot\n";
+	size_t size = logbin::writeRecord(record, sizeof(record), 0, "[I] count={}\n", 3);
+	stream.append(reinterpret_cast<const char *>(record), size);
+	stream += "\xB1\x02 raw text\n"; // A sync byte that does not start a record
+	size = logbin::writeRecord(record, sizeof(record), 0, "[W] {}\n", "done");
+	stream.append(reinterpret_cast<const char *>(record), size);
+
+	LogDecoder decoder(table, LogDecoder::Time::None);
+	std::string out;
+	for (char c : stream)
+	{
+		decoder.feed(reinterpret_cast<const uint8_t *>(&c), 1, out);
+	}
+	TEST_ASSERT_EQUAL_STRING("boot\n[I] count=3\n\xB1\x02 raw text\n[W] done\n", out.c_str());
+	TEST_ASSERT_EQUAL(2, decoder.decoded());
+	TEST_ASSERT_EQUAL(1, decoder.invalid());
+}
+
+void test_smaller_than_text()
+{
+	const char *format = "[INFO][{}][{}:87] Connected in {} ms, rssi {} dBm, ip {}.{}.{}.{}\r\n";
+	size_t binary = logbin::writeRecord(record, sizeof(record), 0, format, "WIFI", logbin::FileRef{"src/Tests/LoggerTest.cpp"}, 1532, -67, 192, 168, 1, 42);
+	std::string text = roundTrip(format, "WIFI", logbin::FileRef{"src/Tests/LoggerTest.cpp"}, 1532, -67, 192, 168, 1, 42);
+
+	char message[64];
+	snprintf(message, sizeof(message), "binary %u bytes, text %u bytes", (unsigned)binary, (unsigned)text.size());
+	TEST_MESSAGE(message);
+	TEST_ASSERT_LESS_THAN(text.size(), binary);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	tableLoaded = table.load("/proc/self/exe");
+
+	UNITY_BEGIN();
+	RUN_TEST(test_string_table_loaded);
+	RUN_TEST(test_numbers);
+	RUN_TEST(test_strings);
+	RUN_TEST(test_timestamp);
+	RUN_TEST(test_truncated_arguments);
+	RUN_TEST(test_stream_with_text);
+	RUN_TEST(test_smaller_than_text);
+	return UNITY_END();
+}
+
+int main()
+{
+	return tests();
+}
@@ -0,0 +1,265 @@
+// Block buffered file sink, on POSIX files in /tmp
+//
+// pio test -e native -f test_log_file
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <LogFile.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Levels as in logger.h
+const uint8_t error = 1;
+const uint8_t warning = 2;
+const uint8_t info = 3;
+
+typedef LogFileSink<256> Sink;
+
+static char path[48];
+
+static std::string rotated(int index)
+{
+	return index == 0 ? std::string(path) : std::string(path) + "." + std::to_string(index);
+}
+
+static void removeAll()
+{
+	for (int i = 0; i < 8; i++)
+	{
+		unlink(rotated(i).c_str());
+	}
+}
+
+static long fileSize(const std::string &name)
+{
+	struct stat info;
+	return stat(name.c_str(), &info) == 0 ? static_cast<long>(info.st_size) : -1;
+}
+
+static std::string readFile(const std::string &name)
+{
+	std::string text;
+	FILE *file = fopen(name.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return text;
+	}
+	char chunk[256];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		text.append(chunk, n);
+	}
+	fclose(file);
+	return text;
+}
+
+static void writeText(Sink &sink, uint8_t level, const char *text)
+{
+	sink.write(level, text, strlen(text));
+}
+
+// A 32 byte record numbered i
+static void writeLine(Sink &sink, uint8_t level, int i)
+{
+	char line[33];
+	snprintf(line, sizeof(line), "record %04d .................. \n", i);
+	sink.write(level, line, 32);
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_buffers_until_block_full()
+{
+	Sink sink(path);
+	sink.setFlushInterval(0);
+	TEST_ASSERT_TRUE(sink.begin());
+	for (int i = 0; i < 7; i++)
+	{
+		writeLine(sink, info, i);
+	}
+	TEST_ASSERT_EQUAL(0, fileSize(path));
+	TEST_ASSERT_EQUAL(224, sink.buffered());
+
+	writeLine(sink, info, 7);
+	TEST_ASSERT_EQUAL(256, fileSize(path));
+	TEST_ASSERT_EQUAL(0, sink.buffered());
+	TEST_ASSERT_EQUAL(1, sink.fileWrites());
+}
+
+// After a partial flush the next write ends on the block boundary
+void test_writes_stay_aligned()
+{
+	Sink sink(path);
+	sink.setFlushInterval(0);
+	sink.begin();
+	writeText(sink, info, "0123456789");
+	sink.flush();
+	TEST_ASSERT_EQUAL(10, fileSize(path));
+
+	for (int i = 0; i < 8; i++)
+	{
+		writeLine(sink, info, i);
+	}
+	TEST_ASSERT_EQUAL(256, fileSize(path));
+	TEST_ASSERT_EQUAL(10, sink.buffered());
+	TEST_ASSERT_EQUAL(2, sink.fileWrites());
+}
+
+// Appends to the file left from before, aligned to its size
+void test_appends_existing_file()
+{
+	{
+		Sink sink(path);
+		sink.begin();
+		writeText(sink, info, "first\n");
+	}
+	Sink sink(path);
+	sink.setFlushInterval(0);
+	sink.begin();
+	TEST_ASSERT_EQUAL(6, sink.size());
+	for (int i = 0; i < 8; i++)
+	{
+		writeLine(sink, info, i);
+	}
+	TEST_ASSERT_EQUAL(256, fileSize(path));
+	TEST_ASSERT_EQUAL(0, readFile(path).compare(0, 18, "first\nrecord 0000 "));
+}
+
+void test_flush_on_level()
+{
+	Sink sink(path);
+	sink.setFlushLevel(warning);
+	sink.setFlushInterval(0);
+	sink.begin();
+	writeText(sink, info, "info\n");
+	TEST_ASSERT_EQUAL(0, fileSize(path));
+	writeText(sink, warning, "warn\n");
+	TEST_ASSERT_EQUAL_STRING("info\nwarn\n", readFile(path).c_str());
+
+	sink.setFlushLevel(0);
+	writeText(sink, error, "error\n");
+	TEST_ASSERT_EQUAL(6, sink.buffered());
+}
+
+void test_flush_on_timer()
+{
+	Sink sink(path);
+	sink.setFlushLevel(0);
+	sink.setFlushInterval(5000);
+	sink.begin();
+	writeText(sink, info, "waiting\n");
+	uint32_t start = Sink::now();
+	sink.update(start + 4000);
+	TEST_ASSERT_EQUAL(0, fileSize(path));
+	sink.update(start + 6000);
+	TEST_ASSERT_EQUAL_STRING("waiting\n", readFile(path).c_str());
+
+	sink.update(start + 20000);
+	TEST_ASSERT_EQUAL(1, sink.fileWrites());
+}
+
+// A record longer than the block goes out in whole blocks, the rest stays buffered
+void test_record_longer_than_block()
+{
+	Sink sink(path);
+	sink.setFlushInterval(0);
+	sink.begin();
+	std::string text(600, 'x');
+	sink.write(info, text.c_str(), text.size());
+	TEST_ASSERT_EQUAL(512, fileSize(path));
+	TEST_ASSERT_EQUAL(88, sink.buffered());
+	sink.flush();
+	TEST_ASSERT_TRUE(readFile(path) == text);
+}
+
+void test_rotation()
+{
+	Sink sink(path);
+	sink.setRotation(512, 3);
+	sink.setFlushInterval(0);
+	sink.begin();
+	for (int i = 0; i < 64; i++)
+	{
+		writeLine(sink, info, i);
+	}
+	sink.flush();
+
+	// 16 records per file: 0-15 were dropped with the oldest file, 16-31 in .2, 32-47 in .1
+	TEST_ASSERT_EQUAL(512, fileSize(rotated(0)));
+	TEST_ASSERT_EQUAL(512, fileSize(rotated(1)));
+	TEST_ASSERT_EQUAL(512, fileSize(rotated(2)));
+	TEST_ASSERT_EQUAL(-1, fileSize(rotated(3)));
+	TEST_ASSERT_EQUAL(0, readFile(rotated(2)).compare(0, 12, "record 0016 "));
+	TEST_ASSERT_EQUAL(0, readFile(rotated(1)).compare(0, 12, "record 0032 "));
+	TEST_ASSERT_EQUAL(0, readFile(rotated(0)).compare(0, 12, "record 0048 "));
+}
+
+// One file starts over
+void test_rotation_single_file()
+{
+	Sink sink(path);
+	sink.setRotation(256, 1);
+	sink.setFlushInterval(0);
+	sink.begin();
+	for (int i = 0; i < 9; i++)
+	{
+		writeLine(sink, info, i);
+	}
+	sink.flush();
+	TEST_ASSERT_EQUAL(-1, fileSize(rotated(1)));
+	TEST_ASSERT_EQUAL(0, readFile(path).compare(0, 12, "record 0008 "));
+	TEST_ASSERT_EQUAL(32, fileSize(path));
+}
+
+void test_drops_before_begin()
+{
+	Sink sink(path);
+	writeText(sink, error, "lost\n");
+	TEST_ASSERT_EQUAL(5, sink.droppedBytes());
+	TEST_ASSERT_EQUAL(-1, fileSize(path));
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+	removeAll();
+}
+
+void tearDown(void)
+{
+	removeAll();
+}
+
+int tests()
+{
+	snprintf(path, sizeof(path), "/tmp/test_log_file_%d.txt", static_cast<int>(getpid()));
+
+	UNITY_BEGIN();
+	RUN_TEST(test_buffers_until_block_full);
+	RUN_TEST(test_writes_stay_aligned);
+	RUN_TEST(test_appends_existing_file);
+	RUN_TEST(test_flush_on_level);
+	RUN_TEST(test_flush_on_timer);
+	RUN_TEST(test_record_longer_than_block);
+	RUN_TEST(test_rotation);
+	RUN_TEST(test_rotation_single_file);
+	RUN_TEST(test_drops_before_begin);
+	return UNITY_END();
+}
+
+int main()
+{
+	return tests();
+}
@@ -0,0 +1,311 @@
+// Flight recorder kept across resets. A memory mapped file stands in for the no-init RAM, it is
+// unmapped and mapped again to play a reset.
+//
+// pio test -e native -f test_log_flight
+
+#include <unity.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string>
+#include <LogFlight.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+static const size_t memorySize = 1024;
+static char path[64];
+static int fd = -1;
+static void *memory = nullptr;
+
+// Maps the file as the board would see its no-init RAM after a reset
+static void *boot()
+{
+	memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	TEST_ASSERT_TRUE(memory != MAP_FAILED);
+	return memory;
+}
+
+static void reset()
+{
+	munmap(memory, memorySize);
+	memory = nullptr;
+}
+
+static void powerOn()
+{
+	uint8_t garbage[memorySize];
+	for (size_t i = 0; i < memorySize; i++)
+	{
+		garbage[i] = static_cast<uint8_t>(i * 73 + 11);
+	}
+	TEST_ASSERT_EQUAL(memorySize, pwrite(fd, garbage, memorySize, 0));
+}
+
+static void writeText(LogFlightRecorder &recorder, uint8_t level, const char *text)
+{
+	recorder.write(level, text, strlen(text));
+}
+
+static std::string collect(const LogFlightRecorder &recorder, uint8_t maxLevel = 5, size_t last = static_cast<size_t>(-1))
+{
+	std::string out;
+	recorder.forEach([&out](const LogFlightRecord &record)
+					 { out.append(record.text, record.size); },
+					 maxLevel, last);
+	return out;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_power_on_starts_empty()
+{
+	powerOn();
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_FALSE(recorder.begin());
+	TEST_ASSERT_EQUAL(1, recorder.boots());
+	TEST_ASSERT_EQUAL(0, recorder.used());
+	TEST_ASSERT_EQUAL_STRING("", collect(recorder).c_str());
+	reset();
+}
+
+void test_survives_reset()
+{
+	powerOn();
+	{
+		LogFlightRecorder recorder(boot(), memorySize);
+		recorder.begin();
+		writeText(recorder, 3, "[I] boot;");
+		writeText(recorder, 1, "[E] sensor;");
+		writeText(recorder, 2, "[W] heap low;");
+		reset();
+	}
+
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_TRUE(recorder.begin());
+	TEST_ASSERT_EQUAL(2, recorder.boots());
+	TEST_ASSERT_EQUAL_STRING("[I] boot;[E] sensor;[W] heap low;", collect(recorder).c_str());
+	writeText(recorder, 3, "[I] second boot;"); // Appends after the recovered records
+	TEST_ASSERT_EQUAL_STRING("[E] sensor;[W] heap low;[I] second boot;", collect(recorder, 5, 3).c_str());
+	reset();
+}
+
+// "The last 2 records at warning and above"
+void test_query_by_level()
+{
+	powerOn();
+	LogFlightRecorder recorder(boot(), memorySize);
+	recorder.begin();
+	writeText(recorder, 1, "e1;");
+	writeText(recorder, 3, "i1;");
+	writeText(recorder, 2, "w1;");
+	writeText(recorder, 5, "v1;");
+	writeText(recorder, 1, "e2;");
+
+	TEST_ASSERT_EQUAL_STRING("w1;e2;", collect(recorder, 2, 2).c_str());
+	TEST_ASSERT_EQUAL_STRING("e1;e2;", collect(recorder, 1).c_str());
+
+	std::string boots;
+	size_t count = recorder.forEach([&boots](const LogFlightRecord &record)
+									{ boots += static_cast<char>('0' + record.boot); });
+	TEST_ASSERT_EQUAL(5, count);
+	TEST_ASSERT_EQUAL_STRING("11111", boots.c_str());
+	reset();
+}
+
+// Old records make room, the ring keeps the newest whole records across the wrap
+void test_wraps_and_keeps_latest()
+{
+	powerOn();
+	{
+		LogFlightRecorder recorder(boot(), memorySize);
+		recorder.begin();
+		char text[32];
+		for (int i = 0; i < 500; i++)
+		{
+			snprintf(text, sizeof(text), "record %03d;", i);
+			writeText(recorder, 3, text);
+		}
+		reset();
+	}
+
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_TRUE(recorder.begin());
+	std::string all = collect(recorder);
+	TEST_ASSERT_EQUAL_STRING("record 497;record 498;record 499;", collect(recorder, 5, 3).c_str());
+	TEST_ASSERT_TRUE(all.find("record 000") == std::string::npos);
+	TEST_ASSERT_EQUAL(0, all.size() % strlen("record 000;"));
+	TEST_ASSERT_TRUE(recorder.used() <= memorySize);
+	reset();
+}
+
+// A reset in the middle of a write loses only that record
+void test_torn_write()
+{
+	powerOn();
+	{
+		LogFlightRecorder recorder(boot(), memorySize);
+		recorder.begin();
+		writeText(recorder, 1, "kept;");
+		uint8_t *bytes = static_cast<uint8_t *>(memory);
+		uint8_t before[memorySize];
+		memcpy(before, bytes, memorySize);
+		writeText(recorder, 1, "torn;");
+		memcpy(bytes, before, 28); // The control block as it was before the write was counted
+		reset();
+	}
+
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_TRUE(recorder.begin());
+	TEST_ASSERT_EQUAL_STRING("kept;", collect(recorder).c_str());
+	reset();
+}
+
+// A damaged record header ends the recovered records, the ones before it are kept
+void test_corrupt_record()
+{
+	powerOn();
+	{
+		LogFlightRecorder recorder(boot(), memorySize);
+		recorder.begin();
+		writeText(recorder, 1, "first;");
+		writeText(recorder, 1, "second;");
+		writeText(recorder, 1, "third;");
+		static_cast<uint8_t *>(memory)[28 + 10 + 6 + 4] ^= 0x40; // Size of the second record
+		reset();
+	}
+
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_TRUE(recorder.begin());
+	TEST_ASSERT_EQUAL_STRING("first;", collect(recorder).c_str());
+	writeText(recorder, 1, "after;");
+	TEST_ASSERT_EQUAL_STRING("first;after;", collect(recorder).c_str());
+	reset();
+}
+
+// A damaged control block starts over
+void test_corrupt_control()
+{
+	powerOn();
+	{
+		LogFlightRecorder recorder(boot(), memorySize);
+		recorder.begin();
+		writeText(recorder, 1, "lost;");
+		static_cast<uint8_t *>(memory)[8] ^= 0x01; // Boots
+		reset();
+	}
+
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_FALSE(recorder.begin());
+	TEST_ASSERT_EQUAL(1, recorder.boots());
+	TEST_ASSERT_EQUAL_STRING("", collect(recorder).c_str());
+	reset();
+}
+
+// The CRC covers the text, a changed byte in it ends the recovered records too
+void test_corrupt_text()
+{
+	powerOn();
+	{
+		LogFlightRecorder recorder(boot(), memorySize);
+		recorder.begin();
+		writeText(recorder, 1, "first;");
+		writeText(recorder, 1, "second;");
+		static_cast<uint8_t *>(memory)[28 + 10 + 6 + 10 + 2] ^= 0x01; // "second" turns to "sedond"
+		reset();
+	}
+
+	LogFlightRecorder recorder(boot(), memorySize);
+	TEST_ASSERT_TRUE(recorder.begin());
+	TEST_ASSERT_EQUAL_STRING("first;", collect(recorder).c_str());
+	reset();
+}
+
+// Below LOG_FLIGHT_MIN_SIZE the recorder is off and leaves the memory alone
+void test_too_small()
+{
+	uint32_t small[8];
+	memset(small, 0xA5, sizeof(small));
+	LogFlightRecorder recorder(small, sizeof(small));
+	TEST_ASSERT_FALSE(recorder.begin());
+	TEST_ASSERT_EQUAL(0, recorder.maxRecord());
+	writeText(recorder, 1, "dropped;");
+	TEST_ASSERT_EQUAL(0, recorder.used());
+	TEST_ASSERT_EQUAL_STRING("", collect(recorder).c_str());
+	for (size_t i = 0; i < 8; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT32(0xA5A5A5A5, small[i]);
+	}
+
+	// The smallest buffer used still takes records
+	uint32_t smallest[LOG_FLIGHT_MIN_SIZE / 4];
+	LogFlightRecorder minimal(smallest, sizeof(smallest));
+	minimal.begin();
+	for (int i = 0; i < 20; i++)
+	{
+		writeText(minimal, 1, "0123456789;");
+	}
+	TEST_ASSERT_TRUE(minimal.used() <= sizeof(smallest) - 28);
+	TEST_ASSERT_TRUE(collect(minimal).size() > 0);
+}
+
+void test_long_record_cut()
+{
+	powerOn();
+	LogFlightRecorder recorder(boot(), memorySize);
+	recorder.begin();
+	char text[600];
+	memset(text, 'x', sizeof(text));
+	recorder.write(1, text, sizeof(text));
+	TEST_ASSERT_EQUAL(recorder.maxRecord(), collect(recorder).size());
+	reset();
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	snprintf(path, sizeof(path), "/tmp/test_log_flight_%d", static_cast<int>(getpid()));
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0 || ftruncate(fd, memorySize) != 0)
+	{
+		return 1;
+	}
+
+	UNITY_BEGIN();
+	RUN_TEST(test_power_on_starts_empty);
+	RUN_TEST(test_survives_reset);
+	RUN_TEST(test_query_by_level);
+	RUN_TEST(test_wraps_and_keeps_latest);
+	RUN_TEST(test_torn_write);
+	RUN_TEST(test_corrupt_record);
+	RUN_TEST(test_corrupt_control);
+	RUN_TEST(test_corrupt_text);
+	RUN_TEST(test_too_small);
+	RUN_TEST(test_long_record_cut);
+	int result = UNITY_END();
+
+	close(fd);
+	unlink(path);
+	return result;
+}
+
+int main()
+{
+	return tests();
+}
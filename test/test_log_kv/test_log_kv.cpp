@@ -0,0 +1,199 @@
+// Key-value record encoders behind LOG_KV, JSON Lines and CBOR
+//
+// pio test -e native -f test_log_kv
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <string>
+#include <LogKv.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Levels as in logger.h
+const uint8_t warning = 2;
+const uint8_t info = 3;
+
+struct Output
+{
+	std::string text;
+
+	void write(const char *data, size_t size) { text.append(data, size); }
+	void push_back(char c) { text.push_back(c); }
+};
+
+enum class Mode : uint8_t
+{
+	Idle,
+	Run = 7,
+};
+
+// Same as LOG_KV expands to, without the logger
+#define KEY(encoding, key) encoding::Key<encoding::keySize(key)>(key)
+
+static std::string hex(const std::string &bytes)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string out;
+	for (char c : bytes)
+	{
+		out += digits[static_cast<uint8_t>(c) >> 4];
+		out += digits[static_cast<uint8_t>(c) & 15];
+	}
+	return out;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_json_record()
+{
+	Output out;
+	logkv::json::begin(out, 3, "ms", 1234, warning, "MOTOR", "stall");
+	logkv::json::field(out, KEY(logkv::json, "rpm"), 1200);
+	logkv::json::field(out, KEY(logkv::json, "amps"), 3.25);
+	logkv::json::field(out, KEY(logkv::json, "ok"), false);
+	logkv::json::end(out);
+	TEST_ASSERT_EQUAL_STRING("{\"ms\":1234,\"lvl\":\"warn\",\"tag\":\"MOTOR\",\"ev\":\"stall\",\"rpm\":1200,\"amps\":3.25,\"ok\":false}\n",
+							 out.text.c_str());
+}
+
+void test_json_without_time()
+{
+	Output out;
+	logkv::json::begin(out, 0, info, "WIFI", "up");
+	logkv::json::end(out);
+	TEST_ASSERT_EQUAL_STRING("{\"lvl\":\"info\",\"tag\":\"WIFI\",\"ev\":\"up\"}\n", out.text.c_str());
+}
+
+// Keys are escaped when the key text is built, values as they are written
+void test_json_escapes()
+{
+	constexpr logkv::json::Key<logkv::json::keySize("a\"b\\c")> key("a\"b\\c");
+	static_assert(sizeof(key.text) == 11, "Escaped at compile time");
+	TEST_ASSERT_EQUAL_STRING(",\"a\\\"b\\\\c\":", std::string(key.text, sizeof(key.text)).c_str());
+
+	Output out;
+	logkv::json::value(out, "line\n\"quoted\"\t\x01 end");
+	TEST_ASSERT_EQUAL_STRING("\"line\\n\\\"quoted\\\"\\t\\u0001 end\"", out.text.c_str());
+}
+
+void test_json_values()
+{
+	Output out;
+	const char *missing = nullptr;
+	std::string owned = "owned";
+	logkv::json::value(out, -42);
+	out.push_back(' ');
+	logkv::json::value(out, 18446744073709551615ULL);
+	out.push_back(' ');
+	logkv::json::value(out, static_cast<uint8_t>(200));
+	out.push_back(' ');
+	logkv::json::value(out, Mode::Run);
+	out.push_back(' ');
+	logkv::json::value(out, 'x');
+	out.push_back(' ');
+	logkv::json::value(out, true);
+	out.push_back(' ');
+	logkv::json::value(out, missing);
+	out.push_back(' ');
+	logkv::json::value(out, owned);
+	out.push_back(' ');
+	logkv::json::value(out, 0.5f);
+	TEST_ASSERT_EQUAL_STRING("-42 18446744073709551615 200 7 \"x\" true null \"owned\" 0.5", out.text.c_str());
+}
+
+// JSON has no NaN or infinity
+void test_json_not_a_number()
+{
+	Output out;
+	logkv::json::value(out, 0.0 / 0.0);
+	out.push_back(' ');
+	logkv::json::value(out, 1.0 / 0.0);
+	TEST_ASSERT_EQUAL_STRING("null null", out.text.c_str());
+}
+
+// {"ms": 1234, "lvl": "warn", "tag": "MOTOR", "ev": "stall", "rpm": 1200, "d": -1.5, "ok": true, "n": null}
+void test_cbor_record()
+{
+	Output out;
+	logkv::cbor::begin(out, 4, "ms", 1234, warning, "MOTOR", "stall");
+	logkv::cbor::field(out, KEY(logkv::cbor, "rpm"), 1200);
+	logkv::cbor::field(out, KEY(logkv::cbor, "d"), -1.5);
+	logkv::cbor::field(out, KEY(logkv::cbor, "ok"), true);
+	logkv::cbor::field(out, KEY(logkv::cbor, "n"), nullptr);
+	logkv::cbor::end(out);
+	TEST_ASSERT_EQUAL_STRING("a8"
+							 "626d73" "1904d2"
+							 "636c766c" "647761726e"
+							 "63746167" "654d4f544f52"
+							 "626576" "657374616c6c"
+							 "6372706d" "1904b0"
+							 "6164" "fbbff8000000000000"
+							 "626f6b" "f5"
+							 "616e" "f6",
+							 hex(out.text).c_str());
+}
+
+void test_cbor_integers()
+{
+	Output out;
+	logkv::cbor::value(out, 0);
+	logkv::cbor::value(out, 23);
+	logkv::cbor::value(out, 24);
+	logkv::cbor::value(out, -1);
+	logkv::cbor::value(out, -500);
+	logkv::cbor::value(out, 70000u);
+	logkv::cbor::value(out, 4294967296LL);
+	logkv::cbor::value(out, 2.5f);
+	TEST_ASSERT_EQUAL_STRING("00" "17" "1818" "20" "3901f3" "1a00011170" "1b0000000100000000" "fa40200000", hex(out.text).c_str());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_json_record);
+	RUN_TEST(test_json_without_time);
+	RUN_TEST(test_json_escapes);
+	RUN_TEST(test_json_values);
+	RUN_TEST(test_json_not_a_number);
+	RUN_TEST(test_cbor_record);
+	RUN_TEST(test_cbor_integers);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
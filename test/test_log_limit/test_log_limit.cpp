@@ -0,0 +1,316 @@
+// Call site limits and deduplication behind LOG_EVERY_N, LOG_EVERY_MS, LOG_ONCE, LOG_RATE_LIMITED
+// and LOG_DEDUP
+//
+// pio test -e native -f test_log_limit
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <string.h>
+#include <LogLimit.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Stand-ins for the Logger.cpp side
+static LogSite *sites = nullptr;
+static LogRateTable<4> rates;
+static uint32_t now = 0;
+
+namespace _logger
+{
+	void addSite(LogSite &site)
+	{
+		site.next = sites;
+		sites = &site;
+		site.listed = true;
+	}
+
+	bool rateAllow(uint32_t tagHash, uint32_t perSecond)
+	{
+		return rates.allow(tagHash, perSecond, now);
+	}
+}
+
+static int countSites()
+{
+	int count = 0;
+	for (LogSite *site = sites; site != nullptr; site = site->next)
+	{
+		count++;
+	}
+	return count;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_every_n()
+{
+	static LogEveryN site(__FILE__, __LINE__);
+	int passed = 0;
+	for (int i = 0; i < 10; i++)
+	{
+		passed += site.ready(4) ? 1 : 0; // Calls 0, 4 and 8
+	}
+	TEST_ASSERT_EQUAL(3, passed);
+	TEST_ASSERT_EQUAL(7, site.suppressed);
+	TEST_ASSERT_TRUE(site.listed);
+}
+
+void test_every_ms()
+{
+	static LogEveryMs site(__FILE__, __LINE__);
+	TEST_ASSERT_TRUE(site.ready(100, 5000)); // First call always passes
+	TEST_ASSERT_FALSE(site.ready(100, 5050));
+	TEST_ASSERT_FALSE(site.ready(100, 5099));
+	TEST_ASSERT_TRUE(site.ready(100, 5100));
+	TEST_ASSERT_TRUE(site.ready(100, 40)); // Across a millis() wrap
+	TEST_ASSERT_EQUAL(2, site.suppressed);
+}
+
+void test_once()
+{
+	static LogOnce site(__FILE__, __LINE__);
+	TEST_ASSERT_TRUE(site.ready());
+	TEST_ASSERT_FALSE(site.ready());
+	TEST_ASSERT_FALSE(site.ready());
+	TEST_ASSERT_EQUAL(2, site.suppressed);
+}
+
+// Sites of one tag share a bucket, it starts full and refills at the rate
+void test_rate_limited()
+{
+	static LogRateLimited siteA(__FILE__, __LINE__);
+	static LogRateLimited siteB(__FILE__, __LINE__);
+	const uint32_t motor = 0x1234;
+	now = 1000;
+
+	int passed = 0;
+	for (int i = 0; i < 10; i++)
+	{
+		passed += siteA.ready(motor, 4) ? 1 : 0;
+		passed += siteB.ready(motor, 4) ? 1 : 0;
+	}
+	TEST_ASSERT_EQUAL(4, passed);
+	TEST_ASSERT_EQUAL(16, siteA.suppressed + siteB.suppressed);
+
+	now += 250; // One token
+	TEST_ASSERT_TRUE(siteA.ready(motor, 4));
+	TEST_ASSERT_FALSE(siteB.ready(motor, 4));
+
+	now += 60000; // A long pause refills one second worth only
+	passed = 0;
+	for (int i = 0; i < 10; i++)
+	{
+		passed += siteA.ready(motor, 4) ? 1 : 0;
+	}
+	TEST_ASSERT_EQUAL(4, passed);
+
+	TEST_ASSERT_TRUE(siteA.ready(0x9999, 4)); // Other tags have their own bucket
+}
+
+// Once every slot is taken, new tags are let through
+void test_rate_table_full()
+{
+	LogRateTable<2> table;
+	TEST_ASSERT_TRUE(table.allow(1, 1, 0));
+	TEST_ASSERT_TRUE(table.allow(2, 1, 0));
+	TEST_ASSERT_FALSE(table.allow(1, 1, 0));
+	TEST_ASSERT_TRUE(table.allow(3, 1, 0));
+	TEST_ASSERT_TRUE(table.allow(3, 1, 0));
+}
+
+// 0 and 1 both pass every call
+void test_every_n_zero()
+{
+	static LogEveryN site(__FILE__, __LINE__);
+	for (int i = 0; i < 3; i++)
+	{
+		TEST_ASSERT_TRUE(site.ready(0));
+		TEST_ASSERT_TRUE(site.ready(1));
+	}
+	TEST_ASSERT_EQUAL(0, site.suppressed);
+}
+
+// The gates end in an else, so an else after the gated statement belongs to the enclosing if
+void test_gates_in_if_else()
+{
+	int gated = 0;
+	int otherwise = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (i < 2)
+			_IF_LOG_EVERY_N(2) gated++;
+		else
+			otherwise++;
+	}
+	TEST_ASSERT_EQUAL(1, gated);
+	TEST_ASSERT_EQUAL(2, otherwise);
+
+	gated = 0;
+	otherwise = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (i % 2 == 0)
+			_IF_LOG_ONCE() gated++;
+		else
+			otherwise++;
+	}
+	TEST_ASSERT_EQUAL(1, gated);
+	TEST_ASSERT_EQUAL(2, otherwise);
+
+	gated = 0;
+	for (uint32_t ms = 0; ms < 250; ms += 10)
+	{
+		if (ms < 200)
+			_IF_LOG_EVERY_MS(100, ms) gated++;
+		else
+			otherwise++;
+	}
+	TEST_ASSERT_EQUAL(2, gated);
+	TEST_ASSERT_EQUAL(7, otherwise);
+
+	now = 500000;
+	gated = 0;
+	otherwise = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (i < 3)
+			_IF_LOG_RATE_LIMITED(0x5678, 2) gated++;
+		else
+			otherwise++;
+	}
+	TEST_ASSERT_EQUAL(2, gated);
+	TEST_ASSERT_EQUAL(1, otherwise);
+}
+
+// A site is listed once, however often it suppresses
+void test_sites_listed_once()
+{
+	TEST_ASSERT_EQUAL(9, countSites());
+}
+
+void test_dedup()
+{
+	LogDedup dedup;
+	const char *a = "[ERROR] same\n";
+	const char *b = "[ERROR] other\n";
+	uint32_t hashA = LogDedup::hashRecord(a, strlen(a));
+	uint32_t hashB = LogDedup::hashRecord(b, strlen(b));
+
+	TEST_ASSERT_FALSE(dedup.repeat(hashA, a, strlen(a))); // Nothing remembered yet
+	dedup.remember(1, hashA, a, strlen(a));
+	TEST_ASSERT_TRUE(dedup.repeat(hashA, a, strlen(a)));
+	TEST_ASSERT_TRUE(dedup.repeat(hashA, a, strlen(a)));
+	TEST_ASSERT_FALSE(dedup.repeat(hashB, b, strlen(b)));
+
+	uint8_t level = 0;
+	TEST_ASSERT_EQUAL(2, dedup.takeRepeats(level));
+	TEST_ASSERT_EQUAL(1, level);
+	TEST_ASSERT_EQUAL(0, dedup.takeRepeats(level));
+}
+
+// A record with the hash and size of the last one but other text is not a repeat
+void test_dedup_hash_collision()
+{
+	LogDedup dedup;
+	const char *a = "[ERROR] same\n";
+	const char *b = "[ERROR] sane\n";
+	dedup.remember(1, 0x1234, a, strlen(a));
+	TEST_ASSERT_FALSE(dedup.repeat(0x1234, b, strlen(b)));
+	TEST_ASSERT_TRUE(dedup.repeat(0x1234, a, strlen(a)));
+}
+
+// The timestamp is left out so records differing only in time are repeats
+void test_dedup_skips_time()
+{
+	const char *first = "[    1234]same";
+	const char *second = "[    5678]same";
+	TEST_ASSERT_TRUE(LogDedup::hashRecord(first, 14) != LogDedup::hashRecord(second, 14));
+	TEST_ASSERT_EQUAL(LogDedup::hashRecord(first, 14, 0, 10), LogDedup::hashRecord(second, 14, 0, 10));
+	TEST_ASSERT_EQUAL(LogDedup::hashRecord("same", 4), LogDedup::hashRecord(first, 14, 0, 10));
+}
+
+// Only a leveled record starts with its time, brackets in LOG_PRINTF text are compared
+void test_dedup_time_end()
+{
+	const char *timed = "[    1234][INFO] slot[1] ok\n";
+	const char *colored = "\033[0;32m[    1234][INFO] ok\n";
+	TEST_ASSERT_EQUAL(10, LogDedup::timeEnd(3, timed, strlen(timed)));
+	TEST_ASSERT_EQUAL(17, LogDedup::timeEnd(3, colored, strlen(colored)));
+	TEST_ASSERT_EQUAL(0, LogDedup::timeEnd(0, timed, strlen(timed)));
+	TEST_ASSERT_EQUAL(0, LogDedup::timeEnd(3, "no time\n", 8));
+
+	// Distinct bracketed LOG_PRINTF lines are all written
+	LogDedup dedup;
+	char line[16];
+	int written = 0;
+	for (int i = 1; i <= 3; i++)
+	{
+		size_t size = snprintf(line, sizeof(line), "slot[%d] ok\n", i);
+		size_t end = LogDedup::timeEnd(0, line, size);
+		uint32_t hash = LogDedup::hashRecord(line, size, 0, end);
+		if (!dedup.repeat(hash, line + end, size - end))
+		{
+			dedup.remember(0, hash, line + end, size - end);
+			written++;
+		}
+	}
+	TEST_ASSERT_EQUAL(3, written);
+	uint8_t level;
+	TEST_ASSERT_EQUAL(0, dedup.takeRepeats(level));
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_every_n);
+	RUN_TEST(test_every_ms);
+	RUN_TEST(test_once);
+	RUN_TEST(test_every_n_zero);
+	RUN_TEST(test_gates_in_if_else);
+	RUN_TEST(test_rate_limited);
+	RUN_TEST(test_rate_table_full);
+	RUN_TEST(test_sites_listed_once);
+	RUN_TEST(test_dedup);
+	RUN_TEST(test_dedup_hash_collision);
+	RUN_TEST(test_dedup_skips_time);
+	RUN_TEST(test_dedup_time_end);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
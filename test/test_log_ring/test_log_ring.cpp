@@ -0,0 +1,294 @@
+// Lock-free log ring used by LOG_MODE_ASYNC
+//
+// pio test -e native -f test_log_ring
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <LogRing.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+static char drained[8192];
+
+template <size_t N>
+static bool pushText(LogRing<N> &ring, const char *text, bool overwrite = false)
+{
+	return ring.push(text, strlen(text), overwrite);
+}
+
+template <size_t N>
+static const char *drainText(LogRing<N> &ring)
+{
+	size_t size = ring.drain(drained, sizeof(drained) - 1);
+	drained[size] = '\0';
+	return drained;
+}
+
+// Record "<producer>:<sequence>:<checksum>;" so a torn record is detected
+static int makeRecord(char *out, int producer, int sequence)
+{
+	return snprintf(out, 32, "%d:%d:%d;", producer, sequence, (producer * 7919 + sequence * 31) % 1000);
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_push_and_drain()
+{
+	LogRing<256> ring;
+	TEST_ASSERT_TRUE(ring.empty());
+	TEST_ASSERT_TRUE(pushText(ring, "first "));
+	TEST_ASSERT_TRUE(pushText(ring, "second "));
+	TEST_ASSERT_TRUE(pushText(ring, "third"));
+	TEST_ASSERT_EQUAL_STRING("first second third", drainText(ring));
+	TEST_ASSERT_TRUE(ring.empty());
+	TEST_ASSERT_EQUAL_STRING("", drainText(ring));
+	TEST_ASSERT_EQUAL(3, ring.stats().pushed);
+}
+
+void test_drain_in_batches()
+{
+	LogRing<256> ring;
+	pushText(ring, "aaaa");
+	pushText(ring, "bbbb");
+	pushText(ring, "cccc");
+
+	char batch[9];
+	size_t size = ring.drain(batch, 8); // Whole records only
+	TEST_ASSERT_EQUAL(8, size);
+	TEST_ASSERT_EQUAL_MEMORY("aaaabbbb", batch, 8);
+	size = ring.drain(batch, 8);
+	TEST_ASSERT_EQUAL(4, size);
+	TEST_ASSERT_EQUAL_MEMORY("cccc", batch, 4);
+}
+
+void test_drop_when_full()
+{
+	LogRing<64> ring; // Two 32 byte records fill it
+	TEST_ASSERT_TRUE(pushText(ring, "0123456789abcdefghij"));
+	TEST_ASSERT_TRUE(pushText(ring, "0123456789ABCDEFGHIJ"));
+	TEST_ASSERT_FALSE(pushText(ring, "dropped"));
+	TEST_ASSERT_FALSE(ring.tryPush("waiting", 7)); // Not counted
+	TEST_ASSERT_EQUAL(1, ring.stats().dropped);
+	TEST_ASSERT_EQUAL_STRING("0123456789abcdefghij0123456789ABCDEFGHIJ", drainText(ring));
+	TEST_ASSERT_TRUE(pushText(ring, "fits again"));
+}
+
+void test_overwrite_oldest()
+{
+	LogRing<64> ring;
+	pushText(ring, "0123456789abcdefghij", true);
+	pushText(ring, "0123456789ABCDEFGHIJ", true);
+	TEST_ASSERT_TRUE(pushText(ring, "newest", true));
+	LogRingStats stats = ring.stats();
+	TEST_ASSERT_EQUAL(1, stats.overwritten);
+	TEST_ASSERT_EQUAL(0, stats.dropped);
+	TEST_ASSERT_EQUAL_STRING("0123456789ABCDEFGHIJnewest", drainText(ring));
+}
+
+void test_wrap_around()
+{
+	LogRing<128> ring;
+	char record[32];
+	char expected[32];
+	for (int i = 0; i < 500; i++)
+	{
+		int len = makeRecord(record, i % 3, i);
+		TEST_ASSERT_TRUE(ring.push(record, len));
+		memcpy(expected, record, len + 1);
+		TEST_ASSERT_EQUAL_STRING(expected, drainText(ring));
+	}
+	TEST_ASSERT_LESS_OR_EQUAL(128, ring.stats().peak);
+}
+
+void test_long_record_truncated()
+{
+	LogRing<128> ring;
+	char record[200];
+	memset(record, 'x', sizeof(record));
+	TEST_ASSERT_TRUE(ring.push(record, sizeof(record)));
+	TEST_ASSERT_EQUAL(LogRing<128>::maxRecord, strlen(drainText(ring)));
+}
+
+// Records come out one at a time with the tag they were pushed with
+void test_pop_with_tag()
+{
+	LogRing<256> ring;
+	ring.push("error", 5, false, 1);
+	ring.push("info", 4, false, 3);
+
+	char record[16];
+	uint8_t tag = 0;
+	size_t size = ring.pop(record, sizeof(record), tag);
+	TEST_ASSERT_EQUAL(5, size);
+	TEST_ASSERT_EQUAL_MEMORY("error", record, 5);
+	TEST_ASSERT_EQUAL(1, tag);
+	size = ring.pop(record, 3, tag); // Truncated like drain()
+	TEST_ASSERT_EQUAL(3, size);
+	TEST_ASSERT_EQUAL_MEMORY("inf", record, 3);
+	TEST_ASSERT_EQUAL(3, tag);
+	TEST_ASSERT_EQUAL(0, ring.pop(record, sizeof(record), tag));
+	TEST_ASSERT_TRUE(ring.empty());
+}
+
+// Producers wait and retry while a consumer drains concurrently, nothing may be lost or reordered
+void test_multi_producer_blocking()
+{
+	static LogRing<1024> ring;
+	const int producers = 4;
+	const int perProducer = 2000;
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++)
+	{
+		threads.emplace_back([p]
+							 {
+			char record[32];
+			for (int i = 0; i < perProducer; i++)
+			{
+				int len = makeRecord(record, p, i);
+				while (!ring.tryPush(record, len))
+				{
+					std::this_thread::yield();
+				}
+			} });
+	}
+
+	int next[producers] = {0};
+	int received = 0;
+	bool ordered = true;
+	char batch[256];
+	while (received < producers * perProducer)
+	{
+		size_t size = ring.drain(batch, sizeof(batch) - 1);
+		batch[size] = '\0';
+		for (char *record = strtok(batch, ";"); record != nullptr; record = strtok(nullptr, ";"))
+		{
+			int p, i, sum;
+			sscanf(record, "%d:%d:%d", &p, &i, &sum);
+			ordered = ordered && next[p] == i && sum == (p * 7919 + i * 31) % 1000;
+			next[p] = i + 1;
+			received++;
+		}
+	}
+	for (std::thread &t : threads)
+	{
+		t.join();
+	}
+
+	TEST_ASSERT_TRUE_MESSAGE(ordered, "Records in order per producer and intact");
+	TEST_ASSERT_EQUAL(producers * perProducer, received);
+	TEST_ASSERT_TRUE(ring.empty());
+}
+
+// Overwriting producers race the consumer, every record it gets must still be intact
+void test_multi_producer_overwrite()
+{
+	static LogRing<256> ring;
+	const int producers = 4;
+	const int perProducer = 5000;
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++)
+	{
+		threads.emplace_back([p]
+							 {
+			char record[32];
+			for (int i = 0; i < perProducer; i++)
+			{
+				int len = makeRecord(record, p, i);
+				ring.push(record, len, true);
+			} });
+	}
+
+	int received = 0;
+	bool intact = true;
+	char batch[256];
+	auto consume = [&]
+	{
+		size_t size = ring.drain(batch, sizeof(batch) - 1);
+		batch[size] = '\0';
+		for (char *record = strtok(batch, ";"); record != nullptr; record = strtok(nullptr, ";"))
+		{
+			int p = -1, i = -1, sum = -1;
+			intact = intact && sscanf(record, "%d:%d:%d", &p, &i, &sum) == 3 && sum == (p * 7919 + i * 31) % 1000;
+			received++;
+		}
+		return size;
+	};
+
+	for (int spin = 0; spin < 20000; spin++)
+	{
+		consume();
+	}
+	for (std::thread &t : threads)
+	{
+		t.join();
+	}
+	while (consume() > 0)
+	{
+	}
+
+	LogRingStats stats = ring.stats();
+	TEST_ASSERT_TRUE_MESSAGE(intact, "No torn records");
+	TEST_ASSERT_EQUAL(producers * perProducer, stats.pushed + stats.dropped); // Dropped only while the oldest record was mid-write
+	TEST_ASSERT_EQUAL(stats.pushed, received + stats.overwritten);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_push_and_drain);
+	RUN_TEST(test_drain_in_batches);
+	RUN_TEST(test_drop_when_full);
+	RUN_TEST(test_overwrite_oldest);
+	RUN_TEST(test_wrap_around);
+	RUN_TEST(test_long_record_truncated);
+	RUN_TEST(test_pop_with_tag);
+
+	// Concurrency
+	RUN_TEST(test_multi_producer_blocking);
+	RUN_TEST(test_multi_producer_overwrite);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
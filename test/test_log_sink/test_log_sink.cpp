@@ -0,0 +1,221 @@
+// Log sinks used by LOG_SINKS_ENABLE
+//
+// pio test -e native -f test_log_sink
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <string.h>
+#include <string>
+#include <LogSink.h>
+#include <LogCompress.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Levels as in logger.h
+const uint8_t error = 1;
+const uint8_t warning = 2;
+const uint8_t info = 3;
+const uint8_t verbose = 5;
+
+struct Capture
+{
+	std::string text;
+	const char *lastData = nullptr;
+	uint8_t lastLevel = 0;
+	int writes = 0;
+};
+
+static void capture(uint8_t level, const char *data, size_t size, void *context)
+{
+	Capture *c = static_cast<Capture *>(context);
+	c->text.append(data, size);
+	c->lastData = data;
+	c->lastLevel = level;
+	c->writes++;
+}
+
+static void writeText(LogSinkList<4> &sinks, uint8_t level, const char *text)
+{
+	sinks.write(level, text, strlen(text));
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+// Every sink gets the same formatted buffer, nothing is formatted or copied per sink
+void test_format_once()
+{
+	Capture a, b;
+	LogCallbackSink sinkA(capture, &a);
+	LogCallbackSink sinkB(capture, &b);
+	LogSinkList<4> sinks;
+	TEST_ASSERT_TRUE(sinks.add(sinkA));
+	TEST_ASSERT_TRUE(sinks.add(sinkB));
+
+	const char *record = "[INFO] ready\n";
+	writeText(sinks, info, record);
+	TEST_ASSERT_TRUE(a.lastData == record);
+	TEST_ASSERT_TRUE(b.lastData == record);
+	TEST_ASSERT_EQUAL(info, a.lastLevel);
+	TEST_ASSERT_EQUAL_STRING(record, b.text.c_str());
+}
+
+void test_per_sink_level()
+{
+	Capture all, errors;
+	LogCallbackSink allSink(capture, &all);
+	LogCallbackSink errorSink(capture, &errors, error);
+	LogSinkList<4> sinks;
+	sinks.add(allSink);
+	sinks.add(errorSink);
+
+	writeText(sinks, info, "i");
+	writeText(sinks, warning, "w");
+	writeText(sinks, error, "e");
+	TEST_ASSERT_EQUAL_STRING("iwe", all.text.c_str());
+	TEST_ASSERT_EQUAL_STRING("e", errors.text.c_str());
+
+	errorSink.setLevel(warning);
+	writeText(sinks, warning, "w");
+	TEST_ASSERT_EQUAL_STRING("ew", errors.text.c_str());
+	TEST_ASSERT_EQUAL(warning, errorSink.getLevel());
+}
+
+// LOG_PRINTF records have level 0 and reach a sink at any level
+void test_level_zero_reaches_all()
+{
+	Capture c;
+	LogCallbackSink sink(capture, &c, error);
+	LogSinkList<4> sinks;
+	sinks.add(sink);
+	writeText(sinks, 0, "plain");
+	TEST_ASSERT_EQUAL_STRING("plain", c.text.c_str());
+}
+
+void test_add_and_remove()
+{
+	Capture c;
+	LogCallbackSink sinks[5] = {{capture, &c}, {capture, &c}, {capture, &c}, {capture, &c}, {capture, &c}};
+	LogSinkList<4> list;
+	for (int i = 0; i < 4; i++)
+	{
+		TEST_ASSERT_TRUE(list.add(sinks[i]));
+	}
+	TEST_ASSERT_FALSE(list.add(sinks[4])); // Full
+	TEST_ASSERT_FALSE(list.add(sinks[0])); // Already registered
+
+	list.remove(sinks[1]);
+	TEST_ASSERT_TRUE(list.add(sinks[4])); // Takes the free slot
+	writeText(list, info, "x");
+	TEST_ASSERT_EQUAL(4, c.writes);
+
+	list.remove(sinks[0]);
+	list.remove(sinks[0]); // Removing twice is harmless
+	writeText(list, info, "x");
+	TEST_ASSERT_EQUAL(7, c.writes);
+}
+
+// The RAM sink keeps the latest records and drops the oldest whole records
+void test_ring_sink_keeps_latest()
+{
+	LogRingSink<64> ring(warning);
+	LogSinkList<4> sinks;
+	sinks.add(ring);
+	writeText(sinks, error, "0123456789abcdefghij");
+	writeText(sinks, info, "ignored");
+	writeText(sinks, warning, "0123456789ABCDEFGHIJ");
+	writeText(sinks, error, "last");
+
+	char out[64];
+	size_t size = ring.read(out, sizeof(out) - 1);
+	out[size] = '\0';
+	TEST_ASSERT_EQUAL_STRING("0123456789ABCDEFGHIJlast", out);
+	TEST_ASSERT_EQUAL(1, ring.stats().overwritten);
+	TEST_ASSERT_EQUAL(0, ring.used());
+}
+
+// The compressed stage syncs on errors, the next sink gets bytes that decode up to that record
+void test_compress_sink()
+{
+	Capture c;
+	LogCallbackSink next(capture, &c);
+	LogCompressSink<8, 4> compressed(next);
+	LogSinkList<4> sinks;
+	sinks.add(compressed);
+	std::string records;
+	for (int i = 0; i < 20; i++)
+	{
+		std::string record = "[I][MOTOR] rpm " + std::to_string(1200 + i % 3) + " state run\n";
+		writeText(sinks, info, record.c_str());
+		records += record;
+	}
+	writeText(sinks, error, "[E][MOTOR] stall\n");
+	records += "[E][MOTOR] stall\n";
+	TEST_ASSERT_EQUAL(0, c.lastLevel);
+	TEST_ASSERT_EQUAL(records.size(), compressed.recordBytes());
+	TEST_ASSERT_EQUAL(c.text.size(), compressed.compressedBytes());
+	TEST_ASSERT_TRUE(c.text.size() < records.size() / 3);
+
+	LzDecoder<8, 4> decoder;
+	std::string decoded;
+	uint8_t chunk[64];
+	for (size_t done = 0; done < c.text.size();)
+	{
+		done += decoder.push(reinterpret_cast<const uint8_t *>(c.text.data()) + done, c.text.size() - done);
+		size_t size;
+		while ((size = decoder.pull(chunk, sizeof(chunk))) > 0)
+		{
+			decoded.append(reinterpret_cast<char *>(chunk), size);
+		}
+	}
+	TEST_ASSERT_TRUE(decoded == records);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_format_once);
+	RUN_TEST(test_per_sink_level);
+	RUN_TEST(test_level_zero_reaches_all);
+	RUN_TEST(test_add_and_remove);
+	RUN_TEST(test_ring_sink_keeps_latest);
+	RUN_TEST(test_compress_sink);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
@@ -0,0 +1,174 @@
+// Counters behind LOG_STATS_ENABLE
+//
+// pio test -e native -f test_log_stats
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <LogStats.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+// Levels as in logger.h
+const uint8_t print = 0;
+const uint8_t error = 1;
+const uint8_t info = 3;
+
+// Hashes chosen to land in the same slot of the 8 slot table
+const uint32_t motor = 0x11;
+const uint32_t wifi = 0x21;
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_starts_empty()
+{
+	LogStats stats = {};
+	TEST_ASSERT_EQUAL(0, stats.totalRecords());
+	TEST_ASSERT_EQUAL(0, stats.totalBytes());
+	TEST_ASSERT_NULL(stats.findTag(motor));
+}
+
+void test_counts_per_level()
+{
+	LogStats stats = {};
+	stats.count(info, 20, 0, nullptr);
+	stats.count(info, 30, 0, nullptr);
+	stats.count(error, 40, 0, nullptr);
+	stats.count(print, 5, 0, nullptr);
+
+	TEST_ASSERT_EQUAL(2, stats.records[info]);
+	TEST_ASSERT_EQUAL(50, stats.bytes[info]);
+	TEST_ASSERT_EQUAL(1, stats.records[error]);
+	TEST_ASSERT_EQUAL(1, stats.records[print]);
+	TEST_ASSERT_EQUAL(4, stats.totalRecords());
+	TEST_ASSERT_EQUAL(95, stats.totalBytes());
+	TEST_ASSERT_EQUAL(40, stats.largestRecord);
+}
+
+// Tags sharing a slot probe to the next one, untagged records are not counted per tag
+void test_counts_per_tag()
+{
+	LogStats stats = {};
+	stats.count(info, 10, motor, "MOTOR");
+	stats.count(error, 12, wifi, "WIFI");
+	stats.count(info, 14, motor, "MOTOR");
+	stats.count(info, 99, 0, nullptr);
+
+	const LogTagStats *motorStats = stats.findTag(motor);
+	TEST_ASSERT_NOT_NULL(motorStats);
+	TEST_ASSERT_EQUAL_STRING("MOTOR", motorStats->tag);
+	TEST_ASSERT_EQUAL(2, motorStats->records);
+	TEST_ASSERT_EQUAL(24, motorStats->bytes);
+
+	const LogTagStats *wifiStats = stats.findTag(wifi);
+	TEST_ASSERT_NOT_NULL(wifiStats);
+	TEST_ASSERT_EQUAL(1, wifiStats->records);
+	TEST_ASSERT_EQUAL(0, stats.untrackedTags);
+}
+
+// The tag is copied, a tag built in a buffer that is reused later keeps its name
+void test_tag_copied()
+{
+	LogStats stats = {};
+	char tag[40] = "SENSOR_1";
+	stats.count(info, 10, 0x1111, tag);
+	strcpy(tag, "OVERWRITTEN");
+	TEST_ASSERT_EQUAL_STRING("SENSOR_1", stats.findTag(0x1111)->tag);
+
+	// Longer tags keep their first 24 bytes
+	stats.count(info, 10, 0x2222, "A_TAG_LONGER_THAN_24_BYTES");
+	TEST_ASSERT_EQUAL_MEMORY("A_TAG_LONGER_THAN_24_BYT", stats.findTag(0x2222)->tag, 24);
+}
+
+// Once every slot is taken, new tags are only counted in the level totals
+void test_tag_table_full()
+{
+	LogStats stats = {};
+	for (uint32_t hash = 1; hash <= LOG_STATS_TAG_SLOTS + 2; hash++)
+	{
+		stats.count(info, 1, hash, "TAG");
+	}
+	TEST_ASSERT_EQUAL(2, stats.untrackedTags);
+	TEST_ASSERT_EQUAL(LOG_STATS_TAG_SLOTS + 2, stats.records[info]);
+	TEST_ASSERT_NULL(stats.findTag(LOG_STATS_TAG_SLOTS + 1));
+}
+
+// A long record written in parts counts its bytes as they go out and the record once
+void test_record_in_parts()
+{
+	LogStats stats = {};
+	stats.countBytes(info, 64, motor, "MOTOR");
+	stats.countBytes(info, 64, motor, "MOTOR");
+	stats.countBytes(info, 10, motor, "MOTOR");
+	stats.countRecord(info, 138, motor, "MOTOR");
+
+	TEST_ASSERT_EQUAL(1, stats.records[info]);
+	TEST_ASSERT_EQUAL(138, stats.bytes[info]);
+	TEST_ASSERT_EQUAL(138, stats.largestRecord);
+	TEST_ASSERT_EQUAL(1, stats.findTag(motor)->records);
+	TEST_ASSERT_EQUAL(138, stats.findTag(motor)->bytes);
+}
+
+void test_reset()
+{
+	LogStats stats = {};
+	stats.count(info, 10, motor, "MOTOR");
+	stats.formatMicros = 100;
+	stats.longRecords = 1;
+	stats.reset();
+	TEST_ASSERT_EQUAL(0, stats.totalRecords());
+	TEST_ASSERT_EQUAL(0, stats.largestRecord);
+	TEST_ASSERT_EQUAL(0, stats.formatMicros);
+	TEST_ASSERT_EQUAL(0, stats.longRecords);
+	TEST_ASSERT_NULL(stats.findTag(motor));
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_starts_empty);
+	RUN_TEST(test_counts_per_level);
+	RUN_TEST(test_counts_per_tag);
+	RUN_TEST(test_tag_copied);
+	RUN_TEST(test_tag_table_full);
+	RUN_TEST(test_record_in_parts);
+	RUN_TEST(test_reset);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
@@ -0,0 +1,322 @@
+// Hierarchical timer wheel behind TIMER_EVERY_N_WHEEL, on a clock the tests move by hand
+//
+// pio test -e native -f test_timer_wheel
+
+#include <unity.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <TimerWheel.h>
+
+/*------------------------------------------------------------------------------
+ * HELPERS
+ *----------------------------------------------------------------------------*/
+
+struct TestClock
+{
+	static uint32_t time;
+	static uint32_t now() { return time; }
+};
+
+uint32_t TestClock::time = 0;
+
+typedef TimerWheel<TestClock> Wheel;
+
+// Records the tick each expiry ran at
+struct Expiry
+{
+	Wheel *wheel;
+	uint32_t ticks[8];
+	int count;
+};
+
+static void record(void *context)
+{
+	Expiry *expiry = static_cast<Expiry *>(context);
+	if (expiry->count < 8)
+	{
+		expiry->ticks[expiry->count] = expiry->wheel->now();
+	}
+	expiry->count++;
+}
+
+// Moves the clock to time and updates, one tick at a time or in one jump
+static size_t advance(Wheel &wheel, uint32_t time, uint32_t step = 0)
+{
+	size_t expired = 0;
+	while (TestClock::time != time)
+	{
+		uint32_t left = time - TestClock::time;
+		TestClock::time += step != 0 && step < left ? step : left;
+		expired += wheel.update();
+	}
+	return expired;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS
+ *----------------------------------------------------------------------------*/
+
+void test_one_shot()
+{
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer timer(record, &expiry);
+	wheel.schedule(timer, 10);
+	TEST_ASSERT_TRUE(timer.isScheduled());
+
+	advance(wheel, 9, 1);
+	TEST_ASSERT_EQUAL(0, expiry.count);
+	advance(wheel, 100, 1);
+	TEST_ASSERT_EQUAL(1, expiry.count);
+	TEST_ASSERT_EQUAL(10, expiry.ticks[0]);
+	TEST_ASSERT_FALSE(timer.isScheduled());
+	TEST_ASSERT_EQUAL(0, wheel.size());
+}
+
+// Each delay fires on its tick, whether updated every tick or in jumps, across every level
+void test_exact_on_every_level()
+{
+	static const uint32_t delays[] = {1, 31, 32, 33, 1023, 1024, 1025, 40000, 1048577, 33554431, 33554432, 50000000};
+	static const uint32_t steps[] = {1, 7, 1000, 0};
+	for (uint32_t step : steps)
+	{
+		for (uint32_t delay : delays)
+		{
+			if (step != 0 && delay / step > 50000)
+			{
+				continue;
+			}
+			TestClock::time = 5;
+			Wheel wheel;
+			Expiry expiry = {&wheel, {}, 0};
+			WheelTimer timer(record, &expiry);
+			wheel.schedule(timer, delay);
+			advance(wheel, 5 + delay - 1, step > delay ? delay - 1 : step);
+			TEST_ASSERT_EQUAL_MESSAGE(0, expiry.count, "early");
+			advance(wheel, 5 + delay + 1, step);
+			TEST_ASSERT_EQUAL_MESSAGE(1, expiry.count, "not once");
+			TEST_ASSERT_EQUAL_MESSAGE(5 + delay, expiry.ticks[0], "not on its tick");
+		}
+	}
+	TestClock::time = 0;
+}
+
+void test_periodic()
+{
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer timer(record, &expiry);
+	wheel.schedule(timer, 5, 7);
+	TEST_ASSERT_EQUAL(1, advance(wheel, 5));
+	TEST_ASSERT_EQUAL(14, advance(wheel, 103, 10));
+	TEST_ASSERT_EQUAL(12, expiry.ticks[1]);
+	TEST_ASSERT_EQUAL(19, expiry.ticks[2]);
+	TEST_ASSERT_TRUE(timer.isScheduled());
+	TEST_ASSERT_EQUAL(110, timer.getDeadline());
+}
+
+// A period of 0 is left off the wheel, EVERY_N_MILLIS(0) passes on its period alone
+void test_zero_period()
+{
+	Wheel wheel;
+	WheelTimer timer(wheel, 0);
+	TEST_ASSERT_FALSE(timer.isScheduled());
+	TEST_ASSERT_EQUAL(0, timer.getPeriod());
+	TEST_ASSERT_EQUAL(0, wheel.size());
+	TEST_ASSERT_EQUAL(0, advance(wheel, 10));
+}
+
+void test_cancel()
+{
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer first(record, &expiry);
+	WheelTimer second(record, &expiry);
+	wheel.schedule(first, 20);
+	wheel.schedule(second, 2000);
+	wheel.cancel(first);
+	wheel.cancel(second);
+	wheel.cancel(second);
+	TEST_ASSERT_EQUAL(0, wheel.size());
+	advance(wheel, 5000, 3);
+	TEST_ASSERT_EQUAL(0, expiry.count);
+}
+
+// Moving a scheduled timer takes it off its old slot
+void test_reschedule()
+{
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer timer(record, &expiry);
+	wheel.schedule(timer, 100);
+	wheel.schedule(timer, 10);
+	advance(wheel, 200);
+	TEST_ASSERT_EQUAL(1, expiry.count);
+	TEST_ASSERT_EQUAL(10, expiry.ticks[0]);
+}
+
+// A callback cancels another timer due on the same tick
+static WheelTimer *victim = nullptr;
+static Wheel *victimWheel = nullptr;
+
+static void cancelVictim(void *context)
+{
+	victimWheel->cancel(*victim);
+	record(context);
+}
+
+void test_cancel_from_callback()
+{
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer canceller(cancelVictim, &expiry);
+	WheelTimer target(record, &expiry);
+	victim = &target;
+	victimWheel = &wheel;
+	wheel.schedule(target, 20);
+	wheel.schedule(canceller, 20); // Linked last, expires first
+	advance(wheel, 30);
+	TEST_ASSERT_EQUAL(1, expiry.count);
+	TEST_ASSERT_FALSE(target.isScheduled());
+}
+
+// A timer scheduled for now from a callback runs on the next tick, not in the same update
+static void rearm(void *context)
+{
+	Expiry *expiry = static_cast<Expiry *>(context);
+	record(context);
+	if (expiry->count < 3)
+	{
+		expiry->wheel->scheduleAt(*victim, expiry->wheel->now());
+	}
+}
+
+void test_schedule_from_callback()
+{
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer timer(rearm, &expiry);
+	victim = &timer;
+	wheel.schedule(timer, 3);
+	TEST_ASSERT_EQUAL(1, advance(wheel, 3));
+	TEST_ASSERT_EQUAL(2, advance(wheel, 10));
+	TEST_ASSERT_EQUAL(4, expiry.ticks[1]);
+	TEST_ASSERT_EQUAL(5, expiry.ticks[2]);
+}
+
+void test_next_deadline()
+{
+	Wheel wheel;
+	WheelTimer near;
+	WheelTimer far;
+	uint32_t deadline = 0;
+	TEST_ASSERT_FALSE(wheel.nextDeadline(deadline));
+	TEST_ASSERT_EQUAL(UINT32_MAX, wheel.timeToNext());
+
+	wheel.schedule(far, 5000);
+	wheel.schedule(near, 40); // On level 1, after level 0 is empty
+	TEST_ASSERT_TRUE(wheel.nextDeadline(deadline));
+	TEST_ASSERT_EQUAL(40, deadline);
+	TEST_ASSERT_EQUAL(40, wheel.timeToNext());
+
+	advance(wheel, 40);
+	TEST_ASSERT_TRUE(near.fired());
+	TEST_ASSERT_FALSE(near.fired());
+	TEST_ASSERT_EQUAL(4960, wheel.timeToNext());
+
+	// Overdue until the next update
+	TestClock::time = 6000;
+	TEST_ASSERT_EQUAL(0, wheel.timeToNext());
+}
+
+// Ticks wrap at 2^32
+void test_wraparound()
+{
+	TestClock::time = 0xFFFFFF00u;
+	Wheel wheel;
+	Expiry expiry = {&wheel, {}, 0};
+	WheelTimer timer(record, &expiry);
+	wheel.schedule(timer, 0x200, 0x100);
+	advance(wheel, 0x2FF, 16);
+	TEST_ASSERT_EQUAL(2, expiry.count);
+	TEST_ASSERT_EQUAL(0x100, expiry.ticks[0]);
+	TEST_ASSERT_EQUAL(0x200, expiry.ticks[1]);
+	TestClock::time = 0;
+}
+
+// Many timers at once, each fires on its own tick
+void test_many_timers()
+{
+	static const int count = 64;
+	static WheelTimer timers[count];
+	static Expiry expiries[count];
+	Wheel wheel;
+	uint32_t seed = 7;
+	for (int i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		expiries[i] = {&wheel, {}, 0};
+		timers[i].setCallback(record, &expiries[i]);
+		wheel.schedule(timers[i], 1 + (seed >> 8) % 70000);
+	}
+	TEST_ASSERT_EQUAL(count, wheel.size());
+	advance(wheel, 70001, 97);
+	for (int i = 0; i < count; i++)
+	{
+		TEST_ASSERT_EQUAL(1, expiries[i].count);
+		TEST_ASSERT_EQUAL(timers[i].getDeadline(), expiries[i].ticks[0]);
+	}
+	TEST_ASSERT_EQUAL(0, wheel.size());
+	TestClock::time = 0;
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+	TestClock::time = 0;
+}
+
+void tearDown(void)
+{
+}
+
+int tests()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_one_shot);
+	RUN_TEST(test_exact_on_every_level);
+	RUN_TEST(test_periodic);
+	RUN_TEST(test_zero_period);
+	RUN_TEST(test_cancel);
+	RUN_TEST(test_reschedule);
+	RUN_TEST(test_cancel_from_callback);
+	RUN_TEST(test_schedule_from_callback);
+	RUN_TEST(test_next_deadline);
+	RUN_TEST(test_wraparound);
+	RUN_TEST(test_many_timers);
+	return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+	// NOTE!!! Wait for >2 secs
+	// if board doesn't support software reset via Serial.DTR/RTS
+	delay(5000);
+
+	tests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+	return tests();
+}
+#endif
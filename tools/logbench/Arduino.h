@@ -0,0 +1,75 @@
+// Stand-in for the parts of Arduino.h the logger uses, so logbench builds it on the host. ARDUINO
+// stays undefined and the logger takes its host paths.
+
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+inline unsigned long micros()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+inline unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t written = 0;
+        while (size--)
+        {
+            written += write(*buffer++);
+        }
+        return written;
+    }
+
+    size_t write(const char *buffer, size_t size) { return write(reinterpret_cast<const uint8_t *>(buffer), size); }
+    size_t print(const char *text) { return write(text, strlen(text)); }
+    size_t println(const char *text = "") { return print(text) + print("\r\n"); }
+    virtual void flush() {}
+};
+
+// Counts what the logger writes and drops it, so only the logger is measured
+class NullSerial : public Print
+{
+public:
+    uint64_t bytes = 0;
+
+    using Print::write;
+    size_t write(uint8_t) override
+    {
+        bytes++;
+        return 1;
+    }
+
+    size_t write(const uint8_t *, size_t size) override
+    {
+        bytes += size;
+        return size;
+    }
+
+    void begin(unsigned long) {}
+};
+
+extern NullSerial Serial;
@@ -0,0 +1,3 @@
+// fmt-arduino is a board library, the host build uses the system fmtlib
+#pragma once
+#include <fmt/format.h>
@@ -0,0 +1,126 @@
+// Logger throughput on the host for one configuration, picked with build flags. logbench.sh builds
+// and runs it for every LOG_PRINT_TYPE and LOG_TIME combination.
+//
+// Build:
+//   g++ -std=gnu++20 -O2 -pthread -I tools/logbench -I lib/Logger -I lib/Format -D LOG_TIME=LOG_TIME_MILLIS
+//       -D LOG_PRINT_TYPE=LOG_PRINT_TYPE_PRINTF tools/logbench/logbench.cpp lib/Logger/Logger.cpp -o logbench
+//
+// Prints ns and bytes per record for each workload. Built with -D LOG_STATS=LOG_STATS_ENABLE it also
+// splits the time into formatting and output from logStats().
+
+#include <stdio.h>
+#include <chrono>
+#include <log.h>
+
+#ifndef LOGBENCH_RECORDS
+#define LOGBENCH_RECORDS 200000
+#endif
+
+NullSerial Serial;
+
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
+#define BENCH_FORMAT(printfFormat, braceFormat) printfFormat
+#else
+#define BENCH_FORMAT(printfFormat, braceFormat) braceFormat
+#endif
+
+static const char *printTypeName()
+{
+#if LOG_PRINT_TYPE == LOG_PRINT_TYPE_PRINTF
+    return "printf";
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_CUSTOM_FORMAT
+    return "afmt";
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_STD_FORMAT
+    return "std::format";
+#elif LOG_PRINT_TYPE == LOG_PRINT_TYPE_FMT_FORMAT
+    return "fmt";
+#else
+    return "binary";
+#endif
+}
+
+static const char *timeName()
+{
+#if LOG_TIME == LOG_TIME_DISABLE
+    return "none";
+#elif LOG_TIME == LOG_TIME_MICROS
+    return "micros";
+#elif LOG_TIME == LOG_TIME_MILLIS
+    return "millis";
+#elif LOG_TIME == LOG_TIME_HHMMSSMS
+    return "hh:mm:ss:ms";
+#elif LOG_TIME == LOG_TIME_HHHHMMSSMS
+    return "hhhh:mm:ss:ms";
+#elif LOG_TIME == LOG_TIME_SECONDS_MICROS
+    return "s.us";
+#else
+    return "cycles";
+#endif
+}
+
+static const char longText[] = "The quick brown fox jumps over the lazy dog while the sensor keeps sampling";
+
+static void logShort(int)
+{
+    LOG_I("ready");
+}
+
+static void logInts(int i)
+{
+    LOG_I(BENCH_FORMAT("adc %d count %d mask %x", "adc {} count {} mask {:x}"), i & 1023, i, i * 7);
+}
+
+static void logTagged(int i)
+{
+    LOG_INFO("MOTOR", BENCH_FORMAT("rpm %.2f current %.3f", "rpm {:.2f} current {:.3f}"), i * 0.5, i * 0.001);
+}
+
+// Longer than LOG_STATIC_BUFFER_SIZE
+static void logLong(int i)
+{
+    LOG_W(BENCH_FORMAT("%s | %s | %d", "{} | {} | {}"), longText, longText, i);
+}
+
+#if LOG_PRINT_TYPE != LOG_PRINT_TYPE_BINARY
+// The tagged workload as key-value fields
+static void logKv(int i)
+{
+    LOG_KV("MOTOR", LOG_LEVEL_INFO, "sample", "rpm", i * 0.5, "current", i * 0.001);
+}
+#endif
+
+static void run(const char *workload, void (*logOnce)(int))
+{
+#if LOG_STATS == LOG_STATS_ENABLE
+    logResetStats();
+#endif
+    uint64_t bytesBefore = Serial.bytes;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOGBENCH_RECORDS; i++)
+    {
+        logOnce(i);
+    }
+    logFlush();
+    double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    printf("%-12s %-14s %-8s %9.1f ns/record %6.1f B/record", printTypeName(), timeName(), workload,
+           nanos / LOGBENCH_RECORDS, static_cast<double>(Serial.bytes - bytesBefore) / LOGBENCH_RECORDS);
+#if LOG_STATS == LOG_STATS_ENABLE
+    LogStats stats = logStats();
+    printf("  format %lu us output %lu us long %lu cut %lu", (unsigned long)stats.formatMicros, (unsigned long)stats.outputMicros,
+           (unsigned long)stats.longRecords, (unsigned long)stats.cutRecords);
+#endif
+    printf("\n");
+}
+
+int main()
+{
+    run("short", logShort);
+    run("ints", logInts);
+    run("tagged", logTagged);
+    run("long", logLong);
+#if LOG_PRINT_TYPE != LOG_PRINT_TYPE_BINARY
+    run("kv", logKv);
+#endif
+    return 0;
+}
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Builds tools/logbench for every LOG_PRINT_TYPE and LOG_TIME combination and prints one table.
+# Combinations the host cannot build, e.g. std::format without <format>, are listed as skipped.
+#
+# Usage, from the repository root:
+#   tools/logbench/logbench.sh [extra g++ flags]
+#   tools/logbench/logbench.sh -D LOG_STATS=LOG_STATS_ENABLE -D LOG_MODE=LOG_MODE_ASYNC
+
+CXX=${CXX:-g++}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+for printType in PRINTF CUSTOM_FORMAT STD_FORMAT FMT_FORMAT BINARY; do
+    libs=""
+    if [ "$printType" = FMT_FORMAT ]; then
+        libs="-lfmt"
+    fi
+    for time in DISABLE MICROS MILLIS HHMMSSMS HHHHMMSSMS SECONDS_MICROS CYCLES; do
+        if "$CXX" -std=gnu++20 -O2 -pthread -I tools/logbench -I lib/Logger -I lib/Format \
+            -D LOG_PRINT_TYPE=LOG_PRINT_TYPE_$printType -D LOG_TIME=LOG_TIME_$time "$@" \
+            tools/logbench/logbench.cpp lib/Logger/Logger.cpp -o "$OUT/logbench" $libs 2>"$OUT/errors"; then
+            "$OUT/logbench"
+        else
+            echo "LOG_PRINT_TYPE_$printType LOG_TIME_$time skipped, it does not build on this host"
+        fi
+    done
+done
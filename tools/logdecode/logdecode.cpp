@@ -0,0 +1,84 @@
+// Decodes LOG_PRINT_TYPE_BINARY output back into log text.
+//
+// Build:
+//   g++ -std=c++17 -O2 -I lib/Logger -I lib/Format tools/logdecode/logdecode.cpp -o logdecode
+//
+// Usage:
+//   logdecode [-t none|us|ms] firmware.elf [capture.bin]
+//
+// Reads the capture from stdin when no file is given, so a serial port can be piped in:
+//   stty -F /dev/ttyUSB0 115200 raw && logdecode .pio/build/esp32dev/firmware.elf < /dev/ttyUSB0
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "LogDecoder.h"
+
+static int usage()
+{
+    fprintf(stderr, "usage: logdecode [-t none|us|ms] firmware.elf [capture.bin]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    LogDecoder::Time time = LogDecoder::Time::Millis;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "-t") == 0)
+    {
+        const char *unit = argv[arg + 1];
+        if (strcmp(unit, "none") == 0)
+            time = LogDecoder::Time::None;
+        else if (strcmp(unit, "us") == 0)
+            time = LogDecoder::Time::Micros;
+        else if (strcmp(unit, "ms") == 0)
+            time = LogDecoder::Time::Millis;
+        else
+            return usage();
+        arg += 2;
+    }
+    if (arg >= argc || argc - arg > 2)
+    {
+        return usage();
+    }
+
+    LogStringTable table;
+    if (!table.load(argv[arg]))
+    {
+        fprintf(stderr, "logdecode: %s is not an ELF built with LOG_PRINT_TYPE_BINARY\n", argv[arg]);
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (arg + 1 < argc)
+    {
+        input = fopen(argv[arg + 1], "rb");
+        if (input == nullptr)
+        {
+            fprintf(stderr, "logdecode: cannot open %s\n", argv[arg + 1]);
+            return 1;
+        }
+    }
+
+    LogDecoder decoder(table, time);
+    uint8_t chunk[256];
+    std::string out;
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), input)) > 0)
+    {
+        decoder.feed(chunk, n, out);
+        fwrite(out.data(), 1, out.size(), stdout);
+        fflush(stdout);
+        out.clear();
+    }
+
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    if (decoder.invalid() > 0)
+    {
+        fprintf(stderr, "logdecode: %u invalid records passed through as text\n", decoder.invalid());
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// LzEncoder and LzDecoder throughput and ratio on the host for a few window sizes.
+//
+// Build:
+//   g++ -std=gnu++20 -O2 -I lib/Compression tools/lzbench/lzbench.cpp -o lzbench
+//
+// Run:
+//   ./lzbench            log lines like the logger writes
+//   ./lzbench log.txt    any file, e.g. a CSV export
+//
+// Prints the compressed size as a percentage of the input, MB/s both ways and the RAM of each
+// side, and checks every round trip gives back the input.
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <Compression.h>
+
+#ifndef LZBENCH_ROUNDS
+#define LZBENCH_ROUNDS 20
+#endif
+
+static std::string logText()
+{
+    std::string text;
+    char line[96];
+    for (int i = 0; i < 20000; i++)
+    {
+        snprintf(line, sizeof(line), "[%8d][I][MOTOR] rpm %d current %d.%03d state %s\n", i * 10, 1200 + i % 37, i % 4, (i * 7) % 1000,
+                 i % 5 == 0 ? "ramp" : "run");
+        text += line;
+    }
+    return text;
+}
+
+static bool readFile(const char *path, std::string &text)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    char chunk[4096];
+    size_t size;
+    while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        text.append(chunk, size);
+    }
+    fclose(file);
+    return true;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Coder>
+static void pullAll(Coder &coder, std::string &out)
+{
+    uint8_t chunk[256];
+    size_t size;
+    while ((size = coder.pull(chunk, sizeof(chunk))) > 0)
+    {
+        out.append(reinterpret_cast<char *>(chunk), size);
+    }
+}
+
+// Pushes 256 bytes at a time and pulls after each push, as a sink would
+template <typename Coder>
+static void stream(Coder &coder, const std::string &in, std::string &out)
+{
+    size_t done = 0;
+    out.clear();
+    while (done < in.size())
+    {
+        done += coder.push(reinterpret_cast<const uint8_t *>(in.data()) + done, in.size() - done < 256 ? in.size() - done : 256);
+        pullAll(coder, out);
+    }
+}
+
+template <uint8_t WindowBits, uint8_t LookaheadBits>
+static bool run(const std::string &text)
+{
+    static LzEncoder<WindowBits, LookaheadBits> encoder;
+    static LzDecoder<WindowBits, LookaheadBits> decoder;
+    std::string compressed;
+    std::string decompressed;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < LZBENCH_ROUNDS; round++)
+    {
+        encoder.reset();
+        stream(encoder, text, compressed);
+        encoder.flush();
+        pullAll(encoder, compressed);
+    }
+    double encodeSeconds = seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < LZBENCH_ROUNDS; round++)
+    {
+        decoder.reset();
+        stream(decoder, compressed, decompressed);
+    }
+    double decodeSeconds = seconds(start);
+
+    double megabytes = static_cast<double>(text.size()) * LZBENCH_ROUNDS / 1e6;
+    printf("window %2u lookahead %u  %5.1f %%  encode %7.1f MB/s  decode %7.1f MB/s  RAM encoder %5zu B decoder %5zu B\n",
+           WindowBits, LookaheadBits, 100.0 * static_cast<double>(compressed.size()) / static_cast<double>(text.size()),
+           megabytes / encodeSeconds, megabytes / decodeSeconds, sizeof(encoder), sizeof(decoder));
+    if (decompressed != text)
+    {
+        printf("window %2u lookahead %u  round trip does not match\n", WindowBits, LookaheadBits);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::string text;
+    if (argc > 1 && !readFile(argv[1], text))
+    {
+        printf("cannot read %s\n", argv[1]);
+        return 1;
+    }
+    if (argc <= 1)
+    {
+        text = logText();
+    }
+    printf("%zu bytes, %d rounds\n", text.size(), LZBENCH_ROUNDS);
+
+    bool ok = run<6, 3>(text);
+    ok = run<8, 4>(text) && ok;
+    ok = run<10, 4>(text) && ok;
+    ok = run<10, 6>(text) && ok;
+    ok = run<12, 6>(text) && ok;
+    return ok ? 0 : 1;
+}